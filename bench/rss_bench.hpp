@@ -0,0 +1,201 @@
+#ifndef RSS_BENCH_HPP
+#define RSS_BENCH_HPP
+
+/*
+#include "rss_bench.hpp"
+*/
+
+/**
+* the common of benchmarks, each case reports a line of key=value to stderr:
+* 		bench=<suite> case=<name> ops=<n> total_ms=<ms> ns_per_op=<ns> [mb_per_s=<MB/s>]
+* the make bench collects the lines to objs/bench/results.txt, compare the
+* ns_per_op of cases to the results of baseline to find the regressions.
+*/
+#include <rss_core.hpp>
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <sys/uio.h>
+
+#include <string>
+
+#include <rss_core_log.hpp>
+#include <rss_core_error.hpp>
+#include <rss_core_socket.hpp>
+#include <rss_core_protocol.hpp>
+
+static inline int64_t bench_now_ns()
+{
+	timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (int64_t)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+/**
+* report the case.
+* @bytes the bytes processed by all ops, 0 to ignore the throughput.
+*/
+static inline void bench_report(const char* suite, const char* name, int64_t ops, int64_t elapsed, int64_t bytes)
+{
+	fprintf(stderr, "bench=%s case=%s ops=%lld total_ms=%.3f ns_per_op=%.2f",
+	        suite, name, (long long)ops, elapsed / 1000000.0, (double)elapsed / rss_max(ops, (int64_t)1));
+	if (bytes > 0)
+	{
+		fprintf(stderr, " mb_per_s=%.1f", bytes * 1000.0 / rss_max(elapsed, (int64_t)1));
+	}
+	fprintf(stderr, "\n");
+}
+
+/**
+* redirect the stdout to /dev/null, and format the log to ring buffer like
+* the server, the report is written to stderr.
+*/
+static inline int bench_initialize_log()
+{
+	int ret = ERROR_SUCCESS;
+
+	if (!freopen("/dev/null", "w", stdout))
+	{
+		fprintf(stderr, "redirect stdout failed.\n");
+		return -1;
+	}
+	if ((ret = log_writer->initialize(NULL)) != ERROR_SUCCESS)
+	{
+		fprintf(stderr, "initialize log failed. ret=%d\n", ret);
+		return ret;
+	}
+
+	return ret;
+}
+
+/**
+* create the shared message at timestamp 0, the payload is zeros
+* starts with the header, for instance, the frame type of video.
+*/
+static inline RssSharedPtrMessage* bench_create_message(bool video, const char* header, int header_size, int size, int stream_id)
+{
+	char* payload = new char[size];
+	memset(payload, 0, size);
+	memcpy(payload, header, rss_min(header_size, size));
+
+	RssCommonMessage msg;
+	if (video)
+	{
+		msg.header.initialize_video(size, 0, stream_id);
+	}
+	else
+	{
+		msg.header.initialize_audio(size, 0, stream_id);
+	}
+
+	RssSharedPtrMessage* shared = new RssSharedPtrMessage();
+	shared->initialize(&msg, payload, size);
+
+	return shared;
+}
+
+/**
+* the in-memory socket for protocol, read from the bytes util end,
+* the written bytes are discarded, or captured to build the bytes to read.
+*/
+class RssBenchSocket : public RssSocket
+{
+private:
+	const char* bytes;
+	int size;
+	int pos;
+	bool capture;
+	std::string captured;
+	int64_t nb_recv;
+	int64_t nb_send;
+public:
+	RssBenchSocket() : RssSocket(NULL)
+	{
+		bytes = NULL;
+		size = pos = 0;
+		capture = false;
+		nb_recv = nb_send = 0;
+	}
+	virtual ~RssBenchSocket()
+	{
+	}
+public:
+	/**
+	* read the bytes from start, the bytes is not copied.
+	*/
+	virtual void reset(const char* _bytes, int _size)
+	{
+		bytes = _bytes;
+		size = _size;
+		pos = 0;
+	}
+	virtual void set_capture(bool v)
+	{
+		capture = v;
+	}
+	virtual std::string& get_captured()
+	{
+		return captured;
+	}
+public:
+	virtual int64_t get_recv_bytes()
+	{
+		return nb_recv;
+	}
+	virtual int64_t get_send_bytes()
+	{
+		return nb_send;
+	}
+	virtual int read(const void* buf, size_t nb_buf, ssize_t* nread)
+	{
+		if (pos >= size)
+		{
+			*nread = 0;
+			return ERROR_SOCKET_READ;
+		}
+
+		int nb_copy = rss_min((int)nb_buf, size - pos);
+		memcpy((void*)buf, bytes + pos, nb_copy);
+		pos += nb_copy;
+		nb_recv += nb_copy;
+
+		*nread = nb_copy;
+		return ERROR_SUCCESS;
+	}
+	virtual int read_fully(const void* buf, size_t nb_buf, ssize_t* nread)
+	{
+		if (size - pos < (int)nb_buf)
+		{
+			*nread = 0;
+			return ERROR_SOCKET_READ_FULLY;
+		}
+		return read(buf, nb_buf, nread);
+	}
+	virtual int write(const void* buf, size_t nb_buf, ssize_t* nwrite)
+	{
+		if (capture)
+		{
+			captured.append((const char*)buf, nb_buf);
+		}
+		nb_send += nb_buf;
+
+		*nwrite = nb_buf;
+		return ERROR_SUCCESS;
+	}
+	virtual int writev(const iovec *iov, int iov_size, ssize_t* nwrite)
+	{
+		ssize_t total = 0;
+		for (int i = 0; i < iov_size; i++)
+		{
+			ssize_t n = 0;
+			write(iov[i].iov_base, iov[i].iov_len, &n);
+			total += n;
+		}
+
+		*nwrite = total;
+		return ERROR_SUCCESS;
+	}
+};
+
+#endif
@@ -0,0 +1,442 @@
+/**
+* benchmark the amf0 decode of connect and play command,
+* the tree(create amf0 values) versus the reader(RssAmf0Reader),
+* and the decode/encode of metadata, the encode of connect and its result.
+* usage: objs/bench/rss_bench_amf0 [loops]
+* @remark the log of decode is written to stdout by the log writer, which is
+* 		redirected to /dev/null, the result is printed to stderr.
+*/
+#include <rss_core.hpp>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include <rss_core_log.hpp>
+#include <rss_core_error.hpp>
+#include <rss_core_stream.hpp>
+#include <rss_core_amf0.hpp>
+#include <rss_core_protocol.hpp>
+#include <rss_core_auto_free.hpp>
+
+#include "rss_bench.hpp"
+
+#define BENCH_DEFAULT_LOOPS 10000
+#define BENCH_PAYLOAD_SIZE 4096
+
+/**
+* encode the connect command like the flash player.
+*/
+static int bench_encode_connect(char* bytes, int& size)
+{
+	int ret = ERROR_SUCCESS;
+
+	RssAmf0Object* obj = new RssAmf0Object();
+	RssAutoFree(RssAmf0Object, obj, false);
+
+	obj->set("app", new RssAmf0String("live"));
+	obj->set("flashVer", new RssAmf0String("WIN 11,1,102,55"));
+	obj->set("swfUrl", new RssAmf0String("http://127.0.0.1/player.swf"));
+	obj->set("tcUrl", new RssAmf0String("rtmp://127.0.0.1:1935/live"));
+	obj->set("fpad", new RssAmf0Boolean(false));
+	obj->set("capabilities", new RssAmf0Number(239));
+	obj->set("audioCodecs", new RssAmf0Number(3575));
+	obj->set("videoCodecs", new RssAmf0Number(252));
+	obj->set("videoFunction", new RssAmf0Number(1));
+	obj->set("pageUrl", new RssAmf0String("http://127.0.0.1/player.html"));
+	obj->set("objectEncoding", new RssAmf0Number(0));
+
+	RssStream stream;
+	if ((ret = stream.initialize(bytes, BENCH_PAYLOAD_SIZE)) != ERROR_SUCCESS)
+	{
+		return ret;
+	}
+
+	if ((ret = rss_amf0_write_string(&stream, "connect")) != ERROR_SUCCESS)
+	{
+		return ret;
+	}
+	if ((ret = rss_amf0_write_number(&stream, 1)) != ERROR_SUCCESS)
+	{
+		return ret;
+	}
+	if ((ret = rss_amf0_write_object(&stream, obj)) != ERROR_SUCCESS)
+	{
+		return ret;
+	}
+
+	size = stream.pos();
+	return ret;
+}
+
+/**
+* encode the play command with start, duration and reset.
+*/
+static int bench_encode_play(char* bytes, int& size)
+{
+	int ret = ERROR_SUCCESS;
+
+	RssStream stream;
+	if ((ret = stream.initialize(bytes, BENCH_PAYLOAD_SIZE)) != ERROR_SUCCESS)
+	{
+		return ret;
+	}
+
+	if ((ret = rss_amf0_write_string(&stream, "play")) != ERROR_SUCCESS)
+	{
+		return ret;
+	}
+	if ((ret = rss_amf0_write_number(&stream, 4)) != ERROR_SUCCESS)
+	{
+		return ret;
+	}
+	if ((ret = rss_amf0_write_null(&stream)) != ERROR_SUCCESS)
+	{
+		return ret;
+	}
+	if ((ret = rss_amf0_write_string(&stream, "livestream")) != ERROR_SUCCESS)
+	{
+		return ret;
+	}
+	if ((ret = rss_amf0_write_number(&stream, -1000)) != ERROR_SUCCESS)
+	{
+		return ret;
+	}
+	if ((ret = rss_amf0_write_number(&stream, -1)) != ERROR_SUCCESS)
+	{
+		return ret;
+	}
+	if ((ret = rss_amf0_write_boolean(&stream, true)) != ERROR_SUCCESS)
+	{
+		return ret;
+	}
+
+	size = stream.pos();
+	return ret;
+}
+
+/**
+* build the metadata like the encoder(FMLE/OBS).
+*/
+static void bench_build_metadata(RssOnMetaDataPacket* pkt)
+{
+	RssAmf0Object* obj = pkt->metadata;
+
+	obj->set("duration", new RssAmf0Number(0));
+	obj->set("fileSize", new RssAmf0Number(0));
+	obj->set("width", new RssAmf0Number(1920));
+	obj->set("height", new RssAmf0Number(1080));
+	obj->set("videocodecid", new RssAmf0String("avc1"));
+	obj->set("videodatarate", new RssAmf0Number(4500));
+	obj->set("framerate", new RssAmf0Number(30));
+	obj->set("audiocodecid", new RssAmf0String("mp4a"));
+	obj->set("audiodatarate", new RssAmf0Number(160));
+	obj->set("audiosamplerate", new RssAmf0Number(48000));
+	obj->set("audiosamplesize", new RssAmf0Number(16));
+	obj->set("audiochannels", new RssAmf0Number(2));
+	obj->set("stereo", new RssAmf0Boolean(true));
+	obj->set("2.1", new RssAmf0Boolean(false));
+	obj->set("3.1", new RssAmf0Boolean(false));
+	obj->set("4.0", new RssAmf0Boolean(false));
+	obj->set("4.1", new RssAmf0Boolean(false));
+	obj->set("5.1", new RssAmf0Boolean(false));
+	obj->set("7.1", new RssAmf0Boolean(false));
+	obj->set("encoder", new RssAmf0String("obs-output module (libobs version 27.2.4)"));
+}
+
+/**
+* build the connect like the flash player, for the encode.
+*/
+static void bench_build_connect(RssConnectAppPacket* pkt)
+{
+	pkt->tcUrl = "rtmp://127.0.0.1:1935/live";
+	pkt->pageUrl = "http://127.0.0.1/player.html";
+	pkt->swfUrl = "http://127.0.0.1/player.swf";
+	pkt->objectEncoding = 0;
+}
+
+/**
+* build the result of connect like the server, see RssRtmp::response_connect_app.
+*/
+static void bench_build_connect_res(RssConnectAppResPacket* pkt)
+{
+	pkt->props->set("fmsVer", new RssAmf0String("FMS/3,5,3,888"));
+	pkt->props->set("capabilities", new RssAmf0Number(127));
+	pkt->props->set("mode", new RssAmf0Number(1));
+
+	pkt->info->set("level", new RssAmf0String("status"));
+	pkt->info->set("code", new RssAmf0String("NetConnection.Connect.Success"));
+	pkt->info->set("description", new RssAmf0String("Connection succeeded"));
+	pkt->info->set("objectEncoding", new RssAmf0Number(0));
+	RssARssAmf0EcmaArray* data = new RssARssAmf0EcmaArray();
+	pkt->info->set("data", data);
+
+	data->set("version", new RssAmf0String("3,5,3,888"));
+	data->set("server", new RssAmf0String("rss(simple rtmp server)"));
+	data->set("rss_url", new RssAmf0String("https://github.com/Q0R1Y/rtmp_server"));
+	data->set("rss_version", new RssAmf0String("0.1"));
+}
+
+/**
+* encode the packet loops times to the reused buffer.
+*/
+static int bench_encode(const char* name, RssPacket* pkt, int loops)
+{
+	int ret = ERROR_SUCCESS;
+
+	RssEncodeBuffer buffer;
+	int64_t bytes = 0;
+	int64_t starttime = bench_now_ns();
+
+	for (int i = 0; i < loops; i++)
+	{
+		int size = 0;
+		char* payload = NULL;
+		if ((ret = pkt->encode(&buffer, size, payload)) != ERROR_SUCCESS)
+		{
+			fprintf(stderr, "encode %s failed. ret=%d\n", name, ret);
+			return ret;
+		}
+		rss_freepa(payload);
+		bytes += size;
+	}
+	bench_report("amf0", name, loops, bench_now_ns() - starttime, bytes);
+
+	return ret;
+}
+
+/**
+* the tree decode of connect, read the command object then find the properties.
+*/
+static int bench_tree_connect(RssStream* stream, std::string& tcUrl)
+{
+	int ret = ERROR_SUCCESS;
+
+	std::string command_name;
+	double transaction_id = 0;
+	RssAmf0Object* command_object = NULL;
+
+	if ((ret = rss_amf0_read_string(stream, command_name)) != ERROR_SUCCESS)
+	{
+		return ret;
+	}
+	if ((ret = rss_amf0_read_number(stream, transaction_id)) != ERROR_SUCCESS)
+	{
+		return ret;
+	}
+	if ((ret = rss_amf0_read_object(stream, command_object)) != ERROR_SUCCESS)
+	{
+		return ret;
+	}
+	RssAutoFree(RssAmf0Object, command_object, false);
+
+	RssAmf0Any* prop = NULL;
+	if ((prop = command_object->ensure_property_string("tcUrl")) != NULL)
+	{
+		tcUrl = rss_amf0_convert<RssAmf0String>(prop)->to_str();
+	}
+	command_object->ensure_property_string("pageUrl");
+	command_object->ensure_property_string("swfUrl");
+	command_object->ensure_property_number("objectEncoding");
+
+	return ret;
+}
+
+/**
+* the tree decode of play, read the values one by one.
+*/
+static int bench_tree_play(RssStream* stream, std::string& stream_name)
+{
+	int ret = ERROR_SUCCESS;
+
+	std::string command_name;
+	double transaction_id = 0;
+	double start = 0, duration = 0;
+	bool reset = false;
+
+	if ((ret = rss_amf0_read_string(stream, command_name)) != ERROR_SUCCESS)
+	{
+		return ret;
+	}
+	if ((ret = rss_amf0_read_number(stream, transaction_id)) != ERROR_SUCCESS)
+	{
+		return ret;
+	}
+	if ((ret = rss_amf0_read_null(stream)) != ERROR_SUCCESS)
+	{
+		return ret;
+	}
+	if ((ret = rss_amf0_read_string(stream, stream_name)) != ERROR_SUCCESS)
+	{
+		return ret;
+	}
+	if ((ret = rss_amf0_read_number(stream, start)) != ERROR_SUCCESS)
+	{
+		return ret;
+	}
+	if ((ret = rss_amf0_read_number(stream, duration)) != ERROR_SUCCESS)
+	{
+		return ret;
+	}
+	if ((ret = rss_amf0_read_boolean(stream, reset)) != ERROR_SUCCESS)
+	{
+		return ret;
+	}
+
+	return ret;
+}
+
+int main(int argc, char** argv)
+{
+	int ret = ERROR_SUCCESS;
+
+	int loops = BENCH_DEFAULT_LOOPS;
+	if (argc > 1)
+	{
+		loops = atoi(argv[1]);
+	}
+	if (loops <= 0)
+	{
+		loops = BENCH_DEFAULT_LOOPS;
+	}
+
+	if ((ret = bench_initialize_log()) != ERROR_SUCCESS)
+	{
+		return ret;
+	}
+
+	static char connect_bytes[BENCH_PAYLOAD_SIZE];
+	static char play_bytes[BENCH_PAYLOAD_SIZE];
+	int connect_size = 0;
+	int play_size = 0;
+
+	if ((ret = bench_encode_connect(connect_bytes, connect_size)) != ERROR_SUCCESS)
+	{
+		fprintf(stderr, "encode connect failed. ret=%d\n", ret);
+		return ret;
+	}
+	if ((ret = bench_encode_play(play_bytes, play_size)) != ERROR_SUCCESS)
+	{
+		fprintf(stderr, "encode play failed. ret=%d\n", ret);
+		return ret;
+	}
+
+	RssStream stream;
+	int64_t starttime = 0;
+
+	if (true)
+	{
+		starttime = bench_now_ns();
+		for (int i = 0; i < loops; i++)
+		{
+			std::string tcUrl;
+			stream.initialize(connect_bytes, connect_size);
+			if ((ret = bench_tree_connect(&stream, tcUrl)) != ERROR_SUCCESS)
+			{
+				fprintf(stderr, "tree decode connect failed. ret=%d\n", ret);
+				return ret;
+			}
+		}
+		bench_report("amf0", "connect_tree", loops, bench_now_ns() - starttime, (int64_t)loops * connect_size);
+	}
+
+	if (true)
+	{
+		starttime = bench_now_ns();
+		for (int i = 0; i < loops; i++)
+		{
+			RssConnectAppPacket pkt;
+			stream.initialize(connect_bytes, connect_size);
+			if ((ret = pkt.decode(&stream)) != ERROR_SUCCESS)
+			{
+				fprintf(stderr, "reader decode connect failed. ret=%d\n", ret);
+				return ret;
+			}
+		}
+		bench_report("amf0", "connect_reader", loops, bench_now_ns() - starttime, (int64_t)loops * connect_size);
+	}
+
+	if (true)
+	{
+		starttime = bench_now_ns();
+		for (int i = 0; i < loops; i++)
+		{
+			std::string stream_name;
+			stream.initialize(play_bytes, play_size);
+			if ((ret = bench_tree_play(&stream, stream_name)) != ERROR_SUCCESS)
+			{
+				fprintf(stderr, "tree decode play failed. ret=%d\n", ret);
+				return ret;
+			}
+		}
+		bench_report("amf0", "play_tree", loops, bench_now_ns() - starttime, (int64_t)loops * play_size);
+	}
+
+	if (true)
+	{
+		starttime = bench_now_ns();
+		for (int i = 0; i < loops; i++)
+		{
+			RssPlayPacket pkt;
+			stream.initialize(play_bytes, play_size);
+			if ((ret = pkt.decode(&stream)) != ERROR_SUCCESS)
+			{
+				fprintf(stderr, "reader decode play failed. ret=%d\n", ret);
+				return ret;
+			}
+		}
+		bench_report("amf0", "play_reader", loops, bench_now_ns() - starttime, (int64_t)loops * play_size);
+	}
+
+	if (true)
+	{
+		RssOnMetaDataPacket metadata;
+		bench_build_metadata(&metadata);
+
+		int metadata_size = 0;
+		char* metadata_bytes = NULL;
+		if ((ret = metadata.encode(NULL, metadata_size, metadata_bytes)) != ERROR_SUCCESS)
+		{
+			fprintf(stderr, "encode metadata failed. ret=%d\n", ret);
+			return ret;
+		}
+		RssAutoFree(char, metadata_bytes, true);
+
+		starttime = bench_now_ns();
+		for (int i = 0; i < loops; i++)
+		{
+			RssOnMetaDataPacket pkt;
+			stream.initialize(metadata_bytes, metadata_size);
+			if ((ret = pkt.decode(&stream)) != ERROR_SUCCESS)
+			{
+				fprintf(stderr, "decode metadata failed. ret=%d\n", ret);
+				return ret;
+			}
+		}
+		bench_report("amf0", "metadata_decode", loops, bench_now_ns() - starttime, (int64_t)loops * metadata_size);
+
+		if ((ret = bench_encode("metadata_encode", &metadata, loops)) != ERROR_SUCCESS)
+		{
+			return ret;
+		}
+	}
+
+	if (true)
+	{
+		RssConnectAppPacket connect;
+		bench_build_connect(&connect);
+		if ((ret = bench_encode("connect_encode", &connect, loops)) != ERROR_SUCCESS)
+		{
+			return ret;
+		}
+
+		RssConnectAppResPacket res;
+		bench_build_connect_res(&res);
+		if ((ret = bench_encode("connect_res_encode", &res, loops)) != ERROR_SUCCESS)
+		{
+			return ret;
+		}
+	}
+
+	return ret;
+}
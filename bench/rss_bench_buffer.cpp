@@ -0,0 +1,147 @@
+/**
+* benchmark the append and erase of RssBuffer over the in-memory socket,
+* in the patterns of protocol, which erases the header and payload of chunk.
+* usage: objs/bench/rss_bench_buffer [loops]
+*/
+#include <rss_core.hpp>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <rss_core_error.hpp>
+#include <rss_core_buffer.hpp>
+
+#include "rss_bench.hpp"
+
+#define BENCH_DEFAULT_LOOPS 100
+// the bytes to read for each loop.
+#define BENCH_BUFFER_SIZE (1024 * 1024)
+
+/**
+* parse the chunks like the protocol, ensure then erase the header and the payload.
+* @return the erased times.
+*/
+static int bench_chunks(RssBuffer* buffer, RssBenchSocket* skt, int header_size, int payload_size, int& ret)
+{
+	int count = 0;
+	int chunk_size = header_size + payload_size;
+
+	for (int i = 0; i + chunk_size <= BENCH_BUFFER_SIZE; i += chunk_size)
+	{
+		if ((ret = buffer->ensure_buffer_bytes(skt, header_size)) != ERROR_SUCCESS)
+		{
+			return count;
+		}
+		buffer->erase(header_size);
+
+		if ((ret = buffer->ensure_buffer_bytes(skt, payload_size)) != ERROR_SUCCESS)
+		{
+			return count;
+		}
+		buffer->erase(payload_size);
+
+		count += 2;
+	}
+
+	return count;
+}
+
+/**
+* fill the buffer with the required bytes then drain in small pieces.
+* @return the erased times.
+*/
+static int bench_fill_drain(RssBuffer* buffer, RssBenchSocket* skt, int fill_size, int piece_size, int& ret)
+{
+	int count = 0;
+
+	for (int i = 0; i + fill_size <= BENCH_BUFFER_SIZE; i += fill_size)
+	{
+		if ((ret = buffer->ensure_buffer_bytes(skt, fill_size)) != ERROR_SUCCESS)
+		{
+			return count;
+		}
+
+		while (buffer->size() > 0)
+		{
+			buffer->erase(rss_min(piece_size, buffer->size()));
+			count++;
+		}
+	}
+
+	return count;
+}
+
+int main(int argc, char** argv)
+{
+	int ret = ERROR_SUCCESS;
+
+	int loops = BENCH_DEFAULT_LOOPS;
+	if (argc > 1)
+	{
+		loops = atoi(argv[1]);
+	}
+	if (loops <= 0)
+	{
+		loops = BENCH_DEFAULT_LOOPS;
+	}
+
+	static char bytes[BENCH_BUFFER_SIZE];
+	memset(bytes, 0, sizeof(bytes));
+
+	RssBenchSocket skt;
+	int64_t starttime = 0;
+	int64_t count = 0;
+
+	// the chunk of audio at the default chunk size, and video at the large chunk size.
+	int chunks[][2] = {{12, 128}, {1, 128}, {12, 4096}, {1, 60000}};
+	for (int i = 0; i < (int)(sizeof(chunks) / sizeof(chunks[0])); i++)
+	{
+		starttime = bench_now_ns();
+		count = 0;
+
+		for (int j = 0; j < loops; j++)
+		{
+			RssBuffer buffer;
+			skt.reset(bytes, BENCH_BUFFER_SIZE);
+
+			count += bench_chunks(&buffer, &skt, chunks[i][0], chunks[i][1], ret);
+			if (ret != ERROR_SUCCESS)
+			{
+				fprintf(stderr, "chunks failed. ret=%d\n", ret);
+				return ret;
+			}
+		}
+
+		char name[64];
+		snprintf(name, sizeof(name), "chunk_%d_%d", chunks[i][0], chunks[i][1]);
+		bench_report("buffer", name, count, bench_now_ns() - starttime, (int64_t)loops * BENCH_BUFFER_SIZE);
+	}
+
+	// the buffer is filled by a large message, then erased by chunks.
+	int drains[][2] = {{65536, 128}, {65536, 4096}};
+	for (int i = 0; i < (int)(sizeof(drains) / sizeof(drains[0])); i++)
+	{
+		starttime = bench_now_ns();
+		count = 0;
+
+		for (int j = 0; j < loops; j++)
+		{
+			RssBuffer buffer;
+			skt.reset(bytes, BENCH_BUFFER_SIZE);
+
+			count += bench_fill_drain(&buffer, &skt, drains[i][0], drains[i][1], ret);
+			if (ret != ERROR_SUCCESS)
+			{
+				fprintf(stderr, "fill drain failed. ret=%d\n", ret);
+				return ret;
+			}
+		}
+
+		char name[64];
+		snprintf(name, sizeof(name), "fill_%d_drain_%d", drains[i][0], drains[i][1]);
+		bench_report("buffer", name, count, bench_now_ns() - starttime, (int64_t)loops * BENCH_BUFFER_SIZE);
+	}
+
+	return ret;
+}
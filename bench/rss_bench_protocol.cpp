@@ -0,0 +1,356 @@
+/**
+* benchmark the chunk serialization of send_message and the chunk parsing
+* of recv_message, over the in-memory socket, across the chunk sizes,
+* and the pack and demux of aggregate message, which is verified by round-trip.
+* usage: objs/bench/rss_bench_protocol [loops]
+* @remark the messages are the interleaved video and audio like the live stream,
+* 		the log is written to stdout which is redirected to /dev/null.
+*/
+#include <rss_core.hpp>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <vector>
+
+#include <rss_core_log.hpp>
+#include <rss_core_error.hpp>
+#include <rss_core_protocol.hpp>
+#include <rss_core_auto_free.hpp>
+
+#include "rss_bench.hpp"
+
+#define BENCH_DEFAULT_LOOPS 1000
+// the messages of each loop, a video follows by 2 audio, about 1s of 1.5Mbps.
+#define BENCH_GOP_MESSAGES 30
+#define BENCH_VIDEO_SIZE 6000
+#define BENCH_AUDIO_SIZE 400
+#define BENCH_STREAM_ID 1
+// the small messages to pack to an aggregate message, the audio and the small video.
+#define BENCH_AGGREGATE_MESSAGES 8
+#define BENCH_AGGREGATE_VIDEO_SIZE 1500
+
+/**
+* create the shared message, the payload starts with the frame type.
+*/
+static RssSharedPtrMessage* bench_create_frame(bool video, int size)
+{
+	// avc inter frame, aac raw.
+	char header = video? 0x27 : 0xaf;
+	return bench_create_message(video, &header, 1, size, BENCH_STREAM_ID);
+}
+
+/**
+* send the messages of loops, one video and two audios for each frame.
+* @bytes output the payload bytes sentout.
+*/
+static int bench_send(RssProtocol* protocol, RssSharedPtrMessage* video, RssSharedPtrMessage* audio, int loops, int64_t& bytes)
+{
+	int ret = ERROR_SUCCESS;
+
+	int32_t timestamp = 0;
+	for (int i = 0; i < loops; i++)
+	{
+		for (int j = 0; j < BENCH_GOP_MESSAGES; j += 3)
+		{
+			RssSharedPtrMessage* msg = video->copy();
+			msg->header.timestamp = timestamp;
+			if ((ret = protocol->send_message(msg)) != ERROR_SUCCESS)
+			{
+				return ret;
+			}
+
+			for (int k = 0; k < 2; k++)
+			{
+				msg = audio->copy();
+				msg->header.timestamp = timestamp + k * 21;
+				if ((ret = protocol->send_message(msg)) != ERROR_SUCCESS)
+				{
+					return ret;
+				}
+			}
+
+			timestamp += 33;
+			bytes += video->size + 2 * audio->size;
+		}
+	}
+
+	return ret;
+}
+
+/**
+* benchmark the send_message at the chunk size.
+*/
+static int bench_chunk_size_send(int chunk_size, RssSharedPtrMessage* video, RssSharedPtrMessage* audio, int loops)
+{
+	int ret = ERROR_SUCCESS;
+
+	RssProtocol protocol(new RssBenchSocket());
+	if ((ret = protocol.send_set_chunk_size(chunk_size)) != ERROR_SUCCESS)
+	{
+		fprintf(stderr, "set chunk size failed. ret=%d\n", ret);
+		return ret;
+	}
+
+	int64_t bytes = 0;
+	int64_t starttime = bench_now_ns();
+
+	if ((ret = bench_send(&protocol, video, audio, loops, bytes)) != ERROR_SUCCESS)
+	{
+		fprintf(stderr, "send message failed. ret=%d\n", ret);
+		return ret;
+	}
+
+	char name[64];
+	snprintf(name, sizeof(name), "send_chunk_%d", chunk_size);
+	bench_report("protocol", name, (int64_t)loops * BENCH_GOP_MESSAGES, bench_now_ns() - starttime, bytes);
+
+	return ret;
+}
+
+/**
+* benchmark the recv_message at the chunk size,
+* the chunks are captured from the send_message.
+*/
+static int bench_chunk_size_recv(int chunk_size, RssSharedPtrMessage* video, RssSharedPtrMessage* audio, int loops)
+{
+	int ret = ERROR_SUCCESS;
+
+	// capture the chunks of a loop, parsed loops times.
+	RssBenchSocket* capture = new RssBenchSocket();
+	capture->set_capture(true);
+
+	RssProtocol sender(capture);
+	if ((ret = sender.send_set_chunk_size(chunk_size)) != ERROR_SUCCESS)
+	{
+		fprintf(stderr, "set chunk size failed. ret=%d\n", ret);
+		return ret;
+	}
+
+	int64_t bytes = 0;
+	if ((ret = bench_send(&sender, video, audio, 1, bytes)) != ERROR_SUCCESS)
+	{
+		fprintf(stderr, "send message failed. ret=%d\n", ret);
+		return ret;
+	}
+	std::string& chunks = capture->get_captured();
+
+	// the protocol is reused, the socket replays the chunks of loop,
+	// which starts with the set chunk size and the fmt0 chunk of each stream.
+	RssBenchSocket* skt = new RssBenchSocket();
+	RssProtocol protocol(skt);
+
+	int64_t elapsed = 0;
+	for (int i = 0; i < loops; i++)
+	{
+		skt->reset(chunks.data(), (int)chunks.length());
+
+		// the set chunk size and the messages.
+		for (int j = 0; j < BENCH_GOP_MESSAGES + 1; j++)
+		{
+			RssCommonMessage* msg = NULL;
+
+			int64_t starttime = bench_now_ns();
+			if ((ret = protocol.recv_message(&msg)) != ERROR_SUCCESS)
+			{
+				fprintf(stderr, "recv message failed. ret=%d\n", ret);
+				return ret;
+			}
+			elapsed += bench_now_ns() - starttime;
+
+			rss_freep(msg);
+		}
+	}
+
+	char name[64];
+	snprintf(name, sizeof(name), "recv_chunk_%d", chunk_size);
+	bench_report("protocol", name, (int64_t)loops * BENCH_GOP_MESSAGES, elapsed, bytes * loops);
+
+	return ret;
+}
+
+/**
+* pack the messages to aggregate, copy to the received message for demux.
+*/
+static int bench_aggregate_pack(RssSharedPtrMessage** msgs, RssCommonMessage* received)
+{
+	int ret = ERROR_SUCCESS;
+
+	RssSharedPtrMessage* aggregate = NULL;
+	if ((ret = rss_rtmp_pack_aggregate(msgs, BENCH_AGGREGATE_MESSAGES, aggregate)) != ERROR_SUCCESS)
+	{
+		return ret;
+	}
+	RssAutoFree(RssSharedPtrMessage, aggregate, false);
+
+	received->header = aggregate->header;
+	received->size = aggregate->size;
+	received->payload = new int8_t[aggregate->size];
+	memcpy(received->payload, aggregate->payload, aggregate->size);
+
+	return ret;
+}
+
+static void bench_free_messages(std::vector<RssCommonMessage*>& msgs)
+{
+	for (int i = 0; i < (int)msgs.size(); i++)
+	{
+		RssCommonMessage* msg = msgs[i];
+		rss_freep(msg);
+	}
+	msgs.clear();
+}
+
+/**
+* the demuxed messages must be same to the packed messages.
+*/
+static int bench_aggregate_verify(RssSharedPtrMessage** msgs, std::vector<RssCommonMessage*>& demuxed)
+{
+	int ret = ERROR_SUCCESS;
+
+	if ((int)demuxed.size() != BENCH_AGGREGATE_MESSAGES)
+	{
+		ret = ERROR_RTMP_AGGREGATE;
+		fprintf(stderr, "aggregate demux %d messages, expect %d. ret=%d\n", (int)demuxed.size(), BENCH_AGGREGATE_MESSAGES, ret);
+		return ret;
+	}
+
+	for (int i = 0; i < BENCH_AGGREGATE_MESSAGES; i++)
+	{
+		RssSharedPtrMessage* expect = msgs[i];
+		RssCommonMessage* msg = demuxed[i];
+
+		if (msg->header.message_type != expect->header.message_type || msg->header.timestamp != expect->header.timestamp
+			|| msg->header.stream_id != expect->header.stream_id || msg->size != expect->size
+			|| memcmp(msg->payload, expect->payload, msg->size) != 0)
+		{
+			ret = ERROR_RTMP_AGGREGATE;
+			fprintf(stderr, "aggregate message %d mismatch, type=%d/%d, timestamp=%d/%d, size=%d/%d. ret=%d\n",
+			        i, msg->header.message_type, expect->header.message_type, msg->header.timestamp,
+			        expect->header.timestamp, msg->size, expect->size, ret);
+			return ret;
+		}
+	}
+
+	return ret;
+}
+
+/**
+* verify the pack and demux by round-trip, then benchmark them.
+*/
+static int bench_aggregate(int loops)
+{
+	int ret = ERROR_SUCCESS;
+
+	RssSharedPtrMessage* msgs[BENCH_AGGREGATE_MESSAGES];
+	int64_t bytes = 0;
+	for (int i = 0; i < BENCH_AGGREGATE_MESSAGES; i++)
+	{
+		bool video = (i % 2) == 1;
+		msgs[i] = bench_create_frame(video, video? BENCH_AGGREGATE_VIDEO_SIZE : BENCH_AUDIO_SIZE);
+		msgs[i]->header.timestamp = i * 21;
+		// distinguish the payloads.
+		msgs[i]->payload[msgs[i]->size - 1] = (int8_t)i;
+		bytes += msgs[i]->size;
+	}
+
+	if (true)
+	{
+		RssCommonMessage received;
+		std::vector<RssCommonMessage*> demuxed;
+
+		if ((ret = bench_aggregate_pack(msgs, &received)) == ERROR_SUCCESS
+			&& (ret = rss_rtmp_demux_aggregate(&received, demuxed)) == ERROR_SUCCESS)
+		{
+			ret = bench_aggregate_verify(msgs, demuxed);
+		}
+		bench_free_messages(demuxed);
+
+		if (ret != ERROR_SUCCESS)
+		{
+			fprintf(stderr, "aggregate round-trip failed. ret=%d\n", ret);
+		}
+	}
+
+	if (ret == ERROR_SUCCESS)
+	{
+		int64_t starttime = bench_now_ns();
+		for (int i = 0; i < loops * BENCH_GOP_MESSAGES && ret == ERROR_SUCCESS; i++)
+		{
+			RssCommonMessage received;
+			ret = bench_aggregate_pack(msgs, &received);
+		}
+		bench_report("protocol", "aggregate_pack", (int64_t)loops * BENCH_GOP_MESSAGES, bench_now_ns() - starttime, bytes * loops * BENCH_GOP_MESSAGES);
+	}
+
+	if (ret == ERROR_SUCCESS)
+	{
+		RssCommonMessage received;
+		bench_aggregate_pack(msgs, &received);
+
+		int64_t starttime = bench_now_ns();
+		for (int i = 0; i < loops * BENCH_GOP_MESSAGES && ret == ERROR_SUCCESS; i++)
+		{
+			std::vector<RssCommonMessage*> demuxed;
+			ret = rss_rtmp_demux_aggregate(&received, demuxed);
+			bench_free_messages(demuxed);
+		}
+		bench_report("protocol", "aggregate_demux", (int64_t)loops * BENCH_GOP_MESSAGES, bench_now_ns() - starttime, bytes * loops * BENCH_GOP_MESSAGES);
+	}
+
+	for (int i = 0; i < BENCH_AGGREGATE_MESSAGES; i++)
+	{
+		rss_freep(msgs[i]);
+	}
+
+	return ret;
+}
+
+int main(int argc, char** argv)
+{
+	int ret = ERROR_SUCCESS;
+
+	int loops = BENCH_DEFAULT_LOOPS;
+	if (argc > 1)
+	{
+		loops = atoi(argv[1]);
+	}
+	if (loops <= 0)
+	{
+		loops = BENCH_DEFAULT_LOOPS;
+	}
+
+	if ((ret = bench_initialize_log()) != ERROR_SUCCESS)
+	{
+		return ret;
+	}
+
+	RssSharedPtrMessage* video = bench_create_frame(true, BENCH_VIDEO_SIZE);
+	RssAutoFree(RssSharedPtrMessage, video, false);
+	RssSharedPtrMessage* audio = bench_create_frame(false, BENCH_AUDIO_SIZE);
+	RssAutoFree(RssSharedPtrMessage, audio, false);
+
+	int chunk_sizes[] = {128, 4096, 60000};
+	for (int i = 0; i < (int)(sizeof(chunk_sizes) / sizeof(int)); i++)
+	{
+		if ((ret = bench_chunk_size_send(chunk_sizes[i], video, audio, loops)) != ERROR_SUCCESS)
+		{
+			return ret;
+		}
+	}
+	for (int i = 0; i < (int)(sizeof(chunk_sizes) / sizeof(int)); i++)
+	{
+		if ((ret = bench_chunk_size_recv(chunk_sizes[i], video, audio, loops)) != ERROR_SUCCESS)
+		{
+			return ret;
+		}
+	}
+
+	if ((ret = bench_aggregate(loops)) != ERROR_SUCCESS)
+	{
+		return ret;
+	}
+
+	return ret;
+}
@@ -0,0 +1,163 @@
+/**
+* benchmark the fan-out of RssSource to the consumers, the dispatch of
+* on_video which copies the shared message to all consumers, and the drain
+* of get_packets like the play clients.
+* usage: objs/bench/rss_bench_source [copies]
+* 		copies, the total messages enqueued to consumers of each case.
+* @remark the log is written to stdout which is redirected to /dev/null.
+*/
+#include <rss_core.hpp>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <vector>
+
+#include <rss_core_log.hpp>
+#include <rss_core_error.hpp>
+#include <rss_core_protocol.hpp>
+#include <rss_core_source.hpp>
+
+#include "rss_bench.hpp"
+
+#define BENCH_DEFAULT_COPIES 2000000
+// the messages queued before the consumers drain, about 1s of video.
+#define BENCH_DRAIN_INTERVAL 32
+#define BENCH_VIDEO_SIZE 6000
+#define BENCH_STREAM_ID 1
+
+/**
+* drain all consumers, free the messages like the play clients.
+*/
+static int bench_drain(std::vector<RssConsumer*>& consumers)
+{
+	int ret = ERROR_SUCCESS;
+
+	std::vector<RssConsumer*>::iterator it;
+	for (it = consumers.begin(); it != consumers.end(); ++it)
+	{
+		RssConsumer* consumer = *it;
+
+		int count = 0;
+		RssSharedPtrMessage** msgs = NULL;
+		if ((ret = consumer->get_packets(0, msgs, count)) != ERROR_SUCCESS)
+		{
+			return ret;
+		}
+
+		for (int i = 0; i < count; i++)
+		{
+			RssSharedPtrMessage* msg = msgs[i];
+			rss_freep(msg);
+		}
+		rss_freepa(msgs);
+	}
+
+	return ret;
+}
+
+/**
+* dispatch the video to the consumers of source, then drain.
+*/
+static int bench_fanout(int nb_consumers, int64_t copies)
+{
+	int ret = ERROR_SUCCESS;
+
+	RssSource* source = new RssSource("127.0.0.1/live/bench");
+
+	std::vector<RssConsumer*> consumers;
+	for (int i = 0; i < nb_consumers; i++)
+	{
+		RssConsumer* consumer = NULL;
+		if ((ret = source->create_consumer(consumer)) != ERROR_SUCCESS)
+		{
+			fprintf(stderr, "create consumer failed. ret=%d\n", ret);
+			return ret;
+		}
+		consumers.push_back(consumer);
+	}
+
+	int messages = (int)rss_max(copies / nb_consumers, (int64_t)BENCH_DRAIN_INTERVAL);
+	int64_t dispatch_ns = 0;
+	int64_t drain_ns = 0;
+
+	for (int i = 0; i < messages; i++)
+	{
+		RssCommonMessage video;
+		video.header.initialize_video(BENCH_VIDEO_SIZE, i * 33, BENCH_STREAM_ID);
+		video.payload = new int8_t[BENCH_VIDEO_SIZE];
+		video.size = BENCH_VIDEO_SIZE;
+		memset(video.payload, 0, BENCH_VIDEO_SIZE);
+		// avc inter frame.
+		video.payload[0] = 0x27;
+
+		int64_t starttime = bench_now_ns();
+		if ((ret = source->on_video(&video)) != ERROR_SUCCESS)
+		{
+			fprintf(stderr, "dispatch video failed. ret=%d\n", ret);
+			return ret;
+		}
+		dispatch_ns += bench_now_ns() - starttime;
+
+		if ((i + 1) % BENCH_DRAIN_INTERVAL == 0 || i == messages - 1)
+		{
+			starttime = bench_now_ns();
+			if ((ret = bench_drain(consumers)) != ERROR_SUCCESS)
+			{
+				fprintf(stderr, "drain consumers failed. ret=%d\n", ret);
+				return ret;
+			}
+			drain_ns += bench_now_ns() - starttime;
+		}
+	}
+
+	int64_t nb_copies = (int64_t)messages * nb_consumers;
+
+	char name[64];
+	snprintf(name, sizeof(name), "dispatch_%d", nb_consumers);
+	bench_report("source", name, nb_copies, dispatch_ns, 0);
+	snprintf(name, sizeof(name), "drain_%d", nb_consumers);
+	bench_report("source", name, nb_copies, drain_ns, 0);
+
+	// the consumer is removed from source when freed.
+	for (int i = (int)consumers.size() - 1; i >= 0; i--)
+	{
+		RssConsumer* consumer = consumers[i];
+		rss_freep(consumer);
+	}
+	rss_freep(source);
+
+	return ret;
+}
+
+int main(int argc, char** argv)
+{
+	int ret = ERROR_SUCCESS;
+
+	int64_t copies = BENCH_DEFAULT_COPIES;
+	if (argc > 1)
+	{
+		copies = atoll(argv[1]);
+	}
+	if (copies <= 0)
+	{
+		copies = BENCH_DEFAULT_COPIES;
+	}
+
+	if ((ret = bench_initialize_log()) != ERROR_SUCCESS)
+	{
+		return ret;
+	}
+
+	int fanouts[] = {1, 100, 10000};
+	for (int i = 0; i < (int)(sizeof(fanouts) / sizeof(int)); i++)
+	{
+		if ((ret = bench_fanout(fanouts[i], copies)) != ERROR_SUCCESS)
+		{
+			return ret;
+		}
+	}
+
+	return ret;
+}
@@ -0,0 +1,268 @@
+/**
+* benchmark the per-field cost of stream read/write,
+* the legacy virtual stream versus the inline RssStreamBase.
+* usage: objs/bench/rss_bench_stream [loops]
+* @remark the legacy stream is a copy of the virtual RssStream before
+* 		it's inlined, and called over the base pointer like other modules.
+*/
+#include <rss_core.hpp>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include <rss_core_log.hpp>
+#include <rss_core_error.hpp>
+#include <rss_core_stream.hpp>
+
+#include "rss_bench.hpp"
+
+#define BENCH_DEFAULT_LOOPS 1000
+// the bytes of fields, 1+2+4+8 bytes per group.
+#define BENCH_STREAM_SIZE (15 * 4096)
+
+/**
+* the legacy virtual stream.
+*/
+class RssLegacyStream
+{
+private:
+	char* p;
+	char* pp;
+	char* bytes;
+	int size;
+public:
+	RssLegacyStream();
+	virtual ~RssLegacyStream();
+public:
+	virtual int initialize(char* _bytes, int _size);
+	virtual bool empty();
+	virtual bool require(int required_size);
+public:
+	virtual int8_t read_1bytes();
+	virtual int16_t read_2bytes();
+	virtual int32_t read_4bytes();
+	virtual int64_t read_8bytes();
+public:
+	virtual void write_1bytes(int8_t value);
+	virtual void write_2bytes(int16_t value);
+	virtual void write_4bytes(int32_t value);
+	virtual void write_8bytes(int64_t value);
+};
+
+RssLegacyStream::RssLegacyStream()
+{
+	p = pp = bytes = NULL;
+	size = 0;
+}
+
+RssLegacyStream::~RssLegacyStream()
+{
+}
+
+int RssLegacyStream::initialize(char* _bytes, int _size)
+{
+	size = _size;
+	p = bytes = _bytes;
+	return ERROR_SUCCESS;
+}
+
+bool RssLegacyStream::empty()
+{
+	return !p || !bytes || (p >= bytes + size);
+}
+
+bool RssLegacyStream::require(int required_size)
+{
+	return !empty() && (required_size <= bytes + size - p);
+}
+
+int8_t RssLegacyStream::read_1bytes()
+{
+	rss_assert(require(1));
+
+	return (int8_t)*p++;
+}
+
+int16_t RssLegacyStream::read_2bytes()
+{
+	rss_assert(require(2));
+
+	int16_t value;
+	pp = (char*)&value;
+	pp[1] = *p++;
+	pp[0] = *p++;
+
+	return value;
+}
+
+int32_t RssLegacyStream::read_4bytes()
+{
+	rss_assert(require(4));
+
+	int32_t value;
+	pp = (char*)&value;
+	pp[3] = *p++;
+	pp[2] = *p++;
+	pp[1] = *p++;
+	pp[0] = *p++;
+
+	return value;
+}
+
+int64_t RssLegacyStream::read_8bytes()
+{
+	rss_assert(require(8));
+
+	int64_t value;
+	pp = (char*)&value;
+	pp[7] = *p++;
+	pp[6] = *p++;
+	pp[5] = *p++;
+	pp[4] = *p++;
+	pp[3] = *p++;
+	pp[2] = *p++;
+	pp[1] = *p++;
+	pp[0] = *p++;
+
+	return value;
+}
+
+void RssLegacyStream::write_1bytes(int8_t value)
+{
+	rss_assert(require(1));
+
+	*p++ = value;
+}
+
+void RssLegacyStream::write_2bytes(int16_t value)
+{
+	rss_assert(require(2));
+
+	pp = (char*)&value;
+	*p++ = pp[1];
+	*p++ = pp[0];
+}
+
+void RssLegacyStream::write_4bytes(int32_t value)
+{
+	rss_assert(require(4));
+
+	pp = (char*)&value;
+	*p++ = pp[3];
+	*p++ = pp[2];
+	*p++ = pp[1];
+	*p++ = pp[0];
+}
+
+void RssLegacyStream::write_8bytes(int64_t value)
+{
+	rss_assert(require(8));
+
+	pp = (char*)&value;
+	*p++ = pp[7];
+	*p++ = pp[6];
+	*p++ = pp[5];
+	*p++ = pp[4];
+	*p++ = pp[3];
+	*p++ = pp[2];
+	*p++ = pp[1];
+	*p++ = pp[0];
+}
+
+/**
+* the legacy stream is called over pointer from other translation unit,
+* never let the compiler know the dynamic type.
+*/
+__attribute__((noinline)) static RssLegacyStream* bench_create_legacy()
+{
+	return new RssLegacyStream();
+}
+
+/**
+* decode the fields like the protocol, require then read.
+*/
+template<class T>
+static int64_t bench_read(T* stream, char* bytes, int size)
+{
+	int64_t sum = 0;
+
+	stream->initialize(bytes, size);
+	while (stream->require(15))
+	{
+		sum += stream->read_1bytes();
+		sum += stream->read_2bytes();
+		sum += stream->read_4bytes();
+		sum += stream->read_8bytes();
+	}
+
+	return sum;
+}
+
+template<class T>
+static void bench_write(T* stream, char* bytes, int size)
+{
+	stream->initialize(bytes, size);
+	for (int i = 0; stream->require(15); i++)
+	{
+		stream->write_1bytes((int8_t)i);
+		stream->write_2bytes((int16_t)i);
+		stream->write_4bytes(i);
+		stream->write_8bytes(i);
+	}
+}
+
+template<class T>
+static int bench_run(const char* name, T* stream, char* bytes, int loops)
+{
+	int64_t fields = (int64_t)loops * (BENCH_STREAM_SIZE / 15) * 4;
+	int64_t starttime = bench_now_ns();
+
+	for (int i = 0; i < loops; i++)
+	{
+		bench_write(stream, bytes, BENCH_STREAM_SIZE);
+	}
+
+	std::string write_name = std::string(name) + "_write";
+	bench_report("stream", write_name.c_str(), fields, bench_now_ns() - starttime, (int64_t)loops * BENCH_STREAM_SIZE);
+
+	volatile int64_t sum = 0;
+	starttime = bench_now_ns();
+
+	for (int i = 0; i < loops; i++)
+	{
+		sum += bench_read(stream, bytes, BENCH_STREAM_SIZE);
+	}
+
+	std::string read_name = std::string(name) + "_read";
+	bench_report("stream", read_name.c_str(), fields, bench_now_ns() - starttime, (int64_t)loops * BENCH_STREAM_SIZE);
+
+	return (int)sum;
+}
+
+int main(int argc, char** argv)
+{
+	int loops = BENCH_DEFAULT_LOOPS;
+	if (argc > 1)
+	{
+		loops = atoi(argv[1]);
+	}
+	if (loops <= 0)
+	{
+		loops = BENCH_DEFAULT_LOOPS;
+	}
+
+	static char bytes[BENCH_STREAM_SIZE];
+
+	RssLegacyStream* legacy = bench_create_legacy();
+	bench_run("legacy_virtual", legacy, bytes, loops);
+	rss_freep(legacy);
+
+	RssStream checked;
+	bench_run("inline_assert", &checked, bytes, loops);
+
+	RssStreamBase<RssStreamNoCheckPolicy> nocheck;
+	bench_run("inline_nocheck", &nocheck, bytes, loops);
+
+	return 0;
+}
@@ -10,9 +10,57 @@
 #include <string>
 #include <vector>
 
-class RssStream;
+#include <rss_core_stream.hpp>
+
 class RssAmf0Object;
 
+/**
+* the arena owns the amf0 values of a decoded packet,
+* all values are freed in one step when arena destroyed.
+* @see RssAmf0ArenaScope, which alloc the amf0 values from arena.
+*/
+class RssAmf0Arena
+{
+private:
+	std::vector<char*> blocks;
+	char* p;
+	int left;
+public:
+	RssAmf0Arena();
+	virtual ~RssAmf0Arena();
+public:
+	virtual void* allocate(size_t size);
+};
+
+/**
+* decode the amf0 strings and property names as views in scope,
+* which point to the bytes of stream and never copy.
+* @remark user must keep the bytes alive when use the decoded values,
+* 		for instance, the payload of message.
+*/
+class RssAmf0ViewScope
+{
+private:
+	bool previous;
+public:
+	RssAmf0ViewScope();
+	virtual ~RssAmf0ViewScope();
+};
+
+/**
+* the amf0 values new in scope are allocated from the arena,
+* and allocated from heap when not in any scope.
+* @remark the st never switch thread when decode, so the scope is global.
+*/
+class RssAmf0ArenaScope
+{
+private:
+	RssAmf0Arena* previous;
+public:
+	RssAmf0ArenaScope(RssAmf0Arena* arena);
+	virtual ~RssAmf0ArenaScope();
+};
+
 /**
 * any amf0 value.
 * 2.1 Types Overview
@@ -28,6 +76,13 @@ struct RssAmf0Any
 	RssAmf0Any();
 	virtual ~RssAmf0Any();
 
+	/**
+	* alloc from the arena of current scope, or heap when not in scope.
+	* @remark delete never free the memory of arena, the arena free it.
+	*/
+	static void* operator new(size_t size);
+	static void operator delete(void* p);
+
 	virtual bool is_string();
 	virtual bool is_boolean();
 	virtual bool is_number();
@@ -46,10 +101,29 @@ struct RssAmf0Any
 */
 struct RssAmf0String : public RssAmf0Any
 {
+private:
+	// the view to the decoded bytes, see RssAmf0ViewScope.
+	RssStringView view;
+	bool is_view;
+public:
+	/**
+	* the string value, empty when decoded as view,
+	* use get_view() or to_str() to read the string.
+	*/
 	std::string value;
 
 	RssAmf0String(const char* _value = NULL);
 	virtual ~RssAmf0String();
+
+	/**
+	* get the view of string, never copy.
+	*/
+	virtual RssStringView get_view();
+	virtual std::string to_str();
+	/**
+	* set the string to view the bytes, user must keep the bytes alive.
+	*/
+	virtual void set_view(const RssStringView& v);
 };
 
 /**
@@ -125,21 +199,45 @@ struct RssAmf0ObjectEOF : public RssAmf0Any
 struct RssUnSortedHashtable
 {
 private:
-	typedef std::pair<std::string, RssAmf0Any*> RssObjectPropertyType;
+	struct RssObjectPropertyType
+	{
+		RssStringView key;
+		// the copied key bytes, NULL if key is view.
+		char* owned_key;
+		RssAmf0Any* value;
+	};
 	std::vector<RssObjectPropertyType> properties;
 public:
 	RssUnSortedHashtable();
 	virtual ~RssUnSortedHashtable();
 
 	virtual int size();
+	/**
+	* clear the properties, the values never freed.
+	*/
 	virtual void clear();
 	virtual std::string key_at(int index);
+	virtual RssStringView key_view_at(int index);
 	virtual RssAmf0Any* value_at(int index);
-	virtual void set(std::string key, RssAmf0Any* value);
-
-	virtual RssAmf0Any* get_property(std::string name);
-	virtual RssAmf0Any* ensure_property_string(std::string name);
-	virtual RssAmf0Any* ensure_property_number(std::string name);
+	/**
+	* set the property, copy the key, replace the value when the key exists.
+	*/
+	virtual void set(const RssStringView& key, RssAmf0Any* value);
+	/**
+	* set the property, the key is view, user must keep the bytes alive.
+	*/
+	virtual void set_view(const RssStringView& key, RssAmf0Any* value);
+
+	virtual RssAmf0Any* get_property(const RssStringView& name);
+	virtual RssAmf0Any* ensure_property_string(const RssStringView& name);
+	virtual RssAmf0Any* ensure_property_number(const RssStringView& name);
+private:
+	/**
+	* replace the value of the existing key in place, the existing key is retained,
+	* for the key maybe the view of it.
+	* @return whether the key exists.
+	*/
+	virtual bool replace(const RssStringView& key, RssAmf0Any* value);
 };
 
 /**
@@ -159,12 +257,14 @@ public:
 
 	virtual int size();
 	virtual std::string key_at(int index);
+	virtual RssStringView key_view_at(int index);
 	virtual RssAmf0Any* value_at(int index);
-	virtual void set(std::string key, RssAmf0Any* value);
+	virtual void set(const RssStringView& key, RssAmf0Any* value);
+	virtual void set_view(const RssStringView& key, RssAmf0Any* value);
 
-	virtual RssAmf0Any* get_property(std::string name);
-	virtual RssAmf0Any* ensure_property_string(std::string name);
-	virtual RssAmf0Any* ensure_property_number(std::string name);
+	virtual RssAmf0Any* get_property(const RssStringView& name);
+	virtual RssAmf0Any* ensure_property_string(const RssStringView& name);
+	virtual RssAmf0Any* ensure_property_number(const RssStringView& name);
 };
 
 /**
@@ -187,11 +287,13 @@ public:
 	virtual int size();
 	virtual void clear();
 	virtual std::string key_at(int index);
+	virtual RssStringView key_view_at(int index);
 	virtual RssAmf0Any* value_at(int index);
-	virtual void set(std::string key, RssAmf0Any* value);
+	virtual void set(const RssStringView& key, RssAmf0Any* value);
+	virtual void set_view(const RssStringView& key, RssAmf0Any* value);
 
-	virtual RssAmf0Any* get_property(std::string name);
-	virtual RssAmf0Any* ensure_property_string(std::string name);
+	virtual RssAmf0Any* get_property(const RssStringView& name);
+	virtual RssAmf0Any* ensure_property_string(const RssStringView& name);
 };
 
 /**
@@ -203,7 +305,8 @@ public:
 * @remark only support UTF8-1 char.
 */
 extern int rss_amf0_read_utf8(RssStream* stream, std::string& value);
-extern int rss_amf0_write_utf8(RssStream* stream, std::string value);
+extern int rss_amf0_read_utf8_view(RssStream* stream, RssStringView& value);
+extern int rss_amf0_write_utf8(RssStream* stream, const RssStringView& value);
 
 /**
 * read amf0 string from stream.
@@ -211,7 +314,13 @@ extern int rss_amf0_write_utf8(RssStream* stream, std::string value);
 * string-type = string-marker UTF-8
 */
 extern int rss_amf0_read_string(RssStream* stream, std::string& value);
-extern int rss_amf0_write_string(RssStream* stream, std::string value);
+extern int rss_amf0_write_string(RssStream* stream, const RssStringView& value);
+/**
+* peek the amf0 string in stream, never copy the string.
+* @value point to the string bytes in stream, not terminated by NULL.
+* @value_size the length of string bytes.
+*/
+extern int rss_amf0_peek_string(RssStream* stream, char*& value, int& value_size);
 
 /**
 * read amf0 boolean from stream.
@@ -270,8 +379,8 @@ extern int rss_amf0_write_ecma_array(RssStream* stream, RssARssAmf0EcmaArray* va
 /**
 * get amf0 objects size.
 */
-extern int rss_amf0_get_utf8_size(std::string value);
-extern int rss_amf0_get_string_size(std::string value);
+extern int rss_amf0_get_utf8_size(const RssStringView& value);
+extern int rss_amf0_get_string_size(const RssStringView& value);
 extern int rss_amf0_get_number_size();
 extern int rss_amf0_get_null_size();
 extern int rss_amf0_get_undefined_size();
@@ -279,6 +388,82 @@ extern int rss_amf0_get_boolean_size();
 extern int rss_amf0_get_object_size(RssAmf0Object* obj);
 extern int rss_amf0_get_ecma_array_size(RssARssAmf0EcmaArray* arr);
 
+/**
+* the event of amf0 reader, see RssAmf0Reader.
+*/
+enum RssAmf0Event
+{
+	// no more value in stream.
+	RssAmf0EventEOF = 0,
+	RssAmf0EventNumber,
+	RssAmf0EventBoolean,
+	RssAmf0EventString,
+	RssAmf0EventNull,
+	RssAmf0EventUndefined,
+	// the object begin, followed by properties(key and value) util end.
+	RssAmf0EventBeginObject,
+	// the ecma array begin, the count is set.
+	RssAmf0EventBeginEcmaArray,
+	// the property name of object or ecma array, followed by the value.
+	RssAmf0EventKey,
+	// the object or ecma array end.
+	RssAmf0EventEnd,
+};
+
+/**
+* the cursor to read amf0 from stream, never create any amf0 value,
+* for the handler which only requires some fields of packet.
+* for example, to read the tcUrl from the connect command object:
+* 		next() BeginObject, next() Key, next() String, ..., next() End
+* @remark the string and key are views of the stream bytes.
+*/
+class RssAmf0Reader
+{
+private:
+	RssStream* stream;
+	// the depth of object and ecma array.
+	int level;
+	// whether the property name is read, expect the property value.
+	bool key_read;
+public:
+	RssAmf0Event event;
+	// the value of event Key and String.
+	RssStringView str;
+	// the value of event Number.
+	double number;
+	// the value of event Boolean.
+	bool boolean;
+	// the count of event BeginEcmaArray.
+	int32_t count;
+public:
+	RssAmf0Reader(RssStream* _stream);
+	virtual ~RssAmf0Reader();
+public:
+	/**
+	* read the next event from stream.
+	*/
+	virtual int next();
+	/**
+	* skip the current value. for BeginObject/BeginEcmaArray, read util the End,
+	* for Key, read and skip the value of property.
+	*/
+	virtual int skip();
+	/**
+	* the depth of object and ecma array, 0 for top level.
+	*/
+	virtual int depth();
+};
+
+/**
+* set the string property of the object or ecma array in bytes,
+* never decode the values, only copy the bytes of other properties.
+* the property is replaced if exists, or appended, and the count of ecma array is fixed.
+* @stream the stream at the marker of object or ecma array, which must be the last value.
+* @buffer the buffer to write the spliced object or ecma array to.
+* @return error if the bytes is not a valid object or ecma array.
+*/
+extern int rss_amf0_splice_string_property(RssStream* stream, const RssStringView& name, const RssStringView& value, RssEncodeBuffer* buffer);
+
 /**
 * convert the any to specified object.
 * @return T*, the converted object. never NULL.
@@ -0,0 +1,53 @@
+#ifndef RSS_CORE_API_HPP
+#define RSS_CORE_API_HPP
+
+/*
+#include <rss_core_api.hpp>
+*/
+
+#include <rss_core.hpp>
+
+#include <string>
+#include <sstream>
+
+#include <rss_core_conn.hpp>
+
+class RssSocket;
+
+/**
+* the http api path of stats, in json and prometheus text.
+*/
+#define RSS_API_PATH_STATS "/api/v1/stats"
+#define RSS_API_PATH_METRICS "/metrics"
+
+/**
+* the HTTP/1.1 api connection, serve the stats of server, sources and clients.
+* GET /api/v1/stats, the stats in json.
+* GET /metrics, the stats in prometheus text format.
+* @remark the stats are updated incrementally by the clients and sources,
+* 		the api only collects them in O(objects), never blocks the media.
+*/
+class RssApiConnection : public RssConnection
+{
+private:
+	RssSocket* skt;
+	// the received bytes, may contains the next pipelined request.
+	std::string buffer;
+public:
+	RssApiConnection(RssServer* rss_server, st_netfd_t client_stfd);
+	virtual ~RssApiConnection();
+protected:
+	virtual int do_cycle();
+	virtual void remove();
+private:
+	/**
+	* read the request header, the body is not supported.
+	* @keep_alive whether keep alive, default true for HTTP/1.1.
+	*/
+	virtual int read_request(std::string& method, std::string& path, bool& keep_alive);
+	virtual int response(int status, const char* content_type, const std::string& body, bool keep_alive);
+	virtual void dump_json(std::stringstream& ss);
+	virtual void dump_prometheus(std::stringstream& ss);
+};
+
+#endif
@@ -8,11 +8,33 @@
 #include <rss_core.hpp>
 
 #include <rss_core_conn.hpp>
+#include <rss_core_protocol.hpp>
+#include <rss_core_rtmp.hpp>
+
+/**
+* the env var to pack the small audio and video messages to aggregate message
+* for play clients, for instance:
+* 		RSS_AGGREGATE_EGRESS=1 ./rtmp_server 1935
+* @remark it is a startup setting, the env of process never changes when running,
+* 		and passes to the new binary when hot upgrade, restart to switch it.
+*/
+#define RSS_AGGREGATE_EGRESS_ENV "RSS_AGGREGATE_EGRESS"
 
 class RssRtmp;
 class RssRequest;
 class RssResponse;
 class RssSource;
+class RssClient;
+class RssCommonMessage;
+class RssSharedPtrMessage;
+class RssConsumer;
+class RssKbps;
+
+/**
+* the handler for the AMF0/AMF3 command or data message when publish.
+* @unpublished, set to true when client unpublish the stream.
+*/
+typedef int (RssClient::*RssPublishHandler)(RssSource* source, RssCommonMessage* msg, bool& unpublished);
 
 /**
 * the client provides the main logic control for RTMP clients.
@@ -24,14 +46,30 @@ private:
 	RssRequest* req;
 	RssResponse* res;
 	RssRtmp* rtmp;
+	// the publish handlers, index by the peeked RssCommandId.
+	RssPublishHandler publish_handlers[RssCommandMax];
+	RssClientType type;
+	// the consumer of play client.
+	RssConsumer* consumer;
+	RssKbps* recv_kbps;
+	RssKbps* send_kbps;
 public:
 	RssClient(RssServer* rss_server, st_netfd_t client_stfd);
 	virtual ~RssClient();
+public:
+	virtual void stat(RssConnStat& stat);
 protected:
 	virtual int do_cycle();
 private:
 	virtual int streaming_play(RssSource* source);
+	/**
+	* pack the consecutive small audio and video messages to an aggregate message and send it.
+	* @packed the number of messages packed and freed, 0 if not packed.
+	*/
+	virtual int send_aggregate(RssSharedPtrMessage** msgs, int count, int& packed);
 	virtual int streaming_publish(RssSource* source);
+	virtual int on_publish_metadata(RssSource* source, RssCommonMessage* msg, bool& unpublished);
+	virtual int on_publish_unpublish(RssSource* source, RssCommonMessage* msg, bool& unpublished);
 	virtual int get_peer_ip();
 };
 
@@ -0,0 +1,59 @@
+#ifndef RSS_CORE_CLOCK_HPP
+#define RSS_CORE_CLOCK_HPP
+
+/*
+#include <rss_core_clock.hpp>
+*/
+
+#include <rss_core.hpp>
+
+/**
+* the coarse clock of process, the time and formated date are cached,
+* and updated by the clock st-thread about every 1ms, so the logs, reports
+* and timestamps get the time without syscall.
+* @remark when the clock thread not started, for instance, the tools,
+* 		the clock is updated when get the time.
+*/
+class RssClock
+{
+private:
+	static bool started;
+	// the cached time in ms.
+	static int64_t now_ms;
+	// the second of the cached date, the ms is spliced in each update.
+	static int64_t date_second;
+	static char date[];
+	static int date_ms_offset;
+	// the max lag of the clock thread wakeup, the load of st scheduler.
+	static int64_t max_lag_us;
+public:
+	/**
+	* start the clock st-thread, invoke once after st_init.
+	*/
+	static int start();
+	/**
+	* update the cached time and date, the date is formated once per second.
+	*/
+	static void update();
+	/**
+	* get the cached time in ms.
+	*/
+	static int64_t time_ms();
+	/**
+	* get the cached date, for example, 2013-10-18 09:20:15.083
+	*/
+	static const char* format_date();
+	/**
+	* get and reset the max lag in us, that is the clock thread wakeup later
+	* than expected, for the st-threads run too long without switch.
+	*/
+	static int64_t reset_max_lag();
+	/**
+	* get the monotonic time in us, not cached, for the latency.
+	*/
+	static int64_t now_us();
+private:
+	static void* clock_thread(void* arg);
+};
+
+#endif
@@ -10,18 +10,30 @@
 #include <st.h>
 
 class RssServer;
+class RssConnStat;
 class RssConnection
 {
 protected:
 	RssServer* server;
 	st_netfd_t stfd;
+	// the log id of conn, and the time created.
+	int id;
+	int64_t create_time;
 public:
 	RssConnection(RssServer* rss_server, st_netfd_t client_stfd);
 	virtual ~RssConnection();
 public:
 	virtual int start();
+	/**
+	* get the stat of conn, the subclass fill the bytes and role.
+	*/
+	virtual void stat(RssConnStat& stat);
 protected:
 	virtual int do_cycle() = 0;
+	/**
+	* when cycle done, remove from server, which frees the conn.
+	*/
+	virtual void remove();
 private:
 	virtual void cycle();
 	static void* cycle_thread(void* arg);
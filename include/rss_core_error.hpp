@@ -14,6 +14,8 @@
 #define ERROR_ST_OPEN_SOCKET			102
 #define ERROR_ST_CREATE_LISTEN_THREAD	103
 #define ERROR_ST_CREATE_CYCLE_THREAD	104
+#define ERROR_ST_CREATE_CLOCK_THREAD	105
+#define ERROR_ST_CREATE_API_THREAD		106
 
 #define ERROR_SOCKET_CREATE 			200
 #define ERROR_SOCKET_SETREUSE 			201
@@ -27,6 +29,7 @@
 #define ERROR_SOCKET_WRITE				209
 #define ERROR_SOCKET_WAIT				210
 #define ERROR_SOCKET_TIMEOUT			211
+#define ERROR_SOCKET_CONNECT			212
 
 #define ERROR_RTMP_PLAIN_REQUIRED		300
 #define ERROR_RTMP_CHUNK_START			301
@@ -39,10 +42,19 @@
 #define ERROR_RTMP_MESSAGE_ENCODE		308
 #define ERROR_RTMP_AMF0_ENCODE			309
 #define ERROR_RTMP_CHUNK_SIZE			310
+#define ERROR_RTMP_CHUNK_STREAMS		311
+#define ERROR_RTMP_AGGREGATE			312
+#define ERROR_RTMP_RESPONSE				313
 
 #define ERROR_SYSTEM_STREAM_INIT		400
 #define ERROR_SYSTEM_PACKET_INVALID		401
 #define ERROR_SYSTEM_CLIENT_INVALID		402
 #define ERROR_SYSTEM_ASSERT_FAILED		403
+#define ERROR_SYSTEM_SIGNAL_INIT		404
+#define ERROR_SYSTEM_UPGRADE			405
+#define ERROR_SYSTEM_LOG_INIT			406
+
+#define ERROR_HTTP_PARSE_REQUEST		500
+#define ERROR_HTTP_REQUEST_TOO_LARGE	501
 
 #endif
\ No newline at end of file
@@ -19,8 +19,21 @@ public:
 	ILogContext();
 	virtual ~ILogContext();
 public:
+	/**
+	* generate the id for current st-thread, reset the context.
+	*/
 	virtual void generate_id() = 0;
 	virtual int get_id() = 0;
+	/**
+	* set the context of current st-thread, which is printed in each log line.
+	*/
+	virtual void set_ip(const char* ip) = 0;
+	virtual void set_role(const char* role) = 0;
+	virtual void set_stream(const char* stream) = 0;
+	/**
+	* format the context of current st-thread, for example, 12][127.0.0.1][play][live/livestream
+	*/
+	virtual const char* format_context() = 0;
 public:
 	virtual const char* format_time() = 0;
 };
@@ -28,44 +41,161 @@ public:
 // user must implements the LogContext and define a global instance.
 extern ILogContext* log_context;
 
+// the writer of log lines.
+class ILogWriter
+{
+public:
+	ILogWriter();
+	virtual ~ILogWriter();
+public:
+	/**
+	* open the log file and start the writer.
+	* @file the log file to append to, NULL to write to stdout.
+	*/
+	virtual int initialize(const char* file) = 0;
+	/**
+	* format the log line and write it.
+	* @function the function name, NULL to ignore.
+	* @print_errno whether append the errno to line.
+	*/
+	virtual void write(const char* level, const char* function, bool print_errno, const char* fmt, ...)
+		__attribute__((format(printf, 5, 6))) = 0;
+	/**
+	* wait for the lines written to file.
+	*/
+	virtual void flush() = 0;
+	/**
+	* get the total dropped lines.
+	*/
+	virtual int64_t get_dropped() = 0;
+};
+
+// user must implements the LogWriter and define a global instance.
+extern ILogWriter* log_writer;
+
+// append mode, for the old and new binary write the same log when hot upgrade.
 #if 1
-#define log_redir() freopen("log","w",stdout);
+#define log_redir() log_writer->initialize("log")
 #endif
 
 #if 0
-#define log_redir()
+#define log_redir() log_writer->initialize(NULL)
 #endif
 
+/**
+* the log level, the line is written when its level >= the level of subsystem.
+*/
+enum RssLogLevel
+{
+	RssLogVerbose = 0,
+	RssLogInfo,
+	RssLogTrace,
+	RssLogWarn,
+	RssLogError,
+	RssLogDisabled,
+};
+
+/**
+* the log subsystem, each source file defines its RSS_LOG_SUBSYSTEM
+* before any include, the default is the server.
+*/
+enum RssLogSubsystem
+{
+	RssLogSubsystemServer = 0,
+	RssLogSubsystemProtocol,
+	RssLogSubsystemRtmp,
+	RssLogSubsystemClient,
+	RssLogSubsystemSource,
+	RssLogSubsystemMax,
+};
+
+#ifndef RSS_LOG_SUBSYSTEM
+	#define RSS_LOG_SUBSYSTEM RssLogSubsystemServer
+#endif
+
+// the default level of all subsystems.
+#define RSS_LOG_DEFAULT_LEVEL RssLogTrace
+// the file of levels, reload when SIGHUP, see rss_log_reload().
+#define RSS_LOG_LEVEL_FILE "log.level"
+
+// the runtime level of subsystems, index by RssLogSubsystem.
+extern int8_t rss_log_levels[RssLogSubsystemMax];
+
+/**
+* reset the levels to default, then load the levels from file.
+* each line is subsystem=level, for instance, "protocol=verbose",
+* the subsystem is server, protocol, rtmp, client, source or all,
+* the level is verbose, info, trace, warn, error or disabled.
+* @remark the levels are default when file not exists.
+*/
+extern int rss_log_reload(const char* file);
+
+/**
+* limit the lines of a log site per second, for the per chunk or message sites.
+*/
+#define RSS_LOG_LIMIT_PER_SECOND 10
+class RssLogLimiter
+{
+private:
+	int64_t second;
+	int nb_lines;
+	int nb_suppressed;
+public:
+	RssLogLimiter();
+	/**
+	* whether the line is allowed in current second,
+	* write the suppressed lines of the previous seconds when allowed.
+	*/
+	bool allow(const char* level, const char* function);
+};
+
 // donot print method
 #if 0
-#define rss_verbose(msg, ...) printf("[%s][%d][verbs] ", log_context->format_time(), log_context->get_id());printf(msg, ##__VA_ARGS__);printf("\n")
-#define rss_info(msg, ...)    printf("[%s][%d][infos] ", log_context->format_time(), log_context->get_id());printf(msg, ##__VA_ARGS__);printf("\n")
-#define rss_trace(msg, ...)   printf("[%s][%d][trace] ", log_context->format_time(), log_context->get_id());printf(msg, ##__VA_ARGS__);printf("\n")
-#define rss_warn(msg, ...)    printf("[%s][%d][warns] ", log_context->format_time(), log_context->get_id());printf(msg, ##__VA_ARGS__);printf(" errno=%d(%s)", errno, strerror(errno));printf("\n")
-#define rss_error(msg, ...)   printf("[%s][%d][error] ", log_context->format_time(), log_context->get_id());printf(msg, ##__VA_ARGS__);printf(" errno=%d(%s)", errno, strerror(errno));printf("\n")
+	#define RSS_LOG_FUNCTION NULL
 // use __FUNCTION__ to print c method
 #elif 1
-#define rss_verbose(msg, ...) printf("[%s][%d][verbs][%s] ", log_context->format_time(), log_context->get_id(), __FUNCTION__);printf(msg, ##__VA_ARGS__);printf("\n")
-#define rss_info(msg, ...)    printf("[%s][%d][infos][%s] ", log_context->format_time(), log_context->get_id(), __FUNCTION__);printf(msg, ##__VA_ARGS__);printf("\n")
-#define rss_trace(msg, ...)   printf("[%s][%d][trace][%s] ", log_context->format_time(), log_context->get_id(), __FUNCTION__);printf(msg, ##__VA_ARGS__);printf("\n")
-#define rss_warn(msg, ...)    printf("[%s][%d][warns][%s] ", log_context->format_time(), log_context->get_id(), __FUNCTION__);printf(msg, ##__VA_ARGS__);printf(" errno=%d(%s)", errno, strerror(errno));printf("\n")
-#define rss_error(msg, ...)   printf("[%s][%d][error][%s] ", log_context->format_time(), log_context->get_id(), __FUNCTION__);printf(msg, ##__VA_ARGS__);printf(" errno=%d(%s)", errno, strerror(errno));printf("\n")
+	#define RSS_LOG_FUNCTION __FUNCTION__
 // use __PRETTY_FUNCTION__ to print c++ class:method
 #else
-#define rss_verbose(msg, ...) printf("[%s][%d][verbs][%s] ", log_context->format_time(), log_context->get_id(), __PRETTY_FUNCTION__);printf(msg, ##__VA_ARGS__);printf("\n")
-#define rss_info(msg, ...)    printf("[%s][%d][infos][%s] ", log_context->format_time(), log_context->get_id(), __PRETTY_FUNCTION__);printf(msg, ##__VA_ARGS__);printf("\n")
-#define rss_trace(msg, ...)   printf("[%s][%d][trace][%s] ", log_context->format_time(), log_context->get_id(), __PRETTY_FUNCTION__);printf(msg, ##__VA_ARGS__);printf("\n")
-#define rss_warn(msg, ...)    printf("[%s][%d][warns][%s] ", log_context->format_time(), log_context->get_id(), __PRETTY_FUNCTION__);printf(msg, ##__VA_ARGS__);printf(" errno=%d(%s)", errno, strerror(errno));printf("\n")
-#define rss_error(msg, ...)   printf("[%s][%d][error][%s] ", log_context->format_time(), log_context->get_id(), __PRETTY_FUNCTION__);printf(msg, ##__VA_ARGS__);printf(" errno=%d(%s)", errno, strerror(errno));printf("\n")
+	#define RSS_LOG_FUNCTION __PRETTY_FUNCTION__
 #endif
 
-#if 0
-#undef rss_verbose
-#define rss_verbose(msg, ...) (void)0
-#endif
-#if 0
-#undef rss_info
-#define rss_info(msg, ...) (void)0
-#endif
+// whether the level is enabled for the subsystem, a predictable branch,
+// the trace, warn and error are enabled by default, the verbose and info are not.
+#define rss_log_enabled_of(subsystem, level) \
+	__builtin_expect(rss_log_levels[subsystem] <= (level), (level) >= RSS_LOG_DEFAULT_LEVEL)
+#define rss_log_enabled(level) rss_log_enabled_of(RSS_LOG_SUBSYSTEM, level)
+
+/**
+* the log of the specified subsystem, for the inline and template code in
+* headers, which never use the RSS_LOG_SUBSYSTEM of the including file.
+*/
+#define rss_log_of(subsystem, level, name, print_errno, msg, ...) \
+	do { \
+		if (rss_log_enabled_of(subsystem, level)) { \
+			log_writer->write(name, RSS_LOG_FUNCTION, print_errno, msg, ##__VA_ARGS__); \
+		} \
+	} while (0)
+#define rss_log(level, name, print_errno, msg, ...) \
+	rss_log_of(RSS_LOG_SUBSYSTEM, level, name, print_errno, msg, ##__VA_ARGS__)
+#define rss_log_limit(level, name, print_errno, msg, ...) \
+	do { \
+		static RssLogLimiter _rss_log_limiter; \
+		if (rss_log_enabled(level) && _rss_log_limiter.allow(name, RSS_LOG_FUNCTION)) { \
+			log_writer->write(name, RSS_LOG_FUNCTION, print_errno, msg, ##__VA_ARGS__); \
+		} \
+	} while (0)
+
+#define rss_verbose(msg, ...) rss_log(RssLogVerbose, "verbs", false, msg, ##__VA_ARGS__)
+#define rss_info(msg, ...)    rss_log(RssLogInfo, "infos", false, msg, ##__VA_ARGS__)
+#define rss_trace(msg, ...)   rss_log(RssLogTrace, "trace", false, msg, ##__VA_ARGS__)
+#define rss_warn(msg, ...)    rss_log(RssLogWarn, "warns", true, msg, ##__VA_ARGS__)
+#define rss_error(msg, ...)   rss_log(RssLogError, "error", true, msg, ##__VA_ARGS__)
+
+// the rate limited variants, for the per chunk or message sites.
+#define rss_verbose_limit(msg, ...) rss_log_limit(RssLogVerbose, "verbs", false, msg, ##__VA_ARGS__)
+#define rss_info_limit(msg, ...)    rss_log_limit(RssLogInfo, "infos", false, msg, ##__VA_ARGS__)
+#define rss_trace_limit(msg, ...)   rss_log_limit(RssLogTrace, "trace", false, msg, ##__VA_ARGS__)
+#define rss_warn_limit(msg, ...)    rss_log_limit(RssLogWarn, "warns", true, msg, ##__VA_ARGS__)
 
 #endif
@@ -7,8 +7,9 @@
 
 #include <rss_core.hpp>
 
-#include <map>
 #include <string>
+#include <vector>
+#include <unordered_map>
 
 #include <st.h>
 
@@ -19,11 +20,14 @@ class RssSocket;
 class RssBuffer;
 class RssPacket;
 class RssStream;
+class RssEncodeBuffer;
+class RssStringView;
 class RssCommonMessage;
 class RssChunkStream;
 class RssAmf0Object;
 class RssAmf0Null;
 class RssAmf0Undefined;
+class RssAmf0Arena;
 class IRssMessage;
 
 // convert class name to string.
@@ -45,6 +49,63 @@ class IRssMessage;
 */
 #define RTMP_MAX_FMT3_HEADER_SIZE 5
 
+/**
+* the cid in [2, 63] is encoded in 1bytes basic header,
+* which is used by almost all clients, cache them in array.
+*/
+#define RTMP_CHUNK_STREAM_CACHE 64
+/**
+* the max chunk streams of each connection,
+* to protect the memory from the bad client.
+*/
+#define RTMP_MAX_CHUNK_STREAMS 256
+
+/**
+* the interned id of the AMF0/AMF3 command name or data name,
+* see rss_rtmp_intern_command().
+*/
+enum RssCommandId
+{
+	RssCommandUnknown = 0,
+	RssCommandConnect,
+	RssCommandCreateStream,
+	RssCommandPlay,
+	RssCommandReleaseStream,
+	RssCommandFCPublish,
+	RssCommandFCUnpublish,
+	RssCommandPublish,
+	RssCommandSetDataFrame,
+	RssCommandOnMetaData,
+	RssCommandMax,
+};
+
+/**
+* intern the command name to id.
+* @return RssCommandUnknown if not the name of known command.
+*/
+extern RssCommandId rss_rtmp_intern_command(const char* name, int size);
+
+/**
+* the state of output chunk stream, the header of last message sentout over it,
+* to select the fmt of message header, see RssProtocol::send_message().
+*/
+struct RssOutChunkStream
+{
+	// whether any message sentout, the first message must use fmt0.
+	bool sent;
+	// the fmt of the last message header.
+	char fmt;
+	int8_t message_type;
+	int32_t payload_length;
+	int32_t stream_id;
+	uint32_t timestamp;
+	// the timestamp field of last message header,
+	// the timestamp for fmt0, or the delta for fmt1/fmt2/fmt3.
+	uint32_t timestamp_delta;
+
+	RssOutChunkStream();
+};
+
 /**
 * the protocol provides the rtmp-message-protocol services,
 * to recv RTMP message from RTMP chunk stream,
@@ -59,16 +120,39 @@ private:
 	char* pp;
 // peer in
 private:
-	std::map<int, RssChunkStream*> chunk_streams;
+	// the chunk streams of cid in [0, RTMP_CHUNK_STREAM_CACHE), index by cid.
+	RssChunkStream* cs_cache[RTMP_CHUNK_STREAM_CACHE];
+	// the chunk streams of extended cid.
+	std::unordered_map<int, RssChunkStream*> chunk_streams;
+	int nb_chunk_streams;
 	RssBuffer* buffer;
 	int32_t in_chunk_size;
+	// the window ack size of peer, send acknowledgement when received the window, 0 to disable.
+	int32_t in_ack_window;
+	// the received bytes when the last acknowledgement sent.
+	int64_t in_acked_bytes;
 // peer out
 private:
+	// the header of first chunk of message, fmt is 0, 1, 2 or 3.
 	char out_header_fmt0[RTMP_MAX_FMT0_HEADER_SIZE];
 	char out_header_fmt3[RTMP_MAX_FMT3_HEADER_SIZE];
+	// the output chunk streams of cid in [0, RTMP_CHUNK_STREAM_CACHE), index by cid.
+	RssOutChunkStream out_chunk_streams[RTMP_CHUNK_STREAM_CACHE];
 	int32_t out_chunk_size;
+	// the bytes acked by peer, -1 if peer never ack.
+	int64_t out_acked_bytes;
+	// whether queue the chunks to batch, see start_batch().
+	bool batching;
+	std::vector<char> batch;
+	// the buffer to encode the packets, the capacity is retained.
+	RssEncodeBuffer* encode_buffer;
 public:
 	RssProtocol(st_netfd_t client_stfd);
+	/**
+	* the protocol over the socket, which is freed by protocol,
+	* for instance, the in-memory socket of benchmark.
+	*/
+	RssProtocol(RssSocket* io);
 	virtual ~RssProtocol();
 public:
 	/**
@@ -78,6 +162,17 @@ public:
 	virtual void set_recv_timeout(int timeout_ms);
 	virtual void set_send_timeout(int timeout_ms);
 	/**
+	* get the total bytes received from and sent to peer.
+	*/
+	virtual int64_t get_recv_bytes();
+	virtual int64_t get_send_bytes();
+	/**
+	* estimate the bytes in flight by the acknowledgement of peer,
+	* that is, the bytes sent but not acked by peer.
+	* @return the bytes in flight, 0 if the peer never ack.
+	*/
+	virtual int64_t get_inflight_bytes();
+	/**
 	* recv a message with raw/undecoded payload from peer.
 	* the payload is not decoded, use rss_rtmp_expect_message<T> if requires
 	* specifies message.
@@ -92,7 +187,40 @@ public:
 	* @msg this method will free it whatever return value.
 	*/
 	virtual int send_message(IRssMessage* msg);
+	/**
+	* start to batch the output, the send_message only queues the chunks,
+	* util flush_batch() sendout all queued chunks in one write.
+	* @remark, it's ok to start batch when batching.
+	* @remark, recv_message flush the batch before read, for peer may wait for it.
+	*/
+	virtual void start_batch();
+	/**
+	* sendout the queued chunks and stop batch.
+	*/
+	virtual int flush_batch();
+	/**
+	* send the protocol control message, the chunk header and payload
+	* are encoded to stack bytes, never allocate the message and payload.
+	* @remark, the output chunk size is updated after set chunk size sentout.
+	*/
+	virtual int send_set_chunk_size(int32_t chunk_size);
+	virtual int send_window_ack_size(int32_t ack_size);
+	virtual int send_peer_bandwidth(int32_t bandwidth, int8_t type);
+	virtual int send_acknowledgement(int32_t sequence_number);
+	virtual int send_user_control(int16_t event_type, int32_t event_data);
 private:
+	/**
+	* initialize the fields except the socket, for constructors.
+	*/
+	void initialize();
+	/**
+	* sendout the encoded control message, or queue to batch when batching.
+	*/
+	virtual int send_control(char* bytes, int size);
+	/**
+	* send acknowledgement when received bytes exceed the window ack size of peer.
+	*/
+	virtual int response_acknowledgement();
 	/**
 	* when recv message, update the context.
 	*/
@@ -165,12 +293,20 @@ struct RssMessageHeader
 
 	bool is_audio();
 	bool is_video();
+	bool is_aggregate();
 	bool is_amf0_command();
 	bool is_amf0_data();
 	bool is_amf3_command();
 	bool is_amf3_data();
 	bool is_window_ackledgement_size();
 	bool is_set_chunk_size();
+
+	/**
+	* create the header of the message to publish, for the rtmp client.
+	*/
+	void initialize_amf0_script(int32_t size, int32_t _stream_id);
+	void initialize_audio(int32_t size, int32_t _timestamp, int32_t _stream_id);
+	void initialize_video(int32_t size, int32_t _timestamp, int32_t _stream_id);
 };
 
 /**
@@ -248,9 +384,10 @@ public:
 	virtual int get_perfer_cid() = 0;
 	/**
 	* encode the packet to message payload bytes.
+	* @buffer the buffer to encode to, retained by the protocol.
 	* @remark there exists empty packet, so maybe the payload is NULL.
 	*/
-	virtual int encode_packet() = 0;
+	virtual int encode_packet(RssEncodeBuffer* buffer) = 0;
 };
 
 /**
@@ -265,6 +402,10 @@ private:
 private:
 	RssStream* stream;
 	RssPacket* packet;
+	// the amf0 values of the decoded packet.
+	RssAmf0Arena* arena;
+	// the peeked command id, -1 if not peeked.
+	int command;
 public:
 	RssCommonMessage();
 	virtual ~RssCommonMessage();
@@ -279,6 +420,12 @@ public:
 	*/
 	virtual int decode_packet();
 	/**
+	* peek the command name of AMF0/AMF3 command or data message,
+	* only read the name from the raw payload, never decode the packet.
+	* @command_id the interned id of command name.
+	*/
+	virtual int peek_command(RssCommandId& command_id);
+	/**
 	* get the decoded packet which decoded by decode_packet().
 	* @remark, user never free the pkt, the message will auto free it.
 	*/
@@ -298,10 +445,11 @@ public:
 	*/
 	virtual void set_packet(RssPacket* pkt, int stream_id);
 	/**
-	* encode the packet to message payload bytes.
+	* encode the packet to message payload bytes,
+	* and set the payload_length of header.
 	* @remark there exists empty packet, so maybe the payload is NULL.
 	*/
-	virtual int encode_packet();
+	virtual int encode_packet(RssEncodeBuffer* buffer);
 };
 
 /**
@@ -325,6 +473,8 @@ private:
 		virtual ~RssSharedPtr();
 	};
 	RssSharedPtr* ptr;
+	// the time in us the message arrived at source, 0 for unknown.
+	int64_t arrival_us;
 public:
 	RssSharedPtrMessage();
 	virtual ~RssSharedPtrMessage();
@@ -336,6 +486,11 @@ public:
 	*/
 	virtual int initialize(IRssMessage* msg, char* payload, int size);
 	virtual RssSharedPtrMessage* copy();
+	/**
+	* the arrival time is copied to the copies, see RssClock::now_us.
+	*/
+	virtual void set_arrival(int64_t us);
+	virtual int64_t get_arrival();
 public:
 	/**
 	* get the perfered cid(chunk stream id) which sendout over.
@@ -346,7 +501,7 @@ public:
 	* for shared message, nothing should be done.
 	* use initialize() to set the data.
 	*/
-	virtual int encode_packet();
+	virtual int encode_packet(RssEncodeBuffer* buffer);
 };
 
 /**
@@ -379,7 +534,6 @@ public:
 	*/
 public:
 	virtual int get_perfer_cid();
-	virtual int get_payload_length();
 public:
 	/**
 	* subpacket must override to provide the right message type.
@@ -389,14 +543,13 @@ public:
 	* the subpacket can override this encode,
 	* for example, video and audio will directly set the payload withou memory copy,
 	* other packet which need to serialize/encode to bytes by override the
-	* get_size and encode_packet.
+	* encode_packet, which encode to the buffer in one pass.
+	* @buffer the buffer to encode to, the capacity is reused by the next packet,
+	* 		NULL to use a temp buffer.
+	* @payload the copy of the encoded bytes, user must free it.
 	*/
-	virtual int encode(int& size, char*& payload);
+	virtual int encode(RssEncodeBuffer* buffer, int& size, char*& payload);
 protected:
-	/**
-	* subpacket can override to calc the packet size.
-	*/
-	virtual int get_size();
 	/**
 	* subpacket can override to encode the payload to stream.
 	* @remark never invoke the super.encode_packet, it always failed.
@@ -421,12 +574,25 @@ protected:
 public:
 	std::string command_name;
 	double transaction_id;
-	RssAmf0Object* command_object;
+	/**
+	* the required properties of command object,
+	* read by RssAmf0Reader, the others are ignored.
+	*/
+	std::string tcUrl;
+	std::string pageUrl;
+	std::string swfUrl;
+	double objectEncoding;
 public:
 	RssConnectAppPacket();
 	virtual ~RssConnectAppPacket();
 public:
 	virtual int decode(RssStream* stream);
+public:
+	virtual int get_perfer_cid();
+public:
+	virtual int get_message_type();
+protected:
+	virtual int encode_packet(RssStream* stream);
 };
 /**
 * response for RssConnectAppPacket.
@@ -453,7 +619,6 @@ public:
 public:
 	virtual int get_message_type();
 protected:
-	virtual int get_size();
 	virtual int encode_packet(RssStream* stream);
 };
 
@@ -482,6 +647,12 @@ public:
 	virtual ~RssCreateStreamPacket();
 public:
 	virtual int decode(RssStream* stream);
+public:
+	virtual int get_perfer_cid();
+public:
+	virtual int get_message_type();
+protected:
+	virtual int encode_packet(RssStream* stream);
 };
 /**
 * response for RssCreateStreamPacket.
@@ -508,7 +679,6 @@ public:
 public:
 	virtual int get_message_type();
 protected:
-	virtual int get_size();
 	virtual int encode_packet(RssStream* stream);
 };
 
@@ -534,6 +704,12 @@ public:
 	virtual ~RssFMLEStartPacket();
 public:
 	virtual int decode(RssStream* stream);
+public:
+	virtual int get_perfer_cid();
+public:
+	virtual int get_message_type();
+protected:
+	virtual int encode_packet(RssStream* stream);
 };
 /**
 * response for RssFMLEStartPacket.
@@ -560,7 +736,6 @@ public:
 public:
 	virtual int get_message_type();
 protected:
-	virtual int get_size();
 	virtual int encode_packet(RssStream* stream);
 };
 
@@ -591,6 +766,12 @@ public:
 	virtual ~RssPublishPacket();
 public:
 	virtual int decode(RssStream* stream);
+public:
+	virtual int get_perfer_cid();
+public:
+	virtual int get_message_type();
+protected:
+	virtual int encode_packet(RssStream* stream);
 };
 
 /**
@@ -619,6 +800,12 @@ public:
 	virtual ~RssPlayPacket();
 public:
 	virtual int decode(RssStream* stream);
+public:
+	virtual int get_perfer_cid();
+public:
+	virtual int get_message_type();
+protected:
+	virtual int encode_packet(RssStream* stream);
 };
 /**
 * response for RssPlayPacket.
@@ -646,7 +833,6 @@ public:
 public:
 	virtual int get_message_type();
 protected:
-	virtual int get_size();
 	virtual int encode_packet(RssStream* stream);
 };
 
@@ -674,7 +860,6 @@ public:
 public:
 	virtual int get_message_type();
 protected:
-	virtual int get_size();
 	virtual int encode_packet(RssStream* stream);
 };
 
@@ -704,7 +889,6 @@ public:
 public:
 	virtual int get_message_type();
 protected:
-	virtual int get_size();
 	virtual int encode_packet(RssStream* stream);
 };
 
@@ -732,7 +916,6 @@ public:
 public:
 	virtual int get_message_type();
 protected:
-	virtual int get_size();
 	virtual int encode_packet(RssStream* stream);
 };
 
@@ -761,7 +944,6 @@ public:
 public:
 	virtual int get_message_type();
 protected:
-	virtual int get_size();
 	virtual int encode_packet(RssStream* stream);
 };
 
@@ -792,10 +974,42 @@ public:
 public:
 	virtual int get_message_type();
 protected:
-	virtual int get_size();
 	virtual int encode_packet(RssStream* stream);
 };
 
+/**
+* set the string property of the metadata in the raw payload of message,
+* the bytes of metadata is spliced without decode, and the @setDataFrame is
+* removed like the RssOnMetaDataPacket.
+* @buffer the buffer to splice in, the capacity is reused.
+* @payload the copy of the spliced bytes, user must free it.
+* @return error if not a valid AMF0 metadata, user should decode it to RssOnMetaDataPacket.
+*/
+extern int rss_rtmp_splice_metadata(RssCommonMessage* msg, const RssStringView& name, const RssStringView& value,
+	RssEncodeBuffer* buffer, int& size, char*& payload);
+
+/**
+* the sub message of aggregate message is a FLV tag:
+* 	1bytes type, 3bytes size, 3bytes timestamp, 1bytes timestamp extended,
+* 	3bytes stream id, the payload, then 4bytes back pointer.
+*/
+#define RTMP_AGGREGATE_TAG_HEADER_SIZE 11
+#define RTMP_AGGREGATE_BACK_POINTER_SIZE 4
+
+/**
+* demux the aggregate message to the audio and video messages,
+* the timestamp of sub message is offset to the timestamp of aggregate message,
+* other sub messages are ignored.
+* @msgs the demuxed messages which own the copy of payload, user must free them.
+*/
+extern int rss_rtmp_demux_aggregate(RssCommonMessage* msg, std::vector<RssCommonMessage*>& msgs);
+/**
+* pack the audio and video messages to an aggregate message,
+* the messages are not freed, user must free them.
+* @aggregate the packed message whose header is the first message, user must free it.
+*/
+extern int rss_rtmp_pack_aggregate(RssSharedPtrMessage** msgs, int count, RssSharedPtrMessage*& aggregate);
+
 /**
 * 5.5. Window Acknowledgement Size (5)
 * The client or the server sends this message to inform the peer which
@@ -822,7 +1036,6 @@ public:
 public:
 	virtual int get_message_type();
 protected:
-	virtual int get_size();
 	virtual int encode_packet(RssStream* stream);
 };
 
@@ -852,7 +1065,6 @@ public:
 public:
 	virtual int get_message_type();
 protected:
-	virtual int get_size();
 	virtual int encode_packet(RssStream* stream);
 };
 
@@ -881,7 +1093,6 @@ public:
 public:
 	virtual int get_message_type();
 protected:
-	virtual int get_size();
 	virtual int encode_packet(RssStream* stream);
 };
 
@@ -933,10 +1144,87 @@ public:
 public:
 	virtual int get_message_type();
 protected:
-	virtual int get_size();
 	virtual int encode_packet(RssStream* stream);
 };
 
+/**
+* the sentinel values to build the packet template,
+* set the fields to patch to the sentinels, then encode the packet,
+* the offset of fields is discoveried by search the encoded sentinels.
+* @remark the clientid to patch must be the same length of the sentinel.
+*/
+#define RTMP_TEMPLATE_TRANSACTION_ID 	7340033.25
+#define RTMP_TEMPLATE_STREAM_ID 		7340034.75
+#define RTMP_TEMPLATE_CLIENT_ID 		"\x01\x02\x03\x04\x05\x06\x07\x08"
+#define RTMP_TEMPLATE_CLIENT_ID_SIZE 	8
+
+/**
+* the precompiled bytes of a command packet.
+* the content of the command response is almost constant,
+* so build the bytes once at startup, and patch the transaction id,
+* stream id and clientid when send to each connection.
+*/
+class RssPacketTemplate
+{
+private:
+	int message_type;
+	int perfer_cid;
+	int size;
+	char* payload;
+	// the offset of the amf0 value to patch, -1 if not exists.
+	int tid_offset;
+	int stream_id_offset;
+	int client_id_offset;
+public:
+	RssPacketTemplate();
+	virtual ~RssPacketTemplate();
+public:
+	/**
+	* encode the packet to bytes and discovery the fields to patch.
+	* @pkt the packet which fields to patch are set to the sentinel values,
+	* 		user must free it.
+	*/
+	virtual int initialize(RssPacket* pkt);
+	virtual int get_perfer_cid();
+	virtual int get_message_type();
+	virtual int get_size();
+	/**
+	* copy the template bytes to a new payload and patch the fields.
+	* @ppayload, user must free it.
+	*/
+	virtual int encode(double transaction_id, double stream_id, const std::string& client_id, char*& ppayload);
+};
+
+/**
+* the packet encoded from template, see RssPacketTemplate.
+*/
+class RssTemplatePacket : public RssPacket
+{
+private:
+	typedef RssPacket super;
+protected:
+	virtual const char* get_class_name()
+	{
+		return CLASS_NAME_STRING(RssTemplatePacket);
+	}
+private:
+	RssPacketTemplate* tmpl;
+public:
+	double transaction_id;
+	double stream_id;
+	std::string client_id;
+public:
+	/**
+	* @_tmpl the template never free by packet.
+	*/
+	RssTemplatePacket(RssPacketTemplate* _tmpl);
+	virtual ~RssTemplatePacket();
+public:
+	virtual int get_perfer_cid();
+	virtual int get_message_type();
+	virtual int encode(RssEncodeBuffer* buffer, int& size, char*& payload);
+};
+
 /**
 * expect a specified message, drop others util got specified one.
 * @pmsg, user must free it. NULL if not success.
@@ -956,15 +1244,15 @@ int rss_rtmp_expect_message(RssProtocol* protocol, RssCommonMessage** pmsg, T**
 		RssCommonMessage* msg = NULL;
 		if ((ret = protocol->recv_message(&msg)) != ERROR_SUCCESS)
 		{
-			rss_error("recv message failed. ret=%d", ret);
+			rss_log_of(RssLogSubsystemRtmp, RssLogError, "error", true, "recv message failed. ret=%d", ret);
 			return ret;
 		}
-		rss_verbose("recv message success.");
+		rss_log_of(RssLogSubsystemRtmp, RssLogVerbose, "verbs", false, "recv message success.");
 
 		if ((ret = msg->decode_packet()) != ERROR_SUCCESS)
 		{
 			delete msg;
-			rss_error("decode message failed. ret=%d", ret);
+			rss_log_of(RssLogSubsystemRtmp, RssLogError, "error", true, "decode message failed. ret=%d", ret);
 			return ret;
 		}
 
@@ -972,9 +1260,9 @@ int rss_rtmp_expect_message(RssProtocol* protocol, RssCommonMessage** pmsg, T**
 		if (!pkt)
 		{
 			delete msg;
-			rss_trace("drop message(type=%d, size=%d, time=%d, sid=%d).",
-			          msg->header.message_type, msg->header.payload_length,
-			          msg->header.timestamp, msg->header.stream_id);
+			rss_log_of(RssLogSubsystemRtmp, RssLogTrace, "trace", false, "drop message(type=%d, size=%d, time=%d, sid=%d).",
+			           msg->header.message_type, msg->header.payload_length,
+			           msg->header.timestamp, msg->header.stream_id);
 			continue;
 		}
 
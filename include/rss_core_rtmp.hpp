@@ -64,6 +64,28 @@ enum RssClientType
 	RssClientPublish,
 };
 
+/**
+* the precompiled command responses to client,
+* see RssPacketTemplate.
+*/
+enum RssRtmpTemplate
+{
+	RssTemplateConnectAmf0 = 0,
+	RssTemplateConnectAmf3,
+	RssTemplateOnBWDone,
+	RssTemplateCreateStream,
+	RssTemplateFMLEStart,
+	RssTemplatePlayReset,
+	RssTemplatePlayStart,
+	RssTemplateSampleAccess,
+	RssTemplateDataStart,
+	RssTemplateFCPublish,
+	RssTemplatePublishStart,
+	RssTemplateFCUnpublish,
+	RssTemplateUnpublish,
+	RssTemplateMax,
+};
+
 /**
 * the rtmp provices rtmp-command-protocol services,
 * a high level protocol, media stream oriented services,
@@ -74,14 +96,32 @@ class RssRtmp
 private:
 	RssProtocol* protocol;
 	st_netfd_t stfd;
+	// the clientid of onStatus.
+	std::string client_id;
 public:
 	RssRtmp(st_netfd_t client_stfd);
 	virtual ~RssRtmp();
+public:
+	/**
+	* build the precompiled command responses, invoke once at startup.
+	*/
+	static int initialize_templates();
 public:
 	virtual void set_recv_timeout(int timeout_ms);
 	virtual void set_send_timeout(int timeout_ms);
+	/**
+	* the bytes of peer, see RssProtocol::get_inflight_bytes().
+	*/
+	virtual int64_t get_recv_bytes();
+	virtual int64_t get_send_bytes();
+	virtual int64_t get_inflight_bytes();
 	virtual int recv_message(RssCommonMessage** pmsg);
 	virtual int send_message(IRssMessage* msg);
+	/**
+	* batch the messages to send in one write, see RssProtocol::start_batch().
+	*/
+	virtual void start_batch();
+	virtual int flush_batch();
 public:
 	virtual int handshake();
 	virtual int connect_app(RssRequest* req);
@@ -128,8 +168,74 @@ public:
 	*/
 	virtual int fmle_unpublish(int stream_id, double unpublish_tid);
 private:
+	/**
+	* send the response from template.
+	* @stream_id the stream id to patch in payload, for createStream response.
+	* @message_stream_id the stream id of message header.
+	*/
+	virtual int send_template(RssRtmpTemplate type, double transaction_id, double stream_id, int message_stream_id);
 	virtual int identify_create_stream_client(RssCreateStreamPacket* req, int stream_id, RssClientType& type, std::string& stream_name);
 	virtual int identify_fmle_publish_client(RssFMLEStartPacket* req, RssClientType& type, std::string& stream_name);
 };
 
+/**
+* the rtmp client, connect to the rtmp server to play or publish stream,
+* for instance, the load generator objs/tools/rss_rtmp_bench.
+* @remark the responses are checked by the command name and transaction id,
+* 		the other messages before the response are ignored.
+*/
+class RssRtmpClient
+{
+private:
+	RssProtocol* protocol;
+	st_netfd_t stfd;
+	// the transaction id of the last request.
+	double transaction_id;
+public:
+	RssRtmpClient(st_netfd_t server_stfd);
+	virtual ~RssRtmpClient();
+public:
+	virtual void set_recv_timeout(int timeout_ms);
+	virtual void set_send_timeout(int timeout_ms);
+	virtual int64_t get_recv_bytes();
+	virtual int64_t get_send_bytes();
+	virtual int recv_message(RssCommonMessage** pmsg);
+	virtual int send_message(IRssMessage* msg);
+public:
+	/**
+	* the simple handshake, send c0c1, recv s0s1s2, send c2.
+	*/
+	virtual int handshake();
+	/**
+	* connect to the app of tcUrl, for example, rtmp://127.0.0.1:1935/live
+	*/
+	virtual int connect_app(const std::string& tc_url);
+	virtual int set_chunk_size(int chunk_size);
+	/**
+	* create the stream to play.
+	* @stream_id output the stream id created by server.
+	*/
+	virtual int create_stream(int& stream_id);
+	/**
+	* play the stream, wait for onStatus(NetStream.Play.Start).
+	*/
+	virtual int play(const std::string& stream, int stream_id);
+	/**
+	* the FMLE publish: releaseStream, FCPublish, createStream and publish,
+	* wait for onStatus(NetStream.Publish.Start).
+	* @stream_id output the stream id created by server.
+	*/
+	virtual int fmle_publish(const std::string& stream, int& stream_id);
+private:
+	/**
+	* recv util the _result of transaction.
+	* @value the optional number after the command object, for instance, the stream id.
+	*/
+	virtual int expect_result(double tid, double& value);
+	/**
+	* recv util the onStatus with the code.
+	*/
+	virtual int expect_status(const char* code);
+};
+
 #endif
\ No newline at end of file
@@ -3,31 +3,124 @@
 
 #include <rss_core.hpp>
 
+#include <sys/types.h>
+
+#include <string>
 #include <vector>
 
 #include <st.h>
 
+/**
+* the env var which carries the unix socket fd to the new binary,
+* the old binary passes the listen fd over it by SCM_RIGHTS.
+*/
+#define RSS_UPGRADE_FD_ENV "RSS_UPGRADE_FD"
+
 class RssConnection;
+class RssServerStat;
+class RssConnStat;
 class RssServer
 {
 private:
 	int fd;
 	st_netfd_t stfd;
+	st_thread_t listen_tid;
 	std::vector<RssConnection*> conns;
 	int rss_report_interval_ms;
+private:
+	// the http api listen fd, -1 when api disabled.
+	int api_fd;
+	st_netfd_t api_stfd;
+	st_thread_t api_tid;
+	// the http api conns, not in the conns, never counted in the stats.
+	std::vector<RssConnection*> api_conns;
+	int64_t start_time;
+	// the total accepted conns, and the bytes of closed conns.
+	int64_t nb_accepted;
+	int64_t closed_recv_bytes;
+	int64_t closed_send_bytes;
+	// the last time and cpu time to update the shm stat.
+	int64_t shm_update_time;
+	int64_t shm_cpu_us;
+private:
+	// the signals are written to pipe and read by the cycle thread.
+	int signal_pipe[2];
+	st_netfd_t signal_stfd;
+	// whether the listen fd is handed off, only drain the conns.
+	bool draining;
+	// the time in ms to start draining, quit when exceed RSS_DRAIN_MAX_MS.
+	int64_t drain_start_time;
+	// the path of binary resolved at startup, exec it when hot upgrade,
+	// for the /proc/self/exe is the inode of running binary, not the replaced file.
+	std::string binary;
 public:
 	RssServer();
 	virtual ~RssServer();
 public:
+	/**
+	* initialize the st, log and signals, and resolve the path of binary.
+	*/
 	virtual int initialize();
+	/**
+	* listen at port, or inherit the listen fd from the old binary
+	* when started by hot upgrade, see RSS_UPGRADE_FD_ENV.
+	*/
 	virtual int listen(int port);
+	/**
+	* listen the http api at port, serve the stats, see RssApiConnection.
+	* @remark the api port is bind with SO_REUSEPORT, not handed off when hot upgrade,
+	* 		the old binary close it when draining.
+	*/
+	virtual int listen_api(int port);
+	/**
+	* the cycle to process signals.
+	* SIGUSR2, hot upgrade, exec the new binary and handoff the listen fd,
+	* 		then drain the conns and return when all conns closed or RSS_DRAIN_MAX_MS.
+	* SIGHUP, reload the log levels from RSS_LOG_LEVEL_FILE.
+	*/
 	virtual int cycle();
 	virtual void remove(RssConnection* conn);
-	virtual bool can_report(int64_t& reported, int64_t time);
+	/**
+	* remove and free the api conn, see RssApiConnection.
+	*/
+	virtual void remove_api(RssConnection* conn);
+	/**
+	* whether report now by the coarse clock, the interval grows with the conns.
+	* @reported the last reported time in ms, updated when can report.
+	*/
+	virtual bool can_report(int64_t& reported);
+	/**
+	* get the stat of server and all conns, O(conns).
+	*/
+	virtual void stat(RssServerStat& stat, std::vector<RssConnStat>& conn_stats);
 private:
-	virtual int accept_client(st_netfd_t client_stfd);
+	virtual int accept_client(RssConnection* conn);
 	virtual void listen_cycle();
 	static void* listen_thread(void* arg);
+	virtual void api_cycle();
+	static void* api_thread(void* arg);
+private:
+	/**
+	* update the worker slot of shm stat every RSS_SHM_STAT_INTERVAL_MS.
+	*/
+	virtual void update_shm();
+	virtual int open_signal_pipe();
+	static void on_signal(int signo);
+	/**
+	* fork and exec the new binary, send the listen fd over unix socket,
+	* stop accepting when the new binary is ready.
+	*/
+	virtual int upgrade();
+	/**
+	* when hot upgrade failed, SIGTERM the new binary, SIGKILL when it
+	* not quit in the grace period, and reap it.
+	*/
+	virtual void kill_new_binary(pid_t pid);
+	virtual int create_listen_fd(int port, bool reuse_port, int& listen_fd);
+	/**
+	* recv the listen fd from old binary over the unix socket.
+	*/
+	virtual int inherit_listen_fd(int unix_fd);
 };
 
-#endif
\ No newline at end of file
+#endif
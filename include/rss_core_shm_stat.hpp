@@ -0,0 +1,136 @@
+#ifndef RSS_CORE_SHM_STAT_HPP
+#define RSS_CORE_SHM_STAT_HPP
+
+/*
+#include <rss_core_shm_stat.hpp>
+*/
+
+#include <rss_core.hpp>
+
+/**
+* the shared memory stats segment, the server updates the fields by relaxed
+* atomic stores, the external monitor, for instance objs/tools/rss_top, maps
+* it readonly, so the monitoring costs the server nothing.
+* the segment is named by the listen port and the version, shared by the old
+* and new binary of hot upgrade, each process owns a worker slot and its source
+* slots, the binaries of different layouts use different segments.
+*/
+#define RSS_SHM_STAT_NAME "/rss-stat-%d-v%d"
+#define RSS_SHM_STAT_MAGIC 0x54535352
+// increase it when the layout changed.
+#define RSS_SHM_STAT_VERSION 2
+#define RSS_SHM_STAT_MAX_WORKERS 8
+#define RSS_SHM_STAT_MAX_SOURCES 1024
+#define RSS_SHM_STAT_URL_SIZE 128
+// the interval to update the sampled fields, for instance, the kbps and queue.
+#define RSS_SHM_STAT_INTERVAL_MS 1000
+
+/**
+* the relaxed atomic access of the fields, the fields of a slot
+* are written by the owner process only.
+*/
+#define rss_shm_store(field, value) __atomic_store_n(&(field), (value), __ATOMIC_RELAXED)
+#define rss_shm_load(field) __atomic_load_n(&(field), __ATOMIC_RELAXED)
+
+struct RssShmStatHeader
+{
+	uint32_t magic;
+	uint32_t version;
+	// the size of segment, to check the layout.
+	uint32_t size;
+	uint32_t max_workers;
+	uint32_t max_sources;
+	uint32_t reserved[3];
+};
+
+/**
+* the slot of process, which runs all st-threads.
+*/
+struct RssShmWorkerSlot
+{
+	// the owner pid, 0 when free.
+	int64_t pid;
+	int64_t start_ms;
+	// the last time updated, about every second.
+	int64_t update_ms;
+	int64_t conns;
+	int64_t accepted;
+	int64_t recv_bytes;
+	int64_t send_bytes;
+	// the cpu usage of user and sys in the last interval, in permille.
+	int64_t cpu_permille;
+	// the max lag of st scheduler in the last interval, see RssClock::reset_max_lag.
+	int64_t sched_lag_us;
+	int64_t reserved[7];
+};
+
+/**
+* the slot of source, updated when the publisher dispatch messages.
+*/
+struct RssShmSourceSlot
+{
+	// the owner pid, 0 when free.
+	int64_t pid;
+	int64_t id;
+	int64_t publishing;
+	int64_t recv_bytes;
+	int64_t kbps;
+	int64_t consumers;
+	// the messages in all consumer queues.
+	int64_t queue_msgs;
+	int64_t dropped;
+	// the latency from arrival to written of all consumers, see RssSource::on_consumer_latency,
+	// the percentiles of the recent window, see RSS_LATENCY_WINDOW_MS.
+	int64_t latency_p50_us;
+	int64_t latency_p99_us;
+	int64_t latency_p999_us;
+	char url[RSS_SHM_STAT_URL_SIZE];
+};
+
+struct RssShmStatSegment
+{
+	RssShmStatHeader header;
+	RssShmWorkerSlot workers[RSS_SHM_STAT_MAX_WORKERS];
+	RssShmSourceSlot sources[RSS_SHM_STAT_MAX_SOURCES];
+};
+
+/**
+* the shared memory stats of current process.
+* @remark the slots are NULL when the segment not opened, the user must check it.
+*/
+class RssShmStat
+{
+private:
+	static RssShmStatSegment* segment;
+	static RssShmWorkerSlot* worker;
+public:
+	/**
+	* open or create the segment for the listen port, claim the worker slot.
+	* @remark, the stats is disabled when open failed, never fail the server.
+	*/
+	static int initialize(int port);
+	/**
+	* get the worker slot of current process, NULL when disabled.
+	*/
+	static RssShmWorkerSlot* get_worker();
+	/**
+	* claim a source slot, NULL when disabled or no free slot.
+	*/
+	static RssShmSourceSlot* alloc_source(int id, const char* url);
+	static void free_source(RssShmSourceSlot* slot);
+	/**
+	* whether the pid of slot is alive.
+	*/
+	static bool is_alive(int64_t pid);
+private:
+	/**
+	* claim the slot when free or the owner is dead.
+	*/
+	static bool claim(int64_t* pid);
+	/**
+	* free the slots of current process when exit.
+	*/
+	static void cleanup();
+};
+
+#endif
@@ -19,12 +19,17 @@ private:
 	int64_t recv_timeout;
 	int64_t send_timeout;
 	st_netfd_t stfd;
+	// the total bytes read from and written to the socket.
+	int64_t recv_bytes;
+	int64_t send_bytes;
 public:
 	RssSocket(st_netfd_t client_stfd);
 	virtual ~RssSocket();
 public:
 	virtual void set_recv_timeout(int timeout_ms);
 	virtual void set_send_timeout(int timeout_ms);
+	virtual int64_t get_recv_bytes();
+	virtual int64_t get_send_bytes();
 	virtual int read(const void* buf, size_t size, ssize_t* nread);
 	virtual int read_fully(const void* buf, size_t size, ssize_t* nread);
 	virtual int write(const void* buf, size_t size, ssize_t* nwrite);
@@ -13,8 +13,12 @@
 
 class RssSource;
 class RssCommonMessage;
-class RssOnMetaDataPacket;
 class RssSharedPtrMessage;
+class RssEncodeBuffer;
+class RssKbps;
+class RssHistogram;
+class RssSourceStat;
+struct RssShmSourceSlot;
 
 /**
 * the consumer for RssSource, that is a play client.
@@ -24,10 +28,37 @@ class RssConsumer
 private:
 	RssSource* source;
 	std::vector<RssSharedPtrMessage*> msgs;
+	// whether the client is congested, set by the play client.
+	bool congested;
+	// whether drop the audio and video, util the video keyframe when not congested.
+	bool dropping;
+	// whether any video enqueued, the audio only stream resumes when not congested.
+	bool has_video;
+	// the total dropped audio and video messages.
+	int64_t nb_dropped;
+	// the latency from arrival to written.
+	RssHistogram* latency;
 public:
 	RssConsumer(RssSource* _source);
 	virtual ~RssConsumer();
 public:
+	/**
+	* set whether the client is congested, for instance, too many bytes in flight,
+	* the audio and video are dropped when congested, and resumed at the next
+	* video keyframe when congestion gone, or at once for the audio only stream.
+	*/
+	virtual void set_congested(bool is_congested);
+	virtual int64_t get_dropped();
+	/**
+	* get the messages in queue.
+	*/
+	virtual int get_queue_msgs();
+	/**
+	* when the message written to client, record the latency from arrival to
+	* the consumer and the source, ignore the message without arrival time.
+	*/
+	virtual void on_sent(int64_t arrival_us);
+	virtual RssHistogram* get_latency();
 	/**
 	* enqueue an shared ptr message.
 	*/
@@ -46,8 +77,12 @@ public:
 */
 class RssSource
 {
+	// the consumers update the totals of queue and dropped.
+	friend class RssConsumer;
 private:
 	static std::map<std::string, RssSource*> pool;
+	// the id of last created source.
+	static int last_id;
 public:
 	/**
 	* find stream by vhost/app/stream.
@@ -56,7 +91,13 @@ public:
 	* @remark stream_url should without port and schema.
 	*/
 	static RssSource* find(std::string stream_url);
+	/**
+	* get the stat of all sources, O(sources).
+	*/
+	static void stat_sources(std::vector<RssSourceStat>& stats);
 private:
+	// the id of source, to identify the stream in trace.
+	int id;
 	std::string stream_url;
 	std::vector<RssConsumer*> consumers;
 private:
@@ -65,16 +106,63 @@ private:
 	RssSharedPtrMessage* cache_sh_video;
 	// the cached audio sequence header.
 	RssSharedPtrMessage* cache_sh_audio;
+	// the buffer to encode metadata, the capacity is retained.
+	RssEncodeBuffer* encode_buffer;
+private:
+	// the publisher, the id is 0 when not publishing.
+	int publisher_id;
+	std::string publisher_ip;
+	int64_t publish_time;
+	// the bytes of audio and video, and the kbps.
+	int64_t recv_bytes;
+	RssKbps* kbps;
+	// the latency from arrival to written, of all consumers.
+	RssHistogram* latency;
+	// the queued msgs of all consumers, and the dropped msgs of all consumers
+	// include the destroyed, updated by consumers, never walk the consumers.
+	int64_t queue_msgs;
+	int64_t nb_dropped;
+	// the slot of shm stat, NULL when disabled.
+	RssShmSourceSlot* shm;
+	int64_t shm_update_time;
 public:
 	RssSource(std::string _stream_url);
 	virtual ~RssSource();
 public:
-	virtual int on_meta_data(RssCommonMessage* msg, RssOnMetaDataPacket* metadata);
+	virtual int get_id();
+	/**
+	* when client start to publish and unpublish, for stat.
+	*/
+	virtual void on_publish(int client_id, const char* ip);
+	virtual void on_unpublish();
+	virtual void stat(RssSourceStat& stat);
+	/**
+	* the consumer sent a message, aggregate the latency.
+	*/
+	virtual void on_consumer_latency(int64_t latency_us);
+	/**
+	* set the server property of metadata and cache it for the consumers,
+	* splice the raw bytes, or decode and encode the metadata when the bytes is invalid.
+	*/
+	virtual int on_meta_data(RssCommonMessage* msg);
 	virtual int on_audio(RssCommonMessage* audio);
 	virtual int on_video(RssCommonMessage* video);
+	/**
+	* demux the aggregate message to audio and video, which is dispatched in order.
+	*/
+	virtual int on_aggregate(RssCommonMessage* msg);
 public:
 	virtual int create_consumer(RssConsumer*& consumer);
 	virtual void on_consumer_destroy(RssConsumer* consumer);
+private:
+	/**
+	* update the shm stat, the sampled fields are updated every RSS_SHM_STAT_INTERVAL_MS.
+	*/
+	virtual void update_shm(bool force);
+	/**
+	* update the consumers of shm stat, when consumer join or leave.
+	*/
+	virtual void update_shm_consumers();
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,183 @@
+#ifndef RSS_CORE_STAT_HPP
+#define RSS_CORE_STAT_HPP
+
+/*
+#include <rss_core_stat.hpp>
+*/
+
+#include <rss_core.hpp>
+
+#include <string>
+
+/**
+* the kbps sampled by the total bytes, updated on the hot path,
+* the kbps is computed about every RSS_KBPS_SAMPLE_MS.
+*/
+class RssKbps
+{
+private:
+	int64_t sample_time;
+	int64_t sample_bytes;
+	int kbps;
+public:
+	RssKbps();
+	virtual ~RssKbps();
+public:
+	/**
+	* sample the total bytes, compute the kbps when interval elapsed.
+	*/
+	virtual void sample(int64_t total_bytes);
+	/**
+	* get the last kbps, 0 when not sampled for a long time.
+	*/
+	virtual int get_kbps();
+};
+
+/**
+* the log-bucketed histogram of latency in us, HDR-style,
+* each power of 2 is divided to 2^RSS_HISTOGRAM_SUB_BITS linear sub-buckets,
+* so the error of percentile is about 1/2^RSS_HISTOGRAM_SUB_BITS,
+* the record is O(1) and the percentile is O(buckets).
+*/
+#define RSS_HISTOGRAM_SUB_BITS 3
+// the max power of 2, the larger values are recorded to the last bucket, about 71min.
+#define RSS_HISTOGRAM_MAX_BITS 32
+#define RSS_HISTOGRAM_SIZE ((RSS_HISTOGRAM_MAX_BITS - RSS_HISTOGRAM_SUB_BITS + 1) << RSS_HISTOGRAM_SUB_BITS)
+
+// the window of latency percentiles, the percentiles are of the last 1 to 2 windows.
+#define RSS_LATENCY_WINDOW_MS 10000
+
+class RssHistogram
+{
+private:
+	// the buckets of current and previous window, swapped when window elapsed.
+	uint64_t buckets[2][RSS_HISTOGRAM_SIZE];
+	uint64_t* counts;
+	uint64_t* previous;
+	int64_t window_count[2];
+	int64_t window_max[2];
+	// the window in ms, 0 to never rotate, the percentiles are of all values.
+	int64_t window_ms;
+	int64_t window_start;
+	// the totals of all values.
+	int64_t count;
+	int64_t sum;
+	int64_t max;
+public:
+	RssHistogram(int64_t _window_ms = 0);
+	virtual ~RssHistogram();
+public:
+	virtual void record(int64_t value);
+	/**
+	* the count, sum and max of all values, never reset.
+	*/
+	virtual int64_t get_count();
+	virtual int64_t get_sum();
+	virtual int64_t get_max();
+	/**
+	* the max of values in window, the last 1 to 2 windows.
+	*/
+	virtual int64_t get_window_max();
+	/**
+	* get the value at percentile of window, for instance, 0.99 for p99.
+	* @return the middle of bucket, 0 when empty.
+	*/
+	virtual int64_t percentile(double p);
+private:
+	/**
+	* rotate by the coarse clock, the previous window is dropped.
+	*/
+	virtual void rotate();
+	static int index_of(int64_t value);
+	static int64_t value_of(int index);
+};
+
+/**
+* the percentiles of latency in us, the percentiles and max are of
+* the window, the count and sum are of all values.
+*/
+class RssLatencyStat
+{
+public:
+	int64_t count;
+	// the total of values, for the prometheus summary.
+	int64_t sum;
+	int64_t p50;
+	int64_t p99;
+	int64_t p999;
+	int64_t max;
+public:
+	RssLatencyStat();
+	/**
+	* load the percentiles from histogram.
+	*/
+	virtual void load(RssHistogram* histogram);
+};
+
+/**
+* the statistic of server, the closed conns is accumulated to the totals.
+*/
+class RssServerStat
+{
+public:
+	int64_t uptime_ms;
+	int nb_conns;
+	// the total accepted conns.
+	int64_t nb_accepted;
+	// the bytes of alive and closed conns.
+	int64_t recv_bytes;
+	int64_t send_bytes;
+public:
+	RssServerStat();
+};
+
+/**
+* the statistic of connection.
+*/
+class RssConnStat
+{
+public:
+	int id;
+	std::string ip;
+	// play, publish, api or unknown.
+	std::string role;
+	std::string stream;
+	int64_t uptime_ms;
+	int64_t recv_bytes;
+	int64_t send_bytes;
+	int recv_kbps;
+	int send_kbps;
+	// the messages in consumer queue of play client.
+	int queue_msgs;
+	int64_t dropped;
+	// the latency from source arrival to written, of play client.
+	RssLatencyStat latency;
+public:
+	RssConnStat();
+};
+
+/**
+* the statistic of source.
+*/
+class RssSourceStat
+{
+public:
+	int id;
+	std::string url;
+	// the id of publisher, 0 when not publishing.
+	int publisher_id;
+	std::string publisher_ip;
+	int64_t publish_ms;
+	// the bytes of audio and video.
+	int64_t recv_bytes;
+	int kbps;
+	int nb_consumers;
+	// the cached messages, the metadata and sequence headers.
+	int cache_msgs;
+	// the latency from arrival to written, of all consumers.
+	RssLatencyStat latency;
+public:
+	RssSourceStat();
+};
+
+#endif
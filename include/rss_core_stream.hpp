@@ -8,18 +8,70 @@
 #include <rss_core.hpp>
 
 #include <sys/types.h>
+#include <string.h>
 #include <string>
 
-class RssStream
+#include <rss_core_log.hpp>
+#include <rss_core_error.hpp>
+
+/**
+* the view of string bytes, never copy and never free the bytes,
+* user must keep the bytes alive when use the view.
+*/
+class RssStringView
+{
+private:
+	const char* p;
+	int n;
+public:
+	RssStringView();
+	RssStringView(const char* _p, int _n);
+	RssStringView(const char* str);
+	RssStringView(const std::string& str);
+public:
+	const char* data() const;
+	int size() const;
+	bool empty() const;
+	bool equals(const RssStringView& v) const;
+	/**
+	* copy the bytes to string.
+	*/
+	std::string to_str() const;
+};
+
+/**
+* the bounds check policy of stream, assert the required size for each read/write.
+*/
+struct RssStreamAssertPolicy
+{
+	static const bool check = true;
+};
+
+/**
+* never check the bounds for each read/write,
+* user must require() the size before read/write.
+*/
+struct RssStreamNoCheckPolicy
+{
+	static const bool check = false;
+};
+
+/**
+* the bytes stream to read/write the network order(big-endian) fields.
+* all read/write are non-virtual and inline, for the protocol and amf0
+* decode/encode each field by the stream.
+* @remark only the grow() is virtual, which is called when require() failed.
+*/
+template<class Policy>
+class RssStreamBase
 {
 private:
 	char* p;
-	char* pp;
 	char* bytes;
 	int size;
 public:
-	RssStream();
-	virtual ~RssStream();
+	RssStreamBase();
+	virtual ~RssStreamBase();
 public:
 	/**
 	* initialize the stream from bytes.
@@ -27,72 +79,402 @@ public:
 	* @_size, must be positive, or return error.
 	* @remark, stream never free the _bytes, user must free it.
 	*/
-	virtual int initialize(char* _bytes, int _size);
+	int initialize(char* _bytes, int _size);
 	/**
 	* reset the position to beginning.
 	*/
-	virtual void reset();
+	void reset();
 	/**
 	* whether stream is empty.
 	* if empty, never read or write.
 	*/
-	virtual bool empty();
+	bool empty();
 	/**
 	* whether required size is ok.
 	* @return true if stream can read/write specified required_size bytes.
 	*/
-	virtual bool require(int required_size);
+	bool require(int required_size);
 	/**
 	* to skip some size.
 	* @size can be any value. positive to forward; nagetive to backward.
 	*/
-	virtual void skip(int size);
+	void skip(int size);
 	/**
 	* tell the current pos.
 	*/
-	virtual int pos();
+	int pos();
+	/**
+	* get the bytes at current pos, never copy.
+	*/
+	char* current();
+protected:
+	/**
+	* grow the bytes when require() failed.
+	* @return true if the required size is ok after grow.
+	*/
+	virtual bool grow(int required_size);
 public:
 	/**
 	* get 1bytes char from stream.
 	*/
-	virtual int8_t read_1bytes();
+	int8_t read_1bytes();
 	/**
 	* get 2bytes int from stream.
 	*/
-	virtual int16_t read_2bytes();
+	int16_t read_2bytes();
+	/**
+	* get 3bytes int from stream.
+	*/
+	int32_t read_3bytes();
 	/**
 	* get 4bytes int from stream.
 	*/
-	virtual int32_t read_4bytes();
+	int32_t read_4bytes();
 	/**
 	* get 8bytes int from stream.
 	*/
-	virtual int64_t read_8bytes();
+	int64_t read_8bytes();
 	/**
 	* get string from stream, length specifies by param len.
 	*/
-	virtual std::string read_string(int len);
+	std::string read_string(int len);
+	/**
+	* get the view of string from stream, never copy.
+	*/
+	RssStringView read_view(int len);
 public:
 	/**
 	* write 1bytes char to stream.
 	*/
-	virtual void write_1bytes(int8_t value);
+	void write_1bytes(int8_t value);
 	/**
 	* write 2bytes int to stream.
 	*/
-	virtual void write_2bytes(int16_t value);
+	void write_2bytes(int16_t value);
+	/**
+	* write 3bytes int to stream.
+	*/
+	void write_3bytes(int32_t value);
 	/**
 	* write 4bytes int to stream.
 	*/
-	virtual void write_4bytes(int32_t value);
+	void write_4bytes(int32_t value);
 	/**
 	* write 8bytes int to stream.
 	*/
-	virtual void write_8bytes(int64_t value);
+	void write_8bytes(int64_t value);
 	/**
 	* write string to stream
 	*/
-	virtual void write_string(std::string value);
+	void write_string(const RssStringView& value);
+};
+
+template<class Policy>
+RssStreamBase<Policy>::RssStreamBase()
+{
+	p = bytes = NULL;
+	size = 0;
+}
+
+template<class Policy>
+RssStreamBase<Policy>::~RssStreamBase()
+{
+}
+
+template<class Policy>
+int RssStreamBase<Policy>::initialize(char* _bytes, int _size)
+{
+	int ret = ERROR_SUCCESS;
+
+	if (!_bytes)
+	{
+		ret = ERROR_SYSTEM_STREAM_INIT;
+		rss_log_of(RssLogSubsystemProtocol, RssLogError, "error", true, "stream param bytes must not be NULL. ret=%d", ret);
+		return ret;
+	}
+
+	if (_size <= 0)
+	{
+		ret = ERROR_SYSTEM_STREAM_INIT;
+		rss_log_of(RssLogSubsystemProtocol, RssLogError, "error", true, "stream param size must be positive. ret=%d", ret);
+		return ret;
+	}
+
+	size = _size;
+	p = bytes = _bytes;
+
+	return ret;
+}
+
+template<class Policy>
+inline void RssStreamBase<Policy>::reset()
+{
+	p = bytes;
+}
+
+template<class Policy>
+inline bool RssStreamBase<Policy>::empty()
+{
+	return !p || !bytes || (p >= bytes + size);
+}
+
+template<class Policy>
+inline bool RssStreamBase<Policy>::require(int required_size)
+{
+	if (!empty() && (required_size <= bytes + size - p))
+	{
+		return true;
+	}
+
+	return grow(required_size);
+}
+
+template<class Policy>
+inline void RssStreamBase<Policy>::skip(int size)
+{
+	p += size;
+}
+
+template<class Policy>
+inline int RssStreamBase<Policy>::pos()
+{
+	if (empty())
+	{
+		return 0;
+	}
+
+	return p - bytes;
+}
+
+template<class Policy>
+inline char* RssStreamBase<Policy>::current()
+{
+	return p;
+}
+
+template<class Policy>
+bool RssStreamBase<Policy>::grow(int /*required_size*/)
+{
+	return false;
+}
+
+template<class Policy>
+inline int8_t RssStreamBase<Policy>::read_1bytes()
+{
+	if (Policy::check)
+	{
+		rss_assert(require(1));
+	}
+
+	return (int8_t)*p++;
+}
+
+template<class Policy>
+inline int16_t RssStreamBase<Policy>::read_2bytes()
+{
+	if (Policy::check)
+	{
+		rss_assert(require(2));
+	}
+
+	uint16_t value;
+	memcpy(&value, p, 2);
+	p += 2;
+
+	return (int16_t)__builtin_bswap16(value);
+}
+
+template<class Policy>
+inline int32_t RssStreamBase<Policy>::read_3bytes()
+{
+	if (Policy::check)
+	{
+		rss_assert(require(3));
+	}
+
+	int32_t value = ((uint8_t)p[0] << 16) | ((uint8_t)p[1] << 8) | (uint8_t)p[2];
+	p += 3;
+
+	return value;
+}
+
+template<class Policy>
+inline int32_t RssStreamBase<Policy>::read_4bytes()
+{
+	if (Policy::check)
+	{
+		rss_assert(require(4));
+	}
+
+	uint32_t value;
+	memcpy(&value, p, 4);
+	p += 4;
+
+	return (int32_t)__builtin_bswap32(value);
+}
+
+template<class Policy>
+inline int64_t RssStreamBase<Policy>::read_8bytes()
+{
+	if (Policy::check)
+	{
+		rss_assert(require(8));
+	}
+
+	uint64_t value;
+	memcpy(&value, p, 8);
+	p += 8;
+
+	return (int64_t)__builtin_bswap64(value);
+}
+
+template<class Policy>
+std::string RssStreamBase<Policy>::read_string(int len)
+{
+	if (Policy::check)
+	{
+		rss_assert(require(len));
+	}
+
+	std::string value;
+	value.append(p, len);
+
+	p += len;
+
+	return value;
+}
+
+template<class Policy>
+inline RssStringView RssStreamBase<Policy>::read_view(int len)
+{
+	if (Policy::check)
+	{
+		rss_assert(require(len));
+	}
+
+	RssStringView value(p, len);
+
+	p += len;
+
+	return value;
+}
+
+template<class Policy>
+inline void RssStreamBase<Policy>::write_1bytes(int8_t value)
+{
+	if (Policy::check)
+	{
+		rss_assert(require(1));
+	}
+
+	*p++ = value;
+}
+
+template<class Policy>
+inline void RssStreamBase<Policy>::write_2bytes(int16_t value)
+{
+	if (Policy::check)
+	{
+		rss_assert(require(2));
+	}
+
+	uint16_t v = __builtin_bswap16((uint16_t)value);
+	memcpy(p, &v, 2);
+	p += 2;
+}
+
+template<class Policy>
+inline void RssStreamBase<Policy>::write_3bytes(int32_t value)
+{
+	if (Policy::check)
+	{
+		rss_assert(require(3));
+	}
+
+	*p++ = (char)(value >> 16);
+	*p++ = (char)(value >> 8);
+	*p++ = (char)value;
+}
+
+template<class Policy>
+inline void RssStreamBase<Policy>::write_4bytes(int32_t value)
+{
+	if (Policy::check)
+	{
+		rss_assert(require(4));
+	}
+
+	uint32_t v = __builtin_bswap32((uint32_t)value);
+	memcpy(p, &v, 4);
+	p += 4;
+}
+
+template<class Policy>
+inline void RssStreamBase<Policy>::write_8bytes(int64_t value)
+{
+	if (Policy::check)
+	{
+		rss_assert(require(8));
+	}
+
+	uint64_t v = __builtin_bswap64((uint64_t)value);
+	memcpy(p, &v, 8);
+	p += 8;
+}
+
+template<class Policy>
+inline void RssStreamBase<Policy>::write_string(const RssStringView& value)
+{
+	if (Policy::check)
+	{
+		rss_assert(require(value.size()));
+	}
+
+	memcpy(p, value.data(), value.size());
+	p += value.size();
+}
+
+/**
+* the stream used by protocol and amf0, assert the bounds of each field.
+*/
+class RssStream : public RssStreamBase<RssStreamAssertPolicy>
+{
+public:
+	RssStream();
+	virtual ~RssStream();
+};
+
+/**
+* the stream to encode to, the bytes grow when require more space,
+* so the packet can encode in one pass without calc the size.
+* @remark the capacity is retained to encode the next packet.
+*/
+class RssEncodeBuffer final : public RssStream
+{
+private:
+	char* buf;
+	int capacity;
+public:
+	RssEncodeBuffer();
+	virtual ~RssEncodeBuffer();
+public:
+	/**
+	* rewind to encode from the beginning, never free the bytes.
+	*/
+	virtual int rewind();
+	/**
+	* the bytes encoded.
+	*/
+	virtual char* data();
+	/**
+	* the size of bytes encoded.
+	*/
+	virtual int length();
+protected:
+	/**
+	* grow the bytes when the required size is not ok.
+	*/
+	virtual bool grow(int required_size);
 };
 
 #endif
\ No newline at end of file
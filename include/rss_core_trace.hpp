@@ -0,0 +1,96 @@
+#ifndef RSS_CORE_TRACE_HPP
+#define RSS_CORE_TRACE_HPP
+
+/*
+#include <rss_core_trace.hpp>
+*/
+
+#include <rss_core.hpp>
+
+/**
+* the binary event trace, opt-in by the env RSS_TRACE_FILE, for example,
+* 		RSS_TRACE_FILE=./trace ./rtmp_server 1935
+* the events are written to the mmap ring file trace.<pid> as fixed-size records,
+* decode by the tool objs/tools/rss_trace_decode.
+*/
+#define RSS_TRACE_FILE_ENV "RSS_TRACE_FILE"
+// the records of ring, must be power of 2, 32MB file.
+#define RSS_TRACE_RING_RECORDS (1024 * 1024)
+#define RSS_TRACE_MAGIC "RSSTRACE"
+#define RSS_TRACE_VERSION 1
+
+/**
+* the event of message, in the order of the message passed through the server.
+*/
+enum RssTraceEvent
+{
+	// a chunk received, the bytes is the chunk payload size.
+	RssTraceEventChunkReceived = 1,
+	// an entire message received, the bytes is the message size.
+	RssTraceEventMessageComplete,
+	// the message enqueued to consumers, the stream id is the source id.
+	RssTraceEventEnqueued,
+	// the message dequeued by a consumer, the stream id is the source id.
+	RssTraceEventDequeued,
+	// the message written to socket.
+	RssTraceEventWritten,
+	RssTraceEventMax,
+};
+
+/**
+* the header of trace file, the records follow the header.
+*/
+struct RssTraceHeader
+{
+	char magic[8];
+	int32_t version;
+	int32_t record_size;
+	int64_t capacity;
+	// the total records written, the record i is at i % capacity.
+	int64_t count;
+	char reserved[32];
+};
+
+/**
+* the fixed-size record of event, 32bytes.
+*/
+struct RssTraceRecord
+{
+	// the monotonic time in us.
+	int64_t time_us;
+	int16_t event;
+	// the message type, for instance, RTMP_MSG_VideoMessage.
+	int16_t message_type;
+	// the connection id, that is the log id.
+	int32_t conn_id;
+	int32_t stream_id;
+	// the timestamp of message in ms.
+	int32_t timestamp;
+	int32_t bytes;
+	// the consumers of enqueued event, 0 for others.
+	int32_t count;
+};
+
+/**
+* the ring of trace, NULL when disabled.
+*/
+extern RssTraceHeader* rss_trace_ring;
+
+/**
+* open the trace file when the env is set.
+* @remark, the trace is disabled when open failed, never fail the server.
+*/
+extern int rss_trace_initialize();
+extern void rss_trace_write(int event, int message_type, int stream_id, int timestamp, int bytes, int count);
+
+/**
+* write the event when trace enabled, only a branch when disabled.
+*/
+#define rss_trace_event(event, message_type, stream_id, timestamp, bytes, count) \
+	do { \
+		if (__builtin_expect(rss_trace_ring != NULL, 0)) { \
+			rss_trace_write(event, message_type, stream_id, timestamp, bytes, count); \
+		} \
+	} while (0)
+
+#endif
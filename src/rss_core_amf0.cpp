@@ -1,5 +1,10 @@
+// the log subsystem of this file, see RssLogSubsystem.
+#define RSS_LOG_SUBSYSTEM RssLogSubsystemProtocol
+
 #include <rss_core_amf0.hpp>
 
+#include <stdlib.h>
+
 #include <utility>
 
 #include <rss_core_log.hpp>
@@ -39,6 +44,120 @@ int rss_amf0_write_object_eof(RssStream* stream, RssAmf0ObjectEOF*);
 int rss_amf0_read_any(RssStream* stream, RssAmf0Any*& value);
 int rss_amf0_write_any(RssStream* stream, RssAmf0Any* value);
 
+// the size of block to alloc amf0 values.
+#define RSS_AMF0_ARENA_BLOCK_SIZE 4096
+/**
+* each amf0 value is prefixed by a header which stores the arena it
+* allocated from, NULL for heap. use 16bytes to keep the alignment.
+*/
+#define RSS_AMF0_ALLOC_HEADER_SIZE 16
+
+// the arena of current scope, see RssAmf0ArenaScope.
+static RssAmf0Arena* _amf0_arena = NULL;
+// whether decode the strings as view, see RssAmf0ViewScope.
+static bool _amf0_view = false;
+
+RssAmf0Arena::RssAmf0Arena()
+{
+	p = NULL;
+	left = 0;
+}
+
+RssAmf0Arena::~RssAmf0Arena()
+{
+	std::vector<char*>::iterator it;
+	for (it = blocks.begin(); it != blocks.end(); ++it)
+	{
+		char* block = *it;
+		rss_freepa(block);
+	}
+	blocks.clear();
+}
+
+void* RssAmf0Arena::allocate(size_t size)
+{
+	// keep the alignment of values.
+	int required = (int)((size + RSS_AMF0_ALLOC_HEADER_SIZE - 1) / RSS_AMF0_ALLOC_HEADER_SIZE * RSS_AMF0_ALLOC_HEADER_SIZE);
+
+	// the large value use a dedicated block.
+	if (required > RSS_AMF0_ARENA_BLOCK_SIZE)
+	{
+		char* block = new char[required];
+		blocks.push_back(block);
+		return block;
+	}
+
+	if (left < required)
+	{
+		p = new char[RSS_AMF0_ARENA_BLOCK_SIZE];
+		left = RSS_AMF0_ARENA_BLOCK_SIZE;
+		blocks.push_back(p);
+	}
+
+	void* ptr = p;
+	p += required;
+	left -= required;
+
+	return ptr;
+}
+
+RssAmf0ViewScope::RssAmf0ViewScope()
+{
+	previous = _amf0_view;
+	_amf0_view = true;
+}
+
+RssAmf0ViewScope::~RssAmf0ViewScope()
+{
+	_amf0_view = previous;
+}
+
+RssAmf0ArenaScope::RssAmf0ArenaScope(RssAmf0Arena* arena)
+{
+	previous = _amf0_arena;
+	_amf0_arena = arena;
+}
+
+RssAmf0ArenaScope::~RssAmf0ArenaScope()
+{
+	_amf0_arena = previous;
+}
+
+void* RssAmf0Any::operator new(size_t size)
+{
+	char* p = NULL;
+
+	if (_amf0_arena)
+	{
+		p = (char*)_amf0_arena->allocate(RSS_AMF0_ALLOC_HEADER_SIZE + size);
+	}
+	else
+	{
+		p = (char*)::malloc(RSS_AMF0_ALLOC_HEADER_SIZE + size);
+		rss_assert(p != NULL);
+	}
+
+	*(RssAmf0Arena**)p = _amf0_arena;
+
+	return p + RSS_AMF0_ALLOC_HEADER_SIZE;
+}
+
+void RssAmf0Any::operator delete(void* ptr)
+{
+	if (!ptr)
+	{
+		return;
+	}
+
+	char* p = (char*)ptr - RSS_AMF0_ALLOC_HEADER_SIZE;
+
+	// the arena free the values when destroyed.
+	if (*(RssAmf0Arena**)p == NULL)
+	{
+		::free(p);
+	}
+}
+
 RssAmf0Any::RssAmf0Any()
 {
 	marker = RTMP_AMF0_Invalid;
@@ -91,6 +210,7 @@ bool RssAmf0Any::is_object_eof()
 RssAmf0String::RssAmf0String(const char* _value)
 {
 	marker = RTMP_AMF0_String;
+	is_view = false;
 	if (_value)
 	{
 		value = _value;
@@ -101,6 +221,33 @@ RssAmf0String::~RssAmf0String()
 {
 }
 
+RssStringView RssAmf0String::get_view()
+{
+	if (is_view)
+	{
+		return view;
+	}
+
+	return RssStringView(value);
+}
+
+std::string RssAmf0String::to_str()
+{
+	if (is_view)
+	{
+		return view.to_str();
+	}
+
+	return value;
+}
+
+void RssAmf0String::set_view(const RssStringView& v)
+{
+	view = v;
+	is_view = true;
+	value.clear();
+}
+
 RssAmf0Boolean::RssAmf0Boolean(bool _value)
 {
 	marker = RTMP_AMF0_Boolean;
@@ -159,8 +306,8 @@ RssUnSortedHashtable::~RssUnSortedHashtable()
 	for (it = properties.begin(); it != properties.end(); ++it)
 	{
 		RssObjectPropertyType& elem = *it;
-		RssAmf0Any* any = elem.second;
-		rss_freep(any);
+		rss_freepa(elem.owned_key);
+		rss_freep(elem.value);
 	}
 	properties.clear();
 }
@@ -172,63 +319,109 @@ int RssUnSortedHashtable::size()
 
 void RssUnSortedHashtable::clear()
 {
+	std::vector<RssObjectPropertyType>::iterator it;
+	for (it = properties.begin(); it != properties.end(); ++it)
+	{
+		RssObjectPropertyType& elem = *it;
+		rss_freepa(elem.owned_key);
+	}
 	properties.clear();
 }
 
 std::string RssUnSortedHashtable::key_at(int index)
+{
+	return key_view_at(index).to_str();
+}
+
+RssStringView RssUnSortedHashtable::key_view_at(int index)
 {
 	rss_assert(index < size());
 	RssObjectPropertyType& elem = properties[index];
-	return elem.first;
+	return elem.key;
 }
 
 RssAmf0Any* RssUnSortedHashtable::value_at(int index)
 {
 	rss_assert(index < size());
 	RssObjectPropertyType& elem = properties[index];
-	return elem.second;
+	return elem.value;
+}
+
+void RssUnSortedHashtable::set(const RssStringView& key, RssAmf0Any* value)
+{
+	// the key maybe the view of the existing key, never free it before copy.
+	if (replace(key, value))
+	{
+		return;
+	}
+
+	RssObjectPropertyType elem;
+	elem.owned_key = NULL;
+	if (key.size() > 0)
+	{
+		elem.owned_key = new char[key.size()];
+		memcpy(elem.owned_key, key.data(), key.size());
+	}
+	elem.key = RssStringView(elem.owned_key, key.size());
+	elem.value = value;
+
+	properties.push_back(elem);
 }
 
-void RssUnSortedHashtable::set(std::string key, RssAmf0Any* value)
+void RssUnSortedHashtable::set_view(const RssStringView& key, RssAmf0Any* value)
+{
+	if (replace(key, value))
+	{
+		return;
+	}
+
+	RssObjectPropertyType elem;
+	elem.owned_key = NULL;
+	elem.key = key;
+	elem.value = value;
+
+	properties.push_back(elem);
+}
+
+bool RssUnSortedHashtable::replace(const RssStringView& key, RssAmf0Any* value)
 {
 	std::vector<RssObjectPropertyType>::iterator it;
 
 	for (it = properties.begin(); it != properties.end(); ++it)
 	{
 		RssObjectPropertyType& elem = *it;
-		std::string name = elem.first;
-		RssAmf0Any* any = elem.second;
 
-		if (key == name)
+		if (elem.key.equals(key))
 		{
-			rss_freep(any);
-			properties.erase(it);
-			break;
+			if (elem.value != value)
+			{
+				rss_freep(elem.value);
+				elem.value = value;
+			}
+			return true;
 		}
 	}
 
-	properties.push_back(std::make_pair(key, value));
+	return false;
 }
 
-RssAmf0Any* RssUnSortedHashtable::get_property(std::string name)
+RssAmf0Any* RssUnSortedHashtable::get_property(const RssStringView& name)
 {
 	std::vector<RssObjectPropertyType>::iterator it;
 
 	for (it = properties.begin(); it != properties.end(); ++it)
 	{
 		RssObjectPropertyType& elem = *it;
-		std::string key = elem.first;
-		RssAmf0Any* any = elem.second;
-		if (key == name)
+		if (elem.key.equals(name))
 		{
-			return any;
+			return elem.value;
 		}
 	}
 
 	return NULL;
 }
 
-RssAmf0Any* RssUnSortedHashtable::ensure_property_string(std::string name)
+RssAmf0Any* RssUnSortedHashtable::ensure_property_string(const RssStringView& name)
 {
 	RssAmf0Any* prop = get_property(name);
 
@@ -245,7 +438,7 @@ RssAmf0Any* RssUnSortedHashtable::ensure_property_string(std::string name)
 	return prop;
 }
 
-RssAmf0Any* RssUnSortedHashtable::ensure_property_number(std::string name)
+RssAmf0Any* RssUnSortedHashtable::ensure_property_number(const RssStringView& name)
 {
 	RssAmf0Any* prop = get_property(name);
 
@@ -281,27 +474,37 @@ std::string RssAmf0Object::key_at(int index)
 	return properties.key_at(index);
 }
 
+RssStringView RssAmf0Object::key_view_at(int index)
+{
+	return properties.key_view_at(index);
+}
+
 RssAmf0Any* RssAmf0Object::value_at(int index)
 {
 	return properties.value_at(index);
 }
 
-void RssAmf0Object::set(std::string key, RssAmf0Any* value)
+void RssAmf0Object::set(const RssStringView& key, RssAmf0Any* value)
 {
 	properties.set(key, value);
 }
 
-RssAmf0Any* RssAmf0Object::get_property(std::string name)
+void RssAmf0Object::set_view(const RssStringView& key, RssAmf0Any* value)
+{
+	properties.set_view(key, value);
+}
+
+RssAmf0Any* RssAmf0Object::get_property(const RssStringView& name)
 {
 	return properties.get_property(name);
 }
 
-RssAmf0Any* RssAmf0Object::ensure_property_string(std::string name)
+RssAmf0Any* RssAmf0Object::ensure_property_string(const RssStringView& name)
 {
 	return properties.ensure_property_string(name);
 }
 
-RssAmf0Any* RssAmf0Object::ensure_property_number(std::string name)
+RssAmf0Any* RssAmf0Object::ensure_property_number(const RssStringView& name)
 {
 	return properties.ensure_property_number(name);
 }
@@ -330,22 +533,32 @@ std::string RssARssAmf0EcmaArray::key_at(int index)
 	return properties.key_at(index);
 }
 
+RssStringView RssARssAmf0EcmaArray::key_view_at(int index)
+{
+	return properties.key_view_at(index);
+}
+
 RssAmf0Any* RssARssAmf0EcmaArray::value_at(int index)
 {
 	return properties.value_at(index);
 }
 
-void RssARssAmf0EcmaArray::set(std::string key, RssAmf0Any* value)
+void RssARssAmf0EcmaArray::set(const RssStringView& key, RssAmf0Any* value)
 {
 	properties.set(key, value);
 }
 
-RssAmf0Any* RssARssAmf0EcmaArray::get_property(std::string name)
+void RssARssAmf0EcmaArray::set_view(const RssStringView& key, RssAmf0Any* value)
+{
+	properties.set_view(key, value);
+}
+
+RssAmf0Any* RssARssAmf0EcmaArray::get_property(const RssStringView& name)
 {
 	return properties.get_property(name);
 }
 
-RssAmf0Any* RssARssAmf0EcmaArray::ensure_property_string(std::string name)
+RssAmf0Any* RssARssAmf0EcmaArray::ensure_property_string(const RssStringView& name)
 {
 	return properties.ensure_property_string(name);
 }
@@ -354,6 +567,21 @@ int rss_amf0_read_utf8(RssStream* stream, std::string& value)
 {
 	int ret = ERROR_SUCCESS;
 
+	RssStringView view;
+	if ((ret = rss_amf0_read_utf8_view(stream, view)) != ERROR_SUCCESS)
+	{
+		return ret;
+	}
+
+	value = view.to_str();
+
+	return ret;
+}
+
+int rss_amf0_read_utf8_view(RssStream* stream, RssStringView& value)
+{
+	int ret = ERROR_SUCCESS;
+
 	// len
 	if (!stream->require(2))
 	{
@@ -367,6 +595,7 @@ int rss_amf0_read_utf8(RssStream* stream, std::string& value)
 	// empty string
 	if (len <= 0)
 	{
+		value = RssStringView();
 		rss_verbose("amf0 read empty string. ret=%d", ret);
 		return ret;
 	}
@@ -378,7 +607,7 @@ int rss_amf0_read_utf8(RssStream* stream, std::string& value)
 		rss_error("amf0 read string data failed. ret=%d", ret);
 		return ret;
 	}
-	std::string str = stream->read_string(len);
+	RssStringView str = stream->read_view(len);
 
 	// support utf8-1 only
 	// 1.3.1 Strings and UTF-8
@@ -395,11 +624,11 @@ int rss_amf0_read_utf8(RssStream* stream, std::string& value)
 	}
 
 	value = str;
-	rss_verbose("amf0 read string data success. str=%s", str.c_str());
+	rss_verbose("amf0 read string data success. str=%.*s", str.size(), str.data());
 
 	return ret;
 }
-int rss_amf0_write_utf8(RssStream* stream, std::string value)
+int rss_amf0_write_utf8(RssStream* stream, const RssStringView& value)
 {
 	int ret = ERROR_SUCCESS;
 
@@ -410,25 +639,25 @@ int rss_amf0_write_utf8(RssStream* stream, std::string value)
 		rss_error("amf0 write string length failed. ret=%d", ret);
 		return ret;
 	}
-	stream->write_2bytes(value.length());
-	rss_verbose("amf0 write string length success. len=%d", (int)value.length());
+	stream->write_2bytes(value.size());
+	rss_verbose("amf0 write string length success. len=%d", value.size());
 
 	// empty string
-	if (value.length() <= 0)
+	if (value.size() <= 0)
 	{
 		rss_verbose("amf0 write empty string. ret=%d", ret);
 		return ret;
 	}
 
 	// data
-	if (!stream->require(value.length()))
+	if (!stream->require(value.size()))
 	{
 		ret = ERROR_RTMP_AMF0_ENCODE;
 		rss_error("amf0 write string data failed. ret=%d", ret);
 		return ret;
 	}
 	stream->write_string(value);
-	rss_verbose("amf0 write string data success. str=%s", value.c_str());
+	rss_verbose("amf0 write string data success. str=%.*s", value.size(), value.data());
 
 	return ret;
 }
@@ -458,7 +687,52 @@ int rss_amf0_read_string(RssStream* stream, std::string& value)
 	return rss_amf0_read_utf8(stream, value);
 }
 
-int rss_amf0_write_string(RssStream* stream, std::string value)
+int rss_amf0_peek_string(RssStream* stream, char*& value, int& value_size)
+{
+	int ret = ERROR_SUCCESS;
+
+	// marker
+	if (!stream->require(1))
+	{
+		ret = ERROR_RTMP_AMF0_DECODE;
+		rss_error("amf0 peek string marker failed. ret=%d", ret);
+		return ret;
+	}
+
+	char marker = stream->read_1bytes();
+	if (marker != RTMP_AMF0_String)
+	{
+		ret = ERROR_RTMP_AMF0_DECODE;
+		rss_error("amf0 check string marker failed. "
+		          "marker=%#x, required=%#x, ret=%d", marker, RTMP_AMF0_String, ret);
+		return ret;
+	}
+
+	// len
+	if (!stream->require(2))
+	{
+		ret = ERROR_RTMP_AMF0_DECODE;
+		rss_error("amf0 peek string length failed. ret=%d", ret);
+		return ret;
+	}
+	int len = (u_int16_t)stream->read_2bytes();
+
+	// data
+	if (len > 0 && !stream->require(len))
+	{
+		ret = ERROR_RTMP_AMF0_DECODE;
+		rss_error("amf0 peek string data failed. len=%d, ret=%d", len, ret);
+		return ret;
+	}
+
+	value = stream->current();
+	value_size = len;
+	stream->skip(len);
+
+	return ret;
+}
+
+int rss_amf0_write_string(RssStream* stream, const RssStringView& value)
 {
 	int ret = ERROR_SUCCESS;
 
@@ -730,13 +1004,25 @@ int rss_amf0_read_any(RssStream* stream, RssAmf0Any*& value)
 	{
 	case RTMP_AMF0_String:
 	{
-		std::string data;
-		if ((ret = rss_amf0_read_string(stream, data)) != ERROR_SUCCESS)
+		// skip the marker, which is checked.
+		stream->skip(1);
+
+		RssStringView data;
+		if ((ret = rss_amf0_read_utf8_view(stream, data)) != ERROR_SUCCESS)
 		{
 			return ret;
 		}
-		value = new RssAmf0String();
-		rss_amf0_convert<RssAmf0String>(value)->value = data;
+
+		RssAmf0String* p = new RssAmf0String();
+		if (_amf0_view)
+		{
+			p->set_view(data);
+		}
+		else
+		{
+			p->value = data.to_str();
+		}
+		value = p;
 		return ret;
 	}
 	case RTMP_AMF0_Boolean:
@@ -822,7 +1108,7 @@ int rss_amf0_write_any(RssStream* stream, RssAmf0Any* value)
 	{
 	case RTMP_AMF0_String:
 	{
-		std::string data = rss_amf0_convert<RssAmf0String>(value)->value;
+		RssStringView data = rss_amf0_convert<RssAmf0String>(value)->get_view();
 		return rss_amf0_write_string(stream, data);
 	}
 	case RTMP_AMF0_Boolean:
@@ -883,7 +1169,7 @@ int rss_amf0_get_any_size(RssAmf0Any* value)
 	case RTMP_AMF0_String:
 	{
 		RssAmf0String* p = rss_amf0_convert<RssAmf0String>(value);
-		size += rss_amf0_get_string_size(p->value);
+		size += rss_amf0_get_string_size(p->get_view());
 		break;
 	}
 	case RTMP_AMF0_Boolean:
@@ -1040,8 +1326,8 @@ int rss_amf0_read_object(RssStream* stream, RssAmf0Object*& value)
 	while (!stream->empty())
 	{
 		// property-name: utf8 string
-		std::string property_name;
-		if ((ret =rss_amf0_read_utf8(stream, property_name)) != ERROR_SUCCESS)
+		RssStringView property_name;
+		if ((ret =rss_amf0_read_utf8_view(stream, property_name)) != ERROR_SUCCESS)
 		{
 			rss_error("amf0 object read property name failed. ret=%d", ret);
 			return ret;
@@ -1051,7 +1337,7 @@ int rss_amf0_read_object(RssStream* stream, RssAmf0Object*& value)
 		if ((ret = rss_amf0_read_any(stream, property_value)) != ERROR_SUCCESS)
 		{
 			rss_error("amf0 object read property_value failed. "
-			          "name=%s, ret=%d", property_name.c_str(), ret);
+			          "name=%.*s, ret=%d", property_name.size(), property_name.data(), ret);
 			return ret;
 		}
 
@@ -1067,7 +1353,14 @@ int rss_amf0_read_object(RssStream* stream, RssAmf0Object*& value)
 		}
 
 		// add property
-		value->set(property_name, property_value);
+		if (_amf0_view)
+		{
+			value->set_view(property_name, property_value);
+		}
+		else
+		{
+			value->set(property_name, property_value);
+		}
 	}
 
 	return ret;
@@ -1092,7 +1385,7 @@ int rss_amf0_write_object(RssStream* stream, RssAmf0Object* value)
 	// value
 	for (int i = 0; i < value->size(); i++)
 	{
-		std::string name = value->key_at(i);
+		RssStringView name = value->key_view_at(i);
 		RssAmf0Any* any = value->value_at(i);
 
 		if ((ret = rss_amf0_write_utf8(stream, name)) != ERROR_SUCCESS)
@@ -1107,7 +1400,7 @@ int rss_amf0_write_object(RssStream* stream, RssAmf0Object* value)
 			return ret;
 		}
 
-		rss_verbose("write amf0 property success. name=%s", name.c_str());
+		rss_verbose("write amf0 property success. name=%.*s", name.size(), name.data());
 	}
 
 	if ((ret = rss_amf0_write_object_eof(stream, &value->eof)) != ERROR_SUCCESS)
@@ -1161,8 +1454,8 @@ int rss_amf0_read_ecma_array(RssStream* stream, RssARssAmf0EcmaArray*& value)
 	while (!stream->empty())
 	{
 		// property-name: utf8 string
-		std::string property_name;
-		if ((ret =rss_amf0_read_utf8(stream, property_name)) != ERROR_SUCCESS)
+		RssStringView property_name;
+		if ((ret =rss_amf0_read_utf8_view(stream, property_name)) != ERROR_SUCCESS)
 		{
 			rss_error("amf0 ecma_array read property name failed. ret=%d", ret);
 			return ret;
@@ -1172,7 +1465,7 @@ int rss_amf0_read_ecma_array(RssStream* stream, RssARssAmf0EcmaArray*& value)
 		if ((ret = rss_amf0_read_any(stream, property_value)) != ERROR_SUCCESS)
 		{
 			rss_error("amf0 ecma_array read property_value failed. "
-			          "name=%s, ret=%d", property_name.c_str(), ret);
+			          "name=%.*s, ret=%d", property_name.size(), property_name.data(), ret);
 			return ret;
 		}
 
@@ -1188,7 +1481,14 @@ int rss_amf0_read_ecma_array(RssStream* stream, RssARssAmf0EcmaArray*& value)
 		}
 
 		// add property
-		value->set(property_name, property_value);
+		if (_amf0_view)
+		{
+			value->set_view(property_name, property_value);
+		}
+		else
+		{
+			value->set(property_name, property_value);
+		}
 	}
 
 	return ret;
@@ -1224,7 +1524,7 @@ int rss_amf0_write_ecma_array(RssStream* stream, RssARssAmf0EcmaArray* value)
 	// value
 	for (int i = 0; i < value->size(); i++)
 	{
-		std::string name = value->key_at(i);
+		RssStringView name = value->key_view_at(i);
 		RssAmf0Any* any = value->value_at(i);
 
 		if ((ret = rss_amf0_write_utf8(stream, name)) != ERROR_SUCCESS)
@@ -1239,7 +1539,7 @@ int rss_amf0_write_ecma_array(RssStream* stream, RssARssAmf0EcmaArray* value)
 			return ret;
 		}
 
-		rss_verbose("write amf0 property success. name=%s", name.c_str());
+		rss_verbose("write amf0 property success. name=%.*s", name.size(), name.data());
 	}
 
 	if ((ret = rss_amf0_write_object_eof(stream, &value->eof)) != ERROR_SUCCESS)
@@ -1253,12 +1553,12 @@ int rss_amf0_write_ecma_array(RssStream* stream, RssARssAmf0EcmaArray* value)
 	return ret;
 }
 
-int rss_amf0_get_utf8_size(std::string value)
+int rss_amf0_get_utf8_size(const RssStringView& value)
 {
-	return 2 + value.length();
+	return 2 + value.size();
 }
 
-int rss_amf0_get_string_size(std::string value)
+int rss_amf0_get_string_size(const RssStringView& value)
 {
 	return 1 + rss_amf0_get_utf8_size(value);
 }
@@ -1294,7 +1594,7 @@ int rss_amf0_get_object_size(RssAmf0Object* obj)
 
 	for (int i = 0; i < obj->size(); i++)
 	{
-		std::string name = obj->key_at(i);
+		RssStringView name = obj->key_view_at(i);
 		RssAmf0Any* value = obj->value_at(i);
 
 		size += rss_amf0_get_utf8_size(name);
@@ -1317,7 +1617,7 @@ int rss_amf0_get_ecma_array_size(RssARssAmf0EcmaArray* arr)
 
 	for (int i = 0; i < arr->size(); i++)
 	{
-		std::string name = arr->key_at(i);
+		RssStringView name = arr->key_view_at(i);
 		RssAmf0Any* value = arr->value_at(i);
 
 		size += rss_amf0_get_utf8_size(name);
@@ -1333,3 +1633,299 @@ int rss_amf0_get_object_eof_size()
 {
 	return 2 + 1;
 }
+
+RssAmf0Reader::RssAmf0Reader(RssStream* _stream)
+{
+	stream = _stream;
+	level = 0;
+	key_read = false;
+
+	event = RssAmf0EventEOF;
+	number = 0;
+	boolean = false;
+	count = 0;
+}
+
+RssAmf0Reader::~RssAmf0Reader()
+{
+}
+
+int RssAmf0Reader::next()
+{
+	int ret = ERROR_SUCCESS;
+
+	// in object, read the property name before value.
+	if (level > 0 && !key_read)
+	{
+		// object end without the object-end-marker.
+		if (stream->empty())
+		{
+			level--;
+			event = RssAmf0EventEnd;
+			return ret;
+		}
+
+		if ((ret = rss_amf0_read_utf8_view(stream, str)) != ERROR_SUCCESS)
+		{
+			rss_error("amf0 reader read property name failed. ret=%d", ret);
+			return ret;
+		}
+
+		// object-end-type = UTF-8-empty object-end-marker
+		if (str.empty())
+		{
+			if (!stream->require(1) || stream->read_1bytes() != RTMP_AMF0_ObjectEnd)
+			{
+				ret = ERROR_RTMP_AMF0_DECODE;
+				rss_error("amf0 reader check object eof failed. ret=%d", ret);
+				return ret;
+			}
+
+			level--;
+			event = RssAmf0EventEnd;
+			return ret;
+		}
+
+		key_read = true;
+		event = RssAmf0EventKey;
+		return ret;
+	}
+
+	if (stream->empty())
+	{
+		if (level > 0)
+		{
+			ret = ERROR_RTMP_AMF0_DECODE;
+			rss_error("amf0 reader read property value failed. ret=%d", ret);
+			return ret;
+		}
+
+		event = RssAmf0EventEOF;
+		return ret;
+	}
+
+	// the property value is read, expect the next property name.
+	key_read = false;
+
+	char marker = stream->read_1bytes();
+	switch (marker)
+	{
+	case RTMP_AMF0_Number:
+	{
+		if (!stream->require(8))
+		{
+			ret = ERROR_RTMP_AMF0_DECODE;
+			rss_error("amf0 reader read number value failed. ret=%d", ret);
+			return ret;
+		}
+
+		int64_t temp = stream->read_8bytes();
+		memcpy(&number, &temp, 8);
+
+		event = RssAmf0EventNumber;
+		return ret;
+	}
+	case RTMP_AMF0_Boolean:
+	{
+		if (!stream->require(1))
+		{
+			ret = ERROR_RTMP_AMF0_DECODE;
+			rss_error("amf0 reader read bool value failed. ret=%d", ret);
+			return ret;
+		}
+
+		boolean = (stream->read_1bytes() != 0);
+
+		event = RssAmf0EventBoolean;
+		return ret;
+	}
+	case RTMP_AMF0_String:
+	{
+		if ((ret = rss_amf0_read_utf8_view(stream, str)) != ERROR_SUCCESS)
+		{
+			return ret;
+		}
+
+		event = RssAmf0EventString;
+		return ret;
+	}
+	case RTMP_AMF0_Null:
+	{
+		event = RssAmf0EventNull;
+		return ret;
+	}
+	case RTMP_AMF0_Undefined:
+	{
+		event = RssAmf0EventUndefined;
+		return ret;
+	}
+	case RTMP_AMF0_Object:
+	{
+		level++;
+		event = RssAmf0EventBeginObject;
+		return ret;
+	}
+	case RTMP_AMF0_EcmaArray:
+	{
+		if (!stream->require(4))
+		{
+			ret = ERROR_RTMP_AMF0_DECODE;
+			rss_error("amf0 reader read ecma_array count failed. ret=%d", ret);
+			return ret;
+		}
+
+		count = stream->read_4bytes();
+		level++;
+		event = RssAmf0EventBeginEcmaArray;
+		return ret;
+	}
+	default:
+	{
+		ret = ERROR_RTMP_AMF0_INVALID;
+		rss_error("amf0 reader invalid marker. marker=%#x, ret=%d", marker, ret);
+		return ret;
+	}
+	}
+
+	return ret;
+}
+
+int RssAmf0Reader::skip()
+{
+	int ret = ERROR_SUCCESS;
+
+	if (event == RssAmf0EventKey)
+	{
+		if ((ret = next()) != ERROR_SUCCESS)
+		{
+			return ret;
+		}
+	}
+
+	if (event != RssAmf0EventBeginObject && event != RssAmf0EventBeginEcmaArray)
+	{
+		return ret;
+	}
+
+	int target = level - 1;
+	while (level > target)
+	{
+		if ((ret = next()) != ERROR_SUCCESS)
+		{
+			return ret;
+		}
+	}
+
+	return ret;
+}
+
+int RssAmf0Reader::depth()
+{
+	return level;
+}
+
+int rss_amf0_splice_string_property(RssStream* stream, const RssStringView& name, const RssStringView& value, RssEncodeBuffer* buffer)
+{
+	int ret = ERROR_SUCCESS;
+
+	RssAmf0Reader reader(stream);
+
+	char* marker = stream->current();
+	if ((ret = reader.next()) != ERROR_SUCCESS)
+	{
+		rss_error("amf0 splice read marker failed. ret=%d", ret);
+		return ret;
+	}
+
+	bool is_ecma_array = (reader.event == RssAmf0EventBeginEcmaArray);
+	if (reader.event != RssAmf0EventBeginObject && !is_ecma_array)
+	{
+		ret = ERROR_RTMP_AMF0_DECODE;
+		rss_error("amf0 splice requires object or ecma array. event=%d, ret=%d", reader.event, ret);
+		return ret;
+	}
+
+	// the bytes of properties, and the property to replace.
+	char* properties = stream->current();
+	char* found = NULL;
+	char* found_end = NULL;
+	char* end = NULL;
+	int32_t count = 0;
+
+	while (true)
+	{
+		char* p = stream->current();
+
+		if ((ret = reader.next()) != ERROR_SUCCESS)
+		{
+			rss_error("amf0 splice read property name failed. ret=%d", ret);
+			return ret;
+		}
+		if (reader.event == RssAmf0EventEnd)
+		{
+			end = p;
+			break;
+		}
+
+		bool matched = reader.str.equals(name);
+
+		if ((ret = reader.next()) != ERROR_SUCCESS || (ret = reader.skip()) != ERROR_SUCCESS)
+		{
+			rss_error("amf0 splice read property value failed. ret=%d", ret);
+			return ret;
+		}
+
+		if (matched && !found)
+		{
+			found = p;
+			found_end = stream->current();
+		}
+		else
+		{
+			count++;
+		}
+	}
+
+	// must end with the object-end-type, and no more values.
+	if (stream->current() - end != 3 || !stream->empty())
+	{
+		ret = ERROR_RTMP_AMF0_DECODE;
+		rss_error("amf0 splice check object eof failed. ret=%d", ret);
+		return ret;
+	}
+
+	buffer->write_1bytes(*marker);
+	if (is_ecma_array)
+	{
+		buffer->write_4bytes(count + 1);
+	}
+
+	if (found)
+	{
+		buffer->write_string(RssStringView(properties, found - properties));
+		buffer->write_string(RssStringView(found_end, end - found_end));
+	}
+	else
+	{
+		buffer->write_string(RssStringView(properties, end - properties));
+	}
+
+	if ((ret = rss_amf0_write_utf8(buffer, name)) != ERROR_SUCCESS)
+	{
+		rss_error("amf0 splice write property name failed. ret=%d", ret);
+		return ret;
+	}
+	if ((ret = rss_amf0_write_string(buffer, value)) != ERROR_SUCCESS)
+	{
+		rss_error("amf0 splice write property value failed. ret=%d", ret);
+		return ret;
+	}
+
+	// object-end-type = UTF-8-empty object-end-marker
+	buffer->write_2bytes(0x00);
+	buffer->write_1bytes(RTMP_AMF0_ObjectEnd);
+
+	rss_verbose("amf0 splice property success. replaced=%d, count=%d", found != NULL, count + 1);
+
+	return ret;
+}
@@ -0,0 +1,477 @@
+#include <rss_core_api.hpp>
+
+#include <stdio.h>
+#include <string.h>
+#include <strings.h>
+#include <unistd.h>
+
+#include <vector>
+
+#include <rss_core_log.hpp>
+#include <rss_core_error.hpp>
+#include <rss_core_socket.hpp>
+#include <rss_core_server.hpp>
+#include <rss_core_source.hpp>
+#include <rss_core_stat.hpp>
+
+// the timeout to recv request and send response, close the idle keep-alive conn.
+#define RSS_API_TIMEOUT_MS 5000
+// the max size of request header.
+#define RSS_API_MAX_REQUEST_SIZE 8192
+
+#define RSS_API_CONTENT_JSON "application/json"
+#define RSS_API_CONTENT_PROMETHEUS "text/plain; version=0.0.4"
+#define RSS_API_CONTENT_TEXT "text/plain"
+
+/**
+* escape the string for json value and prometheus label value.
+*/
+static std::string rss_api_escape(const std::string& str)
+{
+	std::string escaped;
+	escaped.reserve(str.length());
+
+	for (size_t i = 0; i < str.length(); i++)
+	{
+		char ch = str.at(i);
+
+		if (ch == '"' || ch == '\\')
+		{
+			escaped += '\\';
+			escaped += ch;
+		}
+		else if (ch == '\n')
+		{
+			escaped += "\\n";
+		}
+		else if ((unsigned char)ch < 0x20)
+		{
+			// ignore the control chars.
+		}
+		else
+		{
+			escaped += ch;
+		}
+	}
+
+	return escaped;
+}
+
+static const char* rss_api_reason(int status)
+{
+	switch (status)
+	{
+	case 200: return "OK";
+	case 400: return "Bad Request";
+	case 404: return "Not Found";
+	case 405: return "Method Not Allowed";
+	default: return "Unknown";
+	}
+}
+
+static void rss_api_dump_latency_json(std::stringstream& ss, RssLatencyStat& latency)
+{
+	ss << "{\"count\":" << latency.count
+	   << ",\"p50\":" << latency.p50
+	   << ",\"p99\":" << latency.p99
+	   << ",\"p999\":" << latency.p999
+	   << ",\"max\":" << latency.max
+	   << "}";
+}
+
+/**
+* dump the percentiles as summary with the quantile label, and the sum and count.
+* @labels the labels without brace, for instance, url="/live/livestream"
+*/
+static void rss_api_dump_latency_prometheus(std::stringstream& ss, const char* name, const std::string& labels, RssLatencyStat& latency)
+{
+	ss << name << "{" << labels << ",quantile=\"0.5\"} " << latency.p50 << "\n"
+	   << name << "{" << labels << ",quantile=\"0.99\"} " << latency.p99 << "\n"
+	   << name << "{" << labels << ",quantile=\"0.999\"} " << latency.p999 << "\n"
+	   << name << "_sum{" << labels << "} " << latency.sum << "\n"
+	   << name << "_count{" << labels << "} " << latency.count << "\n";
+}
+
+RssApiConnection::RssApiConnection(RssServer* rss_server, st_netfd_t client_stfd)
+	: RssConnection(rss_server, client_stfd)
+{
+	skt = new RssSocket(client_stfd);
+}
+
+RssApiConnection::~RssApiConnection()
+{
+	rss_freep(skt);
+}
+
+void RssApiConnection::remove()
+{
+	server->remove_api(this);
+}
+
+int RssApiConnection::do_cycle()
+{
+	int ret = ERROR_SUCCESS;
+
+	skt->set_recv_timeout(RSS_API_TIMEOUT_MS);
+	skt->set_send_timeout(RSS_API_TIMEOUT_MS);
+
+	bool keep_alive = true;
+	while (keep_alive)
+	{
+		std::string method, path;
+		if ((ret = read_request(method, path, keep_alive)) != ERROR_SUCCESS)
+		{
+			// the idle keep-alive conn closed or timeout.
+			if (buffer.empty() && (ret == ERROR_SOCKET_TIMEOUT || ret == ERROR_SOCKET_READ))
+			{
+				return ERROR_SUCCESS;
+			}
+
+			rss_warn("read http api request failed. ret=%d", ret);
+			response(400, RSS_API_CONTENT_TEXT, "bad request\n", false);
+			return ret;
+		}
+		rss_info("http api request. method=%s, path=%s, keep_alive=%d", method.c_str(), path.c_str(), keep_alive);
+
+		// ignore the query string.
+		size_t pos = path.find('?');
+		if (pos != std::string::npos)
+		{
+			path = path.substr(0, pos);
+		}
+
+		int status = 200;
+		const char* content_type = RSS_API_CONTENT_TEXT;
+		std::stringstream ss;
+
+		if (method != "GET")
+		{
+			status = 405;
+			ss << "only GET is allowed\n";
+		}
+		else if (path == RSS_API_PATH_STATS)
+		{
+			content_type = RSS_API_CONTENT_JSON;
+			dump_json(ss);
+		}
+		else if (path == RSS_API_PATH_METRICS)
+		{
+			content_type = RSS_API_CONTENT_PROMETHEUS;
+			dump_prometheus(ss);
+		}
+		else
+		{
+			status = 404;
+			ss << "not found, use " RSS_API_PATH_STATS " or " RSS_API_PATH_METRICS "\n";
+		}
+
+		if ((ret = response(status, content_type, ss.str(), keep_alive)) != ERROR_SUCCESS)
+		{
+			rss_error("response http api failed. ret=%d", ret);
+			return ret;
+		}
+	}
+
+	return ret;
+}
+
+int RssApiConnection::read_request(std::string& method, std::string& path, bool& keep_alive)
+{
+	int ret = ERROR_SUCCESS;
+
+	// read util the end of header.
+	size_t end = std::string::npos;
+	while ((end = buffer.find("\r\n\r\n")) == std::string::npos)
+	{
+		if (buffer.length() > RSS_API_MAX_REQUEST_SIZE)
+		{
+			ret = ERROR_HTTP_REQUEST_TOO_LARGE;
+			rss_error("http request header too large. size=%d, ret=%d", (int)buffer.length(), ret);
+			return ret;
+		}
+
+		char buf[4096];
+		ssize_t nread = 0;
+		if ((ret = skt->read(buf, sizeof(buf), &nread)) != ERROR_SUCCESS)
+		{
+			return ret;
+		}
+		buffer.append(buf, nread);
+	}
+
+	std::string header = buffer.substr(0, end + 2);
+	buffer.erase(0, end + 4);
+
+	// the request line, for example, GET /metrics HTTP/1.1
+	size_t pos = header.find("\r\n");
+	std::string line = header.substr(0, pos);
+
+	char method_buf[16], path_buf[1024], version_buf[16];
+	if (sscanf(line.c_str(), "%15s %1023s %15s", method_buf, path_buf, version_buf) != 3
+		|| strncmp(version_buf, "HTTP/1.", 7) != 0)
+	{
+		ret = ERROR_HTTP_PARSE_REQUEST;
+		rss_error("invalid http request line. ret=%d", ret);
+		return ret;
+	}
+	method = method_buf;
+	path = path_buf;
+
+	// the HTTP/1.1 is keep-alive by default, and HTTP/1.0 is close.
+	keep_alive = (strcmp(version_buf, "HTTP/1.1") == 0);
+
+	// only parse the connection header.
+	while (pos != std::string::npos && pos + 2 < header.length())
+	{
+		size_t start = pos + 2;
+		pos = header.find("\r\n", start);
+		line = header.substr(start, pos - start);
+
+		if (strncasecmp(line.c_str(), "Connection:", 11) != 0)
+		{
+			continue;
+		}
+
+		if (strcasestr(line.c_str(), "close"))
+		{
+			keep_alive = false;
+		}
+		else if (strcasestr(line.c_str(), "keep-alive"))
+		{
+			keep_alive = true;
+		}
+	}
+
+	return ret;
+}
+
+int RssApiConnection::response(int status, const char* content_type, const std::string& body, bool keep_alive)
+{
+	int ret = ERROR_SUCCESS;
+
+	char header[512];
+	int size = snprintf(header, sizeof(header),
+		"HTTP/1.1 %d %s\r\n"
+		"Server: " RTMP_SIG_RSS_KEY "/" RTMP_SIG_RSS_VERSION "\r\n"
+		"Content-Type: %s\r\n"
+		"Content-Length: %d\r\n"
+		"Connection: %s\r\n"
+		"\r\n",
+		status, rss_api_reason(status), content_type, (int)body.length(),
+		keep_alive? "keep-alive" : "close");
+
+	iovec iov[2];
+	iov[0].iov_base = header;
+	iov[0].iov_len = size;
+	iov[1].iov_base = (char*)body.data();
+	iov[1].iov_len = body.length();
+
+	ssize_t nwrite;
+	if ((ret = skt->writev(iov, 2, &nwrite)) != ERROR_SUCCESS)
+	{
+		return ret;
+	}
+
+	return ret;
+}
+
+void RssApiConnection::dump_json(std::stringstream& ss)
+{
+	RssServerStat srv;
+	std::vector<RssConnStat> conns;
+	std::vector<RssSourceStat> sources;
+
+	server->stat(srv, conns);
+	RssSource::stat_sources(sources);
+
+	ss << "{\"code\":0"
+	   << ",\"server\":{"
+	   << "\"version\":\"" RTMP_SIG_RSS_VERSION "\""
+	   << ",\"pid\":" << getpid()
+	   << ",\"uptime_ms\":" << srv.uptime_ms
+	   << ",\"conns\":" << srv.nb_conns
+	   << ",\"sources\":" << sources.size()
+	   << ",\"accepted\":" << srv.nb_accepted
+	   << ",\"recv_bytes\":" << srv.recv_bytes
+	   << ",\"send_bytes\":" << srv.send_bytes
+	   << "}";
+
+	ss << ",\"sources\":[";
+	for (size_t i = 0; i < sources.size(); i++)
+	{
+		RssSourceStat& s = sources[i];
+
+		ss << (i? "," : "") << "{"
+		   << "\"id\":" << s.id
+		   << ",\"url\":\"" << rss_api_escape(s.url) << "\""
+		   << ",\"publisher\":";
+		if (s.publisher_id)
+		{
+			ss << "{\"id\":" << s.publisher_id
+			   << ",\"ip\":\"" << rss_api_escape(s.publisher_ip) << "\""
+			   << ",\"uptime_ms\":" << s.publish_ms << "}";
+		}
+		else
+		{
+			ss << "null";
+		}
+		ss << ",\"recv_bytes\":" << s.recv_bytes
+		   << ",\"kbps\":" << s.kbps
+		   << ",\"consumers\":" << s.nb_consumers
+		   << ",\"cache_msgs\":" << s.cache_msgs
+		   << ",\"latency_us\":";
+		rss_api_dump_latency_json(ss, s.latency);
+		ss << "}";
+	}
+	ss << "]";
+
+	ss << ",\"clients\":[";
+	for (size_t i = 0; i < conns.size(); i++)
+	{
+		RssConnStat& c = conns[i];
+
+		ss << (i? "," : "") << "{"
+		   << "\"id\":" << c.id
+		   << ",\"ip\":\"" << rss_api_escape(c.ip) << "\""
+		   << ",\"role\":\"" << c.role << "\""
+		   << ",\"stream\":\"" << rss_api_escape(c.stream) << "\""
+		   << ",\"uptime_ms\":" << c.uptime_ms
+		   << ",\"recv_bytes\":" << c.recv_bytes
+		   << ",\"send_bytes\":" << c.send_bytes
+		   << ",\"recv_kbps\":" << c.recv_kbps
+		   << ",\"send_kbps\":" << c.send_kbps
+		   << ",\"queue_msgs\":" << c.queue_msgs
+		   << ",\"dropped\":" << c.dropped
+		   << ",\"latency_us\":";
+		rss_api_dump_latency_json(ss, c.latency);
+		ss << "}";
+	}
+	ss << "]";
+
+	ss << "}\n";
+}
+
+void RssApiConnection::dump_prometheus(std::stringstream& ss)
+{
+	RssServerStat srv;
+	std::vector<RssConnStat> conns;
+	std::vector<RssSourceStat> sources;
+
+	server->stat(srv, conns);
+	RssSource::stat_sources(sources);
+
+	ss << "# HELP rss_uptime_seconds The uptime of server.\n"
+	   << "# TYPE rss_uptime_seconds gauge\n"
+	   << "rss_uptime_seconds " << srv.uptime_ms / 1000.0 << "\n"
+	   << "# HELP rss_conns The alive connections.\n"
+	   << "# TYPE rss_conns gauge\n"
+	   << "rss_conns " << srv.nb_conns << "\n"
+	   << "# HELP rss_sources The sources.\n"
+	   << "# TYPE rss_sources gauge\n"
+	   << "rss_sources " << sources.size() << "\n"
+	   << "# HELP rss_accepted_total The accepted rtmp connections.\n"
+	   << "# TYPE rss_accepted_total counter\n"
+	   << "rss_accepted_total " << srv.nb_accepted << "\n"
+	   << "# HELP rss_recv_bytes_total The bytes received by all connections.\n"
+	   << "# TYPE rss_recv_bytes_total counter\n"
+	   << "rss_recv_bytes_total " << srv.recv_bytes << "\n"
+	   << "# HELP rss_send_bytes_total The bytes sent by all connections.\n"
+	   << "# TYPE rss_send_bytes_total counter\n"
+	   << "rss_send_bytes_total " << srv.send_bytes << "\n";
+
+	ss << "# HELP rss_source_publishing Whether the source is publishing.\n"
+	   << "# TYPE rss_source_publishing gauge\n";
+	for (size_t i = 0; i < sources.size(); i++)
+	{
+		ss << "rss_source_publishing{url=\"" << rss_api_escape(sources[i].url) << "\"} "
+		   << (sources[i].publisher_id? 1 : 0) << "\n";
+	}
+	ss << "# HELP rss_source_recv_bytes_total The audio and video bytes of source.\n"
+	   << "# TYPE rss_source_recv_bytes_total counter\n";
+	for (size_t i = 0; i < sources.size(); i++)
+	{
+		ss << "rss_source_recv_bytes_total{url=\"" << rss_api_escape(sources[i].url) << "\"} "
+		   << sources[i].recv_bytes << "\n";
+	}
+	ss << "# HELP rss_source_kbps The bitrate of source.\n"
+	   << "# TYPE rss_source_kbps gauge\n";
+	for (size_t i = 0; i < sources.size(); i++)
+	{
+		ss << "rss_source_kbps{url=\"" << rss_api_escape(sources[i].url) << "\"} "
+		   << sources[i].kbps << "\n";
+	}
+	ss << "# HELP rss_source_consumers The consumers of source.\n"
+	   << "# TYPE rss_source_consumers gauge\n";
+	for (size_t i = 0; i < sources.size(); i++)
+	{
+		ss << "rss_source_consumers{url=\"" << rss_api_escape(sources[i].url) << "\"} "
+		   << sources[i].nb_consumers << "\n";
+	}
+	ss << "# HELP rss_source_cache_msgs The cached metadata and sequence headers of source.\n"
+	   << "# TYPE rss_source_cache_msgs gauge\n";
+	for (size_t i = 0; i < sources.size(); i++)
+	{
+		ss << "rss_source_cache_msgs{url=\"" << rss_api_escape(sources[i].url) << "\"} "
+		   << sources[i].cache_msgs << "\n";
+	}
+
+	ss << "# HELP rss_source_latency_us The latency from arrival to written of all consumers, the quantiles are of the recent window.\n"
+	   << "# TYPE rss_source_latency_us summary\n";
+	for (size_t i = 0; i < sources.size(); i++)
+	{
+		std::string label = "url=\"" + rss_api_escape(sources[i].url) + "\"";
+		rss_api_dump_latency_prometheus(ss, "rss_source_latency_us", label, sources[i].latency);
+	}
+
+	// the labels of client.
+	std::vector<std::string> labels;
+	for (size_t i = 0; i < conns.size(); i++)
+	{
+		RssConnStat& c = conns[i];
+
+		std::stringstream label;
+		label << "id=\"" << c.id << "\",ip=\"" << rss_api_escape(c.ip) << "\",role=\"" << c.role
+		      << "\",stream=\"" << rss_api_escape(c.stream) << "\"";
+		labels.push_back(label.str());
+	}
+
+	ss << "# HELP rss_client_uptime_seconds The uptime of client.\n"
+	   << "# TYPE rss_client_uptime_seconds gauge\n";
+	for (size_t i = 0; i < conns.size(); i++)
+	{
+		ss << "rss_client_uptime_seconds" << "{" << labels[i] << "} " << conns[i].uptime_ms / 1000.0 << "\n";
+	}
+	ss << "# HELP rss_client_recv_bytes_total The bytes received from client.\n"
+	   << "# TYPE rss_client_recv_bytes_total counter\n";
+	for (size_t i = 0; i < conns.size(); i++)
+	{
+		ss << "rss_client_recv_bytes_total" << "{" << labels[i] << "} " << conns[i].recv_bytes << "\n";
+	}
+	ss << "# HELP rss_client_send_bytes_total The bytes sent to client.\n"
+	   << "# TYPE rss_client_send_bytes_total counter\n";
+	for (size_t i = 0; i < conns.size(); i++)
+	{
+		ss << "rss_client_send_bytes_total" << "{" << labels[i] << "} " << conns[i].send_bytes << "\n";
+	}
+	ss << "# HELP rss_client_queue_msgs The messages in queue of play client.\n"
+	   << "# TYPE rss_client_queue_msgs gauge\n";
+	for (size_t i = 0; i < conns.size(); i++)
+	{
+		ss << "rss_client_queue_msgs" << "{" << labels[i] << "} " << conns[i].queue_msgs << "\n";
+	}
+	ss << "# HELP rss_client_dropped_total The dropped audio and video of play client.\n"
+	   << "# TYPE rss_client_dropped_total counter\n";
+	for (size_t i = 0; i < conns.size(); i++)
+	{
+		ss << "rss_client_dropped_total" << "{" << labels[i] << "} " << conns[i].dropped << "\n";
+	}
+	ss << "# HELP rss_client_latency_us The latency from arrival to written of play client, the quantiles are of the recent window.\n"
+	   << "# TYPE rss_client_latency_us summary\n";
+	for (size_t i = 0; i < conns.size(); i++)
+	{
+		if (conns[i].latency.count > 0)
+		{
+			rss_api_dump_latency_prometheus(ss, "rss_client_latency_us", labels[i], conns[i].latency);
+		}
+	}
+}
@@ -1,6 +1,10 @@
+// the log subsystem of this file, see RssLogSubsystem.
+#define RSS_LOG_SUBSYSTEM RssLogSubsystemClient
+
 #include <rss_core_client.hpp>
 
 #include <arpa/inet.h>
+#include <stdlib.h>
 
 #include <rss_core_error.hpp>
 #include <rss_core_log.hpp>
@@ -9,10 +13,23 @@
 #include <rss_core_auto_free.hpp>
 #include <rss_core_source.hpp>
 #include <rss_core_server.hpp>
+#include <rss_core_clock.hpp>
+#include <rss_core_stat.hpp>
 
 #define RSS_PULSE_TIMEOUT_MS 100
 #define RSS_SEND_TIMEOUT_MS 5000
 
+// the window ack size of server, the peer acknowledge when received the window.
+#define RSS_ACK_WINDOW_SIZE 2500000
+// the play client is congested when the bytes in flight exceed it,
+// for the peer acknowledge every window, allow the window plus one more.
+#define RSS_CONGESTION_INFLIGHT_BYTES (2 * RSS_ACK_WINDOW_SIZE)
+
+// the max size of message to pack, the large video frame is sent directly.
+#define RSS_AGGREGATE_MAX_MSG_SIZE 4096
+// the max size of the payload of aggregate message.
+#define RSS_AGGREGATE_MAX_SIZE 65536
+
 RssClient::RssClient(RssServer* rss_server, st_netfd_t client_stfd)
 	: RssConnection(rss_server, client_stfd)
 {
@@ -20,6 +37,19 @@ RssClient::RssClient(RssServer* rss_server, st_netfd_t client_stfd)
 	req = new RssRequest();
 	res = new RssResponse();
 	rtmp = new RssRtmp(client_stfd);
+	type = RssClientUnknown;
+	consumer = NULL;
+	recv_kbps = new RssKbps();
+	send_kbps = new RssKbps();
+
+	// the AMF0/AMF3 messages to process when publish, ignore others.
+	for (int i = 0; i < RssCommandMax; i++)
+	{
+		publish_handlers[i] = NULL;
+	}
+	publish_handlers[RssCommandSetDataFrame] = &RssClient::on_publish_metadata;
+	publish_handlers[RssCommandOnMetaData] = &RssClient::on_publish_metadata;
+	publish_handlers[RssCommandFCUnpublish] = &RssClient::on_publish_unpublish;
 }
 
 RssClient::~RssClient()
@@ -27,7 +57,34 @@ RssClient::~RssClient()
 	rss_freepa(ip);
 	rss_freep(req);
 	rss_freep(res);
+	rss_freep(consumer);
 	rss_freep(rtmp);
+	rss_freep(recv_kbps);
+	rss_freep(send_kbps);
+}
+
+void RssClient::stat(RssConnStat& stat)
+{
+	RssConnection::stat(stat);
+
+	stat.ip = ip? ip : "";
+	stat.role = (type == RssClientPlay)? "play" : ((type == RssClientPublish)? "publish" : "unknown");
+	if (type != RssClientUnknown)
+	{
+		stat.stream = req->get_stream_url();
+	}
+
+	stat.recv_bytes = rtmp->get_recv_bytes();
+	stat.send_bytes = rtmp->get_send_bytes();
+	stat.recv_kbps = recv_kbps->get_kbps();
+	stat.send_kbps = send_kbps->get_kbps();
+
+	if (consumer)
+	{
+		stat.queue_msgs = consumer->get_queue_msgs();
+		stat.dropped = consumer->get_dropped();
+		stat.latency.load(consumer->get_latency());
+	}
 }
 
 int RssClient::do_cycle()
@@ -39,6 +96,7 @@ int RssClient::do_cycle()
 		rss_error("get peer ip failed. ret=%d", ret);
 		return ret;
 	}
+	log_context->set_ip(ip);
 	rss_verbose("get peer ip success. ip=%s", ip);
 
 	rtmp->set_recv_timeout(RSS_SEND_TIMEOUT_MS);
@@ -62,7 +120,10 @@ int RssClient::do_cycle()
 	          req->schema.c_str(), req->vhost.c_str(), req->port.c_str(),
 	          req->app.c_str());
 
-	if ((ret = rtmp->set_window_ack_size(2.5 * 1000 * 1000)) != ERROR_SUCCESS)
+	// sendout the connect app response in one write.
+	rtmp->start_batch();
+
+	if ((ret = rtmp->set_window_ack_size(RSS_ACK_WINDOW_SIZE)) != ERROR_SUCCESS)
 	{
 		rss_error("set window acknowledgement size failed. ret=%d", ret);
 		return ret;
@@ -90,13 +151,25 @@ int RssClient::do_cycle()
 	}
 	rss_verbose("on_bw_done success");
 
-	RssClientType type;
+	if ((ret = rtmp->flush_batch()) != ERROR_SUCCESS)
+	{
+		rss_error("send connect app response failed. ret=%d", ret);
+		return ret;
+	}
+	rss_verbose("send connect app response success");
+
 	if ((ret = rtmp->identify_client(res->stream_id, type, req->stream)) != ERROR_SUCCESS)
 	{
 		rss_error("identify client failed. ret=%d", ret);
 		return ret;
 	}
 	rss_verbose("identify client success. type=%d, stream_name=%s", type, req->stream.c_str());
+	log_context->set_role((type == RssClientPlay)? "play" : ((type == RssClientPublish)? "publish" : "unknown"));
+	log_context->set_stream(req->get_stream_url().c_str());
+
+	// the set chunk size is sentout with the start play/publish response,
+	// the start play/publish flush the batch.
+	rtmp->start_batch();
 
 	// TODO: read from config.
 	int chunk_size = 4096;
@@ -136,7 +209,12 @@ int RssClient::do_cycle()
 			return ret;
 		}
 		rss_info("start to publish stream %s success", req->stream.c_str());
-		return streaming_publish(source);
+
+		source->on_publish(id, ip);
+		ret = streaming_publish(source);
+		source->on_unpublish();
+
+		return ret;
 	}
 	default:
 	{
@@ -153,7 +231,7 @@ int RssClient::streaming_play(RssSource* source)
 {
 	int ret = ERROR_SUCCESS;
 
-	RssConsumer* consumer = NULL;
+	// the consumer is freed with the client.
 	if ((ret = source->create_consumer(consumer)) != ERROR_SUCCESS)
 	{
 		rss_error("create consumer failed. ret=%d", ret);
@@ -161,18 +239,20 @@ int RssClient::streaming_play(RssSource* source)
 	}
 
 	rss_assert(consumer != NULL);
-	RssAutoFree(RssConsumer, consumer, false);
 	rss_verbose("consumer created success.");
 
 	rtmp->set_recv_timeout(RSS_PULSE_TIMEOUT_MS);
 
-	int64_t report_time = 0;
-	int64_t reported_time = 0;
+	// whether pack the small messages, the startup setting of process env.
+	const char* env = getenv(RSS_AGGREGATE_EGRESS_ENV);
+	bool aggregate_egress = env && atoi(env) != 0;
+	rss_trace("start play, aggregate egress=%d", aggregate_egress);
+
+	int64_t starttime = RssClock::time_ms();
+	int64_t reported_time = starttime;
 
 	while (true)
 	{
-		report_time += RSS_PULSE_TIMEOUT_MS;
-
 		// switch to other st-threads.
 		st_usleep(0);
 
@@ -183,7 +263,7 @@ int RssClient::streaming_play(RssSource* source)
 			RssCommonMessage* msg = NULL;
 			ctl_msg_ret = ret = rtmp->recv_message(&msg);
 
-			rss_verbose("play loop recv message. ret=%d", ret);
+			rss_verbose_limit("play loop recv message. ret=%d", ret);
 			if (ret != ERROR_SUCCESS && ret != ERROR_SOCKET_TIMEOUT)
 			{
 				rss_error("recv client control message failed. ret=%d", ret);
@@ -197,6 +277,9 @@ int RssClient::streaming_play(RssSource* source)
 			}
 		}
 
+		// drop the messages when too many bytes in flight, by the acknowledgement of client.
+		consumer->set_congested(rtmp->get_inflight_bytes() > RSS_CONGESTION_INFLIGHT_BYTES);
+
 		// get messages from consumer.
 		RssSharedPtrMessage** msgs = NULL;
 		int count = 0;
@@ -206,15 +289,18 @@ int RssClient::streaming_play(RssSource* source)
 			return ret;
 		}
 
+		send_kbps->sample(rtmp->get_send_bytes());
+
 		// reportable
-		if (server->can_report(reported_time, report_time))
+		if (server->can_report(reported_time))
 		{
-			rss_trace("play report, time=%" PRId64 ", ctl_msg_ret=%d, msgs=%d", report_time, ctl_msg_ret, count);
+			rss_trace("play report, time=%" PRId64 ", ctl_msg_ret=%d, msgs=%d, send=%" PRId64 ", inflight=%" PRId64 ", dropped=%" PRId64,
+			          reported_time - starttime, ctl_msg_ret, count, rtmp->get_send_bytes(), rtmp->get_inflight_bytes(), consumer->get_dropped());
 		}
 
 		if (count <= 0)
 		{
-			rss_verbose("no packets in queue.");
+			rss_verbose_limit("no packets in queue.");
 			continue;
 		}
 		RssAutoFree(RssSharedPtrMessage*, msgs, true);
@@ -222,7 +308,20 @@ int RssClient::streaming_play(RssSource* source)
 		// sendout messages
 		for (int i = 0; i < count; i++)
 		{
+			int packed = 0;
+			if (aggregate_egress && (ret = send_aggregate(msgs + i, count - i, packed)) != ERROR_SUCCESS)
+			{
+				rss_error("send aggregate message to client failed. ret=%d", ret);
+				return ret;
+			}
+			if (packed > 0)
+			{
+				i += packed - 1;
+				continue;
+			}
+
 			RssSharedPtrMessage* msg = msgs[i];
+			int64_t arrival_us = msg->get_arrival();
 
 			// the send_message will free the msg,
 			// so set the msgs[i] to NULL.
@@ -233,8 +332,73 @@ int RssClient::streaming_play(RssSource* source)
 				rss_error("send message to client failed. ret=%d", ret);
 				return ret;
 			}
+			consumer->on_sent(arrival_us);
+		}
+	}
+
+	return ret;
+}
+
+int RssClient::send_aggregate(RssSharedPtrMessage** msgs, int count, int& packed)
+{
+	int ret = ERROR_SUCCESS;
+
+	// find the consecutive small audio and video messages.
+	int size = 0;
+	int nb_msgs = 0;
+	for (; nb_msgs < count; nb_msgs++)
+	{
+		RssSharedPtrMessage* msg = msgs[nb_msgs];
+
+		if (!msg->header.is_audio() && !msg->header.is_video())
+		{
+			break;
+		}
+		if (msg->size > RSS_AGGREGATE_MAX_MSG_SIZE)
+		{
+			break;
+		}
+		if (size + msg->size > RSS_AGGREGATE_MAX_SIZE)
+		{
+			break;
+		}
+
+		size += msg->size;
+	}
+
+	// ignore the single message, which is sent directly.
+	if (nb_msgs <= 1)
+	{
+		return ret;
+	}
+
+	RssSharedPtrMessage* aggregate = NULL;
+	if ((ret = rss_rtmp_pack_aggregate(msgs, nb_msgs, aggregate)) != ERROR_SUCCESS)
+	{
+		rss_error("pack aggregate message failed. ret=%d", ret);
+		return ret;
+	}
+
+	// the send_message will free the aggregate.
+	ret = rtmp->send_message(aggregate);
+
+	// the packed messages are copied, record the latency and free them.
+	for (int i = 0; i < nb_msgs; i++)
+	{
+		if (ret == ERROR_SUCCESS)
+		{
+			consumer->on_sent(msgs[i]->get_arrival());
 		}
+		rss_freep(msgs[i]);
+	}
+	packed = nb_msgs;
+
+	if (ret != ERROR_SUCCESS)
+	{
+		rss_error("send aggregate message failed. ret=%d", ret);
+		return ret;
 	}
+	rss_verbose_limit("send aggregate message success. msgs=%d, size=%d", nb_msgs, size);
 
 	return ret;
 }
@@ -256,6 +420,7 @@ int RssClient::streaming_publish(RssSource* source)
 		}
 
 		RssAutoFree(RssCommonMessage, msg, false);
+		recv_kbps->sample(rtmp->get_recv_bytes());
 
 		// process audio packet
 		if (msg->header.is_audio() && ((ret = source->on_audio(msg)) != ERROR_SUCCESS))
@@ -269,57 +434,80 @@ int RssClient::streaming_publish(RssSource* source)
 			rss_error("process video message failed. ret=%d", ret);
 			return ret;
 		}
+		// process aggregate packet, demux to audio and video
+		if (msg->header.is_aggregate() && ((ret = source->on_aggregate(msg)) != ERROR_SUCCESS))
+		{
+			rss_error("process aggregate message failed. ret=%d", ret);
+			return ret;
+		}
 
-		// process onMetaData
-		if (msg->header.is_amf0_data() || msg->header.is_amf3_data())
+		// process the AMF0/AMF3 command and data message,
+		// only peek the command name, the handler decode the message when required.
+		if (msg->header.is_amf0_data() || msg->header.is_amf3_data()
+		    || msg->header.is_amf0_command() || msg->header.is_amf3_command())
 		{
-			if ((ret = msg->decode_packet()) != ERROR_SUCCESS)
+			RssCommandId command_id = RssCommandUnknown;
+			if ((ret = msg->peek_command(command_id)) != ERROR_SUCCESS)
 			{
-				rss_error("decode onMetaData message failed. ret=%d", ret);
+				rss_error("peek AMF0/AMF3 message failed. ret=%d", ret);
 				return ret;
 			}
 
-			RssPacket* pkt = msg->get_packet();
-			if (dynamic_cast<RssOnMetaDataPacket*>(pkt))
+			RssPublishHandler handler = publish_handlers[command_id];
+			if (!handler)
 			{
-				RssOnMetaDataPacket* metadata = dynamic_cast<RssOnMetaDataPacket*>(pkt);
-				if ((ret = source->on_meta_data(msg, metadata)) != ERROR_SUCCESS)
-				{
-					rss_error("process onMetaData message failed. ret=%d", ret);
-					return ret;
-				}
-				rss_trace("process onMetaData message success.");
+				rss_verbose("ignore AMF0/AMF3 message. type=%d, command_id=%d", msg->header.message_type, command_id);
 				continue;
 			}
 
-			rss_trace("ignore AMF0/AMF3 data message.");
-			continue;
-		}
-
-		// process UnPublish event.
-		if (msg->header.is_amf0_command() || msg->header.is_amf3_command())
-		{
-			if ((ret = msg->decode_packet()) != ERROR_SUCCESS)
+			bool unpublished = false;
+			if ((ret = (this->*handler)(source, msg, unpublished)) != ERROR_SUCCESS)
 			{
-				rss_error("decode unpublish message failed. ret=%d", ret);
 				return ret;
 			}
 
-			RssPacket* pkt = msg->get_packet();
-			if (dynamic_cast<RssFMLEStartPacket*>(pkt))
+			if (unpublished)
 			{
-				RssFMLEStartPacket* unpublish = dynamic_cast<RssFMLEStartPacket*>(pkt);
-				return rtmp->fmle_unpublish(res->stream_id, unpublish->transaction_id);
+				return ret;
 			}
-
-			rss_trace("ignore AMF0/AMF3 command message.");
-			continue;
 		}
 	}
 
 	return ret;
 }
 
+int RssClient::on_publish_metadata(RssSource* source, RssCommonMessage* msg, bool& /*unpublished*/)
+{
+	int ret = ERROR_SUCCESS;
+
+	if ((ret = source->on_meta_data(msg)) != ERROR_SUCCESS)
+	{
+		rss_error("process onMetaData message failed. ret=%d", ret);
+		return ret;
+	}
+	rss_trace("process onMetaData message success.");
+
+	return ret;
+}
+
+int RssClient::on_publish_unpublish(RssSource* /*source*/, RssCommonMessage* msg, bool& unpublished)
+{
+	int ret = ERROR_SUCCESS;
+
+	if ((ret = msg->decode_packet()) != ERROR_SUCCESS)
+	{
+		rss_error("decode unpublish message failed. ret=%d", ret);
+		return ret;
+	}
+
+	RssFMLEStartPacket* unpublish = dynamic_cast<RssFMLEStartPacket*>(msg->get_packet());
+	rss_assert(unpublish != NULL);
+
+	unpublished = true;
+
+	return rtmp->fmle_unpublish(res->stream_id, unpublish->transaction_id);
+}
+
 int RssClient::get_peer_ip()
 {
 	int ret = ERROR_SUCCESS;
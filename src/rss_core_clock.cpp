@@ -0,0 +1,137 @@
+#include <rss_core_clock.hpp>
+
+#include <stdio.h>
+#include <time.h>
+#include <sys/time.h>
+
+#include <st.h>
+
+#include <rss_core_log.hpp>
+#include <rss_core_error.hpp>
+
+// the interval to update the clock.
+#define RSS_CLOCK_RESOLUTION_MS 1
+// %d-%02d-%02d %02d:%02d:%02d.%03d
+#define RSS_CLOCK_DATE_SIZE 32
+
+bool RssClock::started = false;
+int64_t RssClock::now_ms = 0;
+int64_t RssClock::date_second = -1;
+char RssClock::date[RSS_CLOCK_DATE_SIZE] = {0};
+int RssClock::date_ms_offset = 0;
+int64_t RssClock::max_lag_us = 0;
+
+int RssClock::start()
+{
+	int ret = ERROR_SUCCESS;
+
+	if (started)
+	{
+		return ret;
+	}
+
+	update();
+
+	if (st_thread_create(clock_thread, NULL, 0, 0) == NULL)
+	{
+		ret = ERROR_ST_CREATE_CLOCK_THREAD;
+		rss_error("st_thread_create clock thread error. ret=%d", ret);
+		return ret;
+	}
+	rss_verbose("create st clock thread success.");
+
+	started = true;
+
+	return ret;
+}
+
+void RssClock::update()
+{
+	timeval tv;
+	if (gettimeofday(&tv, NULL) == -1)
+	{
+		return;
+	}
+
+	now_ms = (int64_t)tv.tv_sec * 1000 + tv.tv_usec / 1000;
+
+	// format the date once per second.
+	if (tv.tv_sec != date_second)
+	{
+		struct tm tm;
+		if (localtime_r(&tv.tv_sec, &tm) == NULL)
+		{
+			return;
+		}
+
+		int size = snprintf(date, RSS_CLOCK_DATE_SIZE, "%d-%02d-%02d %02d:%02d:%02d.000",
+		                    1900 + tm.tm_year, 1 + tm.tm_mon, tm.tm_mday, tm.tm_hour, tm.tm_min, tm.tm_sec);
+		if (size < 3 || size >= RSS_CLOCK_DATE_SIZE)
+		{
+			return;
+		}
+
+		date_ms_offset = size - 3;
+		date_second = tv.tv_sec;
+	}
+
+	// splice the ms to the cached date.
+	int ms = (int)(tv.tv_usec / 1000);
+	date[date_ms_offset] = '0' + ms / 100;
+	date[date_ms_offset + 1] = '0' + ms / 10 % 10;
+	date[date_ms_offset + 2] = '0' + ms % 10;
+}
+
+int64_t RssClock::time_ms()
+{
+	if (!started)
+	{
+		update();
+	}
+
+	return now_ms;
+}
+
+const char* RssClock::format_date()
+{
+	if (!started)
+	{
+		update();
+	}
+
+	return date;
+}
+
+int64_t RssClock::reset_max_lag()
+{
+	int64_t lag = max_lag_us;
+	max_lag_us = 0;
+	return lag;
+}
+
+int64_t RssClock::now_us()
+{
+	timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (int64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+void* RssClock::clock_thread(void* /*arg*/)
+{
+	while (true)
+	{
+		timespec before, after;
+		clock_gettime(CLOCK_MONOTONIC, &before);
+
+		st_usleep(RSS_CLOCK_RESOLUTION_MS * 1000);
+
+		clock_gettime(CLOCK_MONOTONIC, &after);
+		int64_t lag = (int64_t)(after.tv_sec - before.tv_sec) * 1000000
+			+ (after.tv_nsec - before.tv_nsec) / 1000 - RSS_CLOCK_RESOLUTION_MS * 1000;
+		max_lag_us = rss_max(max_lag_us, lag);
+
+		update();
+	}
+
+	return NULL;
+}
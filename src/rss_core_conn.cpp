@@ -3,11 +3,15 @@
 #include <rss_core_log.hpp>
 #include <rss_core_error.hpp>
 #include <rss_core_server.hpp>
+#include <rss_core_clock.hpp>
+#include <rss_core_stat.hpp>
 
 RssConnection::RssConnection(RssServer* rss_server, st_netfd_t client_stfd)
 {
 	server = rss_server;
 	stfd = client_stfd;
+	id = 0;
+	create_time = RssClock::time_ms();
 }
 
 RssConnection::~RssConnection()
@@ -34,11 +38,19 @@ int RssConnection::start()
 	return ret;
 }
 
+void RssConnection::stat(RssConnStat& stat)
+{
+	stat.id = id;
+	stat.uptime_ms = RssClock::time_ms() - create_time;
+}
+
 void RssConnection::cycle()
 {
 	int ret = ERROR_SUCCESS;
 
 	log_context->generate_id();
+	id = log_context->get_id();
+
 	ret = do_cycle();
 
 	// if socket io error, set to closed.
@@ -59,6 +71,11 @@ void RssConnection::cycle()
 		rss_trace("client disconnect peer. ret=%d", ret);
 	}
 
+	remove();
+}
+
+void RssConnection::remove()
+{
 	server->remove(this);
 }
 
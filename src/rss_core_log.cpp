@@ -1,13 +1,32 @@
 #include <rss_core_log.hpp>
 
+#include <stdlib.h>
 #include <string.h>
-#include <sys/time.h>
+#include <stdarg.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/stat.h>
 
 #include <string>
-#include <map>
+#include <atomic>
 
 #include <st.h>
 
+#include <rss_core_error.hpp>
+#include <rss_core_clock.hpp>
+
+// the max size of a log line, the line is truncated when exceed.
+#define RSS_LOG_LINE_SIZE 4096
+// the size of ring buffer, must be power of 2, the line is dropped when full.
+#define RSS_LOG_RING_SIZE (4 * 1024 * 1024)
+// the interval for the writer thread to check the ring buffer.
+#define RSS_LOG_WRITE_INTERVAL_US 10000
+// the max size of log file, rotate to the .1 file when exceed.
+#define RSS_LOG_MAX_FILE_SIZE (128 * 1024 * 1024)
+// the max time to wait for the lines written when flush.
+#define RSS_LOG_FLUSH_TIMEOUT_US 1000000
+
 ILogContext::ILogContext()
 {
 }
@@ -19,68 +38,229 @@ ILogContext::~ILogContext()
 class LogContext : public ILogContext
 {
 private:
-	class DateTime
-	{
-	private:
-		// %d-%02d-%02d %02d:%02d:%02d.%03d
-#define DATE_LEN 24
-		char time_data[DATE_LEN];
-	public:
-		DateTime();
-		virtual ~DateTime();
-	public:
-		virtual const char* format_time();
+	/**
+	* the context of st-thread, stored in the st thread specific data,
+	* freed when the st-thread terminates.
+	*/
+	struct Context
+	{
+		int id;
+		std::string ip;
+		std::string role;
+		std::string stream;
+		// the formated context, id][ip][role][stream
+		std::string desc;
 	};
-private:
-	DateTime time;
-	std::map<st_thread_t, int> cache;
+	// the key of st thread specific data, -1 if not created.
+	int key;
 public:
 	LogContext();
 	virtual ~LogContext();
 public:
 	virtual void generate_id();
 	virtual int get_id();
+	virtual void set_ip(const char* ip);
+	virtual void set_role(const char* role);
+	virtual void set_stream(const char* stream);
+	virtual const char* format_context();
 public:
 	virtual const char* format_time();
+private:
+	virtual Context* get_context();
+	virtual void update_desc(Context* ctx);
+	static void destroy_context(void* ctx);
 };
 
 ILogContext* log_context = new LogContext();
 
-LogContext::DateTime::DateTime()
+int8_t rss_log_levels[RssLogSubsystemMax] = {
+	RSS_LOG_DEFAULT_LEVEL, RSS_LOG_DEFAULT_LEVEL, RSS_LOG_DEFAULT_LEVEL,
+	RSS_LOG_DEFAULT_LEVEL, RSS_LOG_DEFAULT_LEVEL,
+};
+
+// the names of subsystems and levels in level file.
+static const char* rss_log_subsystem_names[RssLogSubsystemMax] = {
+	"server", "protocol", "rtmp", "client", "source",
+};
+static const char* rss_log_level_names[RssLogDisabled + 1] = {
+	"verbose", "info", "trace", "warn", "error", "disabled",
+};
+
+int rss_log_reload(const char* file)
 {
-	memset(time_data, 0, DATE_LEN);
+	int ret = ERROR_SUCCESS;
+
+	int8_t levels[RssLogSubsystemMax];
+	for (int i = 0; i < RssLogSubsystemMax; i++)
+	{
+		levels[i] = RSS_LOG_DEFAULT_LEVEL;
+	}
+
+	FILE* f = fopen(file, "r");
+	if (f)
+	{
+		char line[256];
+		while (fgets(line, sizeof(line), f))
+		{
+			// trim the spaces and new line.
+			char* p = line;
+			while (*p == ' ' || *p == '\t')
+			{
+				p++;
+			}
+			char* end = p + strlen(p);
+			while (end > p && (end[-1] == '\n' || end[-1] == '\r' || end[-1] == ' ' || end[-1] == '\t'))
+			{
+				*--end = 0;
+			}
+
+			// ignore the empty line and comments.
+			if (*p == 0 || *p == '#')
+			{
+				continue;
+			}
+
+			char* value = strchr(p, '=');
+			if (!value)
+			{
+				rss_warn("ignore invalid log level line %s", p);
+				continue;
+			}
+			*value++ = 0;
+
+			int level = -1;
+			for (int i = 0; i <= RssLogDisabled; i++)
+			{
+				if (strcmp(value, rss_log_level_names[i]) == 0)
+				{
+					level = i;
+				}
+			}
+
+			int subsystem = -1;
+			for (int i = 0; i < RssLogSubsystemMax; i++)
+			{
+				if (strcmp(p, rss_log_subsystem_names[i]) == 0)
+				{
+					subsystem = i;
+				}
+			}
+
+			if (level < 0 || (subsystem < 0 && strcmp(p, "all") != 0))
+			{
+				rss_warn("ignore invalid log level %s=%s", p, value);
+				continue;
+			}
+
+			for (int i = 0; i < RssLogSubsystemMax; i++)
+			{
+				if (subsystem < 0 || subsystem == i)
+				{
+					levels[i] = (int8_t)level;
+				}
+			}
+		}
+		fclose(f);
+	}
+
+	memcpy(rss_log_levels, levels, sizeof(levels));
+
+	rss_trace("reload log levels from %s, server=%s, protocol=%s, rtmp=%s, client=%s, source=%s", file,
+	          rss_log_level_names[levels[RssLogSubsystemServer]], rss_log_level_names[levels[RssLogSubsystemProtocol]],
+	          rss_log_level_names[levels[RssLogSubsystemRtmp]], rss_log_level_names[levels[RssLogSubsystemClient]],
+	          rss_log_level_names[levels[RssLogSubsystemSource]]);
+
+	return ret;
 }
 
-LogContext::DateTime::~DateTime()
+RssLogLimiter::RssLogLimiter()
 {
+	second = 0;
+	nb_lines = 0;
+	nb_suppressed = 0;
 }
 
-const char* LogContext::DateTime::format_time()
+bool RssLogLimiter::allow(const char* level, const char* function)
 {
-	// clock time
-	timeval tv;
-	if (gettimeofday(&tv, NULL) == -1)
+	int64_t now = RssClock::time_ms() / 1000;
+
+	if (now != second)
 	{
-		return "";
+		second = now;
+		nb_lines = 0;
 	}
-	// to calendar time
-	struct tm* tm;
-	if ((tm = localtime(&tv.tv_sec)) == NULL)
+
+	if (nb_lines >= RSS_LOG_LIMIT_PER_SECOND)
 	{
-		return "";
+		nb_suppressed++;
+		return false;
 	}
+	nb_lines++;
 
-	// log header, the time/pid/level of log
-	// reserved 1bytes for the new line.
-	snprintf(time_data, DATE_LEN, "%d-%02d-%02d %02d:%02d:%02d.%03d",
-	         1900 + tm->tm_year, 1 + tm->tm_mon, tm->tm_mday, tm->tm_hour, tm->tm_min, tm->tm_sec,
-	         (int)(tv.tv_usec / 1000));
+	if (nb_suppressed > 0)
+	{
+		log_writer->write(level, function, false, "suppressed %d lines by limit %d/s", nb_suppressed, RSS_LOG_LIMIT_PER_SECOND);
+		nb_suppressed = 0;
+	}
 
-	return time_data;
+	return true;
+}
+
+ILogWriter::ILogWriter()
+{
+}
+
+ILogWriter::~ILogWriter()
+{
 }
 
+/**
+* the async log writer, the server thread format the line to a ring buffer,
+* the writer thread write the ring buffer to file in batch.
+* @remark the st-threads run in the server thread, so the ring buffer is
+* 		single producer and single consumer, which is lock-free.
+*/
+class AsyncLogWriter : public ILogWriter
+{
+private:
+	std::string file;
+	// the fd to write to, -1 to write stdout directly when not started.
+	int fd;
+	int64_t file_size;
+	bool started;
+	pthread_t tid;
+private:
+	char* ring;
+	// the bytes written to ring buffer, updated by the server thread.
+	std::atomic<uint64_t> head;
+	// the bytes written to file, updated by the writer thread.
+	std::atomic<uint64_t> tail;
+	std::atomic<int64_t> dropped;
+	// the dropped lines reported to file, used by the writer thread.
+	int64_t reported_dropped;
+public:
+	AsyncLogWriter();
+	virtual ~AsyncLogWriter();
+public:
+	virtual int initialize(const char* _file);
+	virtual void write(const char* level, const char* function, bool print_errno, const char* fmt, ...)
+		__attribute__((format(printf, 5, 6)));
+	virtual void flush();
+	virtual int64_t get_dropped();
+private:
+	virtual void enqueue(const char* line, int size);
+	static void* writer_thread(void* arg);
+	virtual void cycle();
+	virtual void write_file(const char* bytes, int size);
+	virtual void rotate();
+	static void flush_at_exit();
+};
+
+ILogWriter* log_writer = new AsyncLogWriter();
+
 LogContext::LogContext()
 {
+	key = -1;
 }
 
 LogContext::~LogContext()
@@ -90,16 +270,361 @@ LogContext::~LogContext()
 void LogContext::generate_id()
 {
 	static int id = 1;
-	cache[st_thread_self()] = id++;
+
+	if (key < 0 && st_key_create(&key, destroy_context) != 0)
+	{
+		key = -1;
+		return;
+	}
+
+	Context* ctx = get_context();
+	if (!ctx)
+	{
+		ctx = new Context();
+		st_thread_setspecific(key, ctx);
+	}
+
+	ctx->id = id++;
+	ctx->ip.clear();
+	ctx->role.clear();
+	ctx->stream.clear();
+	update_desc(ctx);
 }
 
 int LogContext::get_id()
 {
-	return cache[st_thread_self()];
+	Context* ctx = get_context();
+	return ctx? ctx->id : 0;
+}
+
+void LogContext::set_ip(const char* ip)
+{
+	Context* ctx = get_context();
+	if (ctx)
+	{
+		ctx->ip = ip;
+		update_desc(ctx);
+	}
+}
+
+void LogContext::set_role(const char* role)
+{
+	Context* ctx = get_context();
+	if (ctx)
+	{
+		ctx->role = role;
+		update_desc(ctx);
+	}
+}
+
+void LogContext::set_stream(const char* stream)
+{
+	Context* ctx = get_context();
+	if (ctx)
+	{
+		ctx->stream = stream;
+		update_desc(ctx);
+	}
+}
+
+const char* LogContext::format_context()
+{
+	Context* ctx = get_context();
+	return ctx? ctx->desc.c_str() : "0";
+}
+
+LogContext::Context* LogContext::get_context()
+{
+	// the st is not initialized, or the key not created.
+	if (key < 0 || !st_thread_self())
+	{
+		return NULL;
+	}
+
+	return (Context*)st_thread_getspecific(key);
+}
+
+void LogContext::update_desc(Context* ctx)
+{
+	char id[16];
+	snprintf(id, sizeof(id), "%d", ctx->id);
+	ctx->desc = id;
+
+	if (!ctx->ip.empty())
+	{
+		ctx->desc += "][" + ctx->ip;
+	}
+	if (!ctx->role.empty())
+	{
+		ctx->desc += "][" + ctx->role;
+	}
+	if (!ctx->stream.empty())
+	{
+		ctx->desc += "][" + ctx->stream;
+	}
+}
+
+void LogContext::destroy_context(void* ctx)
+{
+	Context* context = (Context*)ctx;
+	rss_freep(context);
 }
 
 const char* LogContext::format_time()
 {
-	return time.format_time();
+	return RssClock::format_date();
+}
+
+
+AsyncLogWriter::AsyncLogWriter()
+{
+	fd = -1;
+	file_size = 0;
+	started = false;
+	tid = 0;
+
+	ring = NULL;
+	head = 0;
+	tail = 0;
+	dropped = 0;
+	reported_dropped = 0;
+}
+
+AsyncLogWriter::~AsyncLogWriter()
+{
+	// the writer thread never quit, never free the ring buffer.
+}
+
+int AsyncLogWriter::initialize(const char* _file)
+{
+	int ret = ERROR_SUCCESS;
+
+	if (started)
+	{
+		return ret;
+	}
+
+	if (!_file)
+	{
+		fd = STDOUT_FILENO;
+	}
+	else
+	{
+		file = _file;
+		if ((fd = ::open(_file, O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644)) == -1)
+		{
+			ret = ERROR_SYSTEM_LOG_INIT;
+			rss_error("open log file %s failed. ret=%d", _file, ret);
+			return ret;
+		}
+
+		struct stat st;
+		if (fstat(fd, &st) == 0)
+		{
+			file_size = st.st_size;
+		}
+	}
+
+	ring = new char[RSS_LOG_RING_SIZE];
+
+	if (pthread_create(&tid, NULL, writer_thread, this) != 0)
+	{
+		ret = ERROR_SYSTEM_LOG_INIT;
+		rss_error("create log writer thread failed. ret=%d", ret);
+		return ret;
+	}
+
+	started = true;
+	atexit(flush_at_exit);
+
+	return ret;
+}
+
+void AsyncLogWriter::write(const char* level, const char* function, bool print_errno, const char* fmt, ...)
+{
+	// the errno maybe changed when format the line.
+	int error = errno;
+
+	// reserved 1bytes for the new line.
+	char line[RSS_LOG_LINE_SIZE];
+	int max_size = RSS_LOG_LINE_SIZE - 1;
+	int size = 0;
+
+	if (function)
+	{
+		size = snprintf(line, max_size, "[%s][%s][%s][%s] ",
+		                log_context->format_time(), log_context->format_context(), level, function);
+	}
+	else
+	{
+		size = snprintf(line, max_size, "[%s][%s][%s] ",
+		                log_context->format_time(), log_context->format_context(), level);
+	}
+	size = rss_min(rss_max(size, 0), max_size - 1);
+
+	va_list ap;
+	va_start(ap, fmt);
+	int nb_msg = vsnprintf(line + size, max_size - size, fmt, ap);
+	va_end(ap);
+	size = rss_min(size + rss_max(nb_msg, 0), max_size - 1);
+
+	if (print_errno)
+	{
+		int nb_errno = snprintf(line + size, max_size - size, " errno=%d(%s)", error, strerror(error));
+		size = rss_min(size + rss_max(nb_errno, 0), max_size - 1);
+	}
+
+	line[size++] = '\n';
+
+	enqueue(line, size);
+
+	errno = error;
+}
+
+void AsyncLogWriter::flush()
+{
+	if (!started)
+	{
+		return;
+	}
+
+	for (int i = 0; i < RSS_LOG_FLUSH_TIMEOUT_US / 1000; i++)
+	{
+		if (tail.load(std::memory_order_acquire) == head.load(std::memory_order_relaxed))
+		{
+			break;
+		}
+		usleep(1000);
+	}
+}
+
+int64_t AsyncLogWriter::get_dropped()
+{
+	return dropped.load(std::memory_order_relaxed);
+}
+
+void AsyncLogWriter::enqueue(const char* line, int size)
+{
+	// write to stdout directly when not started, for instance, the tools.
+	if (!started)
+	{
+		if (::write(STDOUT_FILENO, line, size) != size)
+		{
+			dropped.fetch_add(1, std::memory_order_relaxed);
+		}
+		return;
+	}
+
+	uint64_t h = head.load(std::memory_order_relaxed);
+	uint64_t t = tail.load(std::memory_order_acquire);
+
+	// drop the line when ring buffer is full, never block the server thread.
+	if (RSS_LOG_RING_SIZE - (h - t) < (uint64_t)size)
+	{
+		dropped.fetch_add(1, std::memory_order_relaxed);
+		return;
+	}
+
+	int offset = (int)(h & (RSS_LOG_RING_SIZE - 1));
+	int first = rss_min(size, RSS_LOG_RING_SIZE - offset);
+	memcpy(ring + offset, line, first);
+	memcpy(ring, line + first, size - first);
+
+	head.store(h + size, std::memory_order_release);
+}
+
+void* AsyncLogWriter::writer_thread(void* arg)
+{
+	AsyncLogWriter* writer = (AsyncLogWriter*)arg;
+	writer->cycle();
+	return NULL;
 }
 
+void AsyncLogWriter::cycle()
+{
+	while (true)
+	{
+		uint64_t t = tail.load(std::memory_order_relaxed);
+		uint64_t h = head.load(std::memory_order_acquire);
+
+		// write all lines in ring buffer in batch, at most two segments.
+		if (h != t)
+		{
+			int offset = (int)(t & (RSS_LOG_RING_SIZE - 1));
+			int size = (int)(h - t);
+			int first = rss_min(size, RSS_LOG_RING_SIZE - offset);
+
+			write_file(ring + offset, first);
+			write_file(ring, size - first);
+
+			tail.store(h, std::memory_order_release);
+		}
+
+		int64_t nb_dropped = dropped.load(std::memory_order_relaxed);
+		if (nb_dropped != reported_dropped)
+		{
+			char line[128];
+			int size = snprintf(line, sizeof(line), "[log] dropped %" PRId64 " lines, total %" PRId64 "\n",
+			                    nb_dropped - reported_dropped, nb_dropped);
+			write_file(line, size);
+			reported_dropped = nb_dropped;
+		}
+
+		rotate();
+
+		if (h == t)
+		{
+			usleep(RSS_LOG_WRITE_INTERVAL_US);
+		}
+	}
+}
+
+void AsyncLogWriter::write_file(const char* bytes, int size)
+{
+	while (size > 0)
+	{
+		ssize_t nwrite = ::write(fd, bytes, size);
+		if (nwrite <= 0)
+		{
+			if (nwrite == -1 && errno == EINTR)
+			{
+				continue;
+			}
+			// ignore the lines when write failed, for instance, disk full.
+			return;
+		}
+
+		bytes += nwrite;
+		size -= (int)nwrite;
+		file_size += nwrite;
+	}
+}
+
+void AsyncLogWriter::rotate()
+{
+	if (file.empty() || file_size < RSS_LOG_MAX_FILE_SIZE)
+	{
+		return;
+	}
+
+	std::string backup = file + ".1";
+	if (rename(file.c_str(), backup.c_str()) == -1)
+	{
+		return;
+	}
+
+	int new_fd = ::open(file.c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+	if (new_fd == -1)
+	{
+		return;
+	}
+
+	::close(fd);
+	fd = new_fd;
+	file_size = 0;
+}
+
+void AsyncLogWriter::flush_at_exit()
+{
+	log_writer->flush();
+}
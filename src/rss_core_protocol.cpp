@@ -1,3 +1,6 @@
+// the log subsystem of this file, see RssLogSubsystem.
+#define RSS_LOG_SUBSYSTEM RssLogSubsystemProtocol
+
 #include <rss_core_protocol.hpp>
 
 #include <rss_core_log.hpp>
@@ -7,6 +10,7 @@
 #include <rss_core_buffer.hpp>
 #include <rss_core_stream.hpp>
 #include <rss_core_auto_free.hpp>
+#include <rss_core_trace.hpp>
 
 /****************************************************************************
 *****************************************************************************
@@ -226,19 +230,107 @@ messages.
 /****************************************************************************
 *****************************************************************************
 ****************************************************************************/
+/**
+* the fmt0 chunk header size of protocol control message,
+* the cid is 2 and the timestamp is 0, so never use extended header.
+*/
+#define RTMP_CONTROL_HEADER_SIZE 12
+
+/**
+* the protocol control message with fixed size payload,
+* the chunk header is encoded at construct, user write the payload to stream.
+* the message is always in one chunk, and never allocate, use it on stack.
+*/
+template<int PayloadSize>
+class RssControlMessage
+{
+private:
+	char bytes[RTMP_CONTROL_HEADER_SIZE + PayloadSize];
+public:
+	// the stream to write payload, user must write PayloadSize bytes.
+	RssStreamBase<RssStreamNoCheckPolicy> stream;
+public:
+	RssControlMessage(int8_t message_type)
+	{
+		static_assert(PayloadSize <= RTMP_DEFAULT_CHUNK_SIZE, "control message must be one chunk");
+
+		stream.initialize(bytes, sizeof(bytes));
+
+		// basic header, fmt is 0
+		stream.write_1bytes(0x00 | RTMP_CID_ProtocolControl);
+		// timestamp, 3bytes, always 0
+		stream.write_1bytes(0x00);
+		stream.write_2bytes(0x00);
+		// message_length, 3bytes, big-endian
+		stream.write_1bytes(0x00);
+		stream.write_2bytes(PayloadSize);
+		// message_type, 1bytes
+		stream.write_1bytes(message_type);
+		// stream_id, 4bytes, little-endian, always 0
+		stream.write_4bytes(0x00);
+	}
+	char* data()
+	{
+		return bytes;
+	}
+	int size()
+	{
+		return sizeof(bytes);
+	}
+};
+
+/****************************************************************************
+*****************************************************************************
+****************************************************************************/
+
+RssOutChunkStream::RssOutChunkStream()
+{
+	sent = false;
+	fmt = RTMP_FMT_TYPE0;
+	message_type = 0;
+	payload_length = 0;
+	stream_id = 0;
+	timestamp = 0;
+	timestamp_delta = 0;
+}
 
 RssProtocol::RssProtocol(st_netfd_t client_stfd)
 {
 	stfd = client_stfd;
-	buffer = new RssBuffer();
 	skt = new RssSocket(stfd);
+	initialize();
+}
+
+RssProtocol::RssProtocol(RssSocket* io)
+{
+	stfd = NULL;
+	skt = io;
+	initialize();
+}
+
+void RssProtocol::initialize()
+{
+	buffer = new RssBuffer();
+	encode_buffer = new RssEncodeBuffer();
 
 	in_chunk_size = out_chunk_size = RTMP_DEFAULT_CHUNK_SIZE;
+	in_ack_window = 0;
+	in_acked_bytes = 0;
+	out_acked_bytes = -1;
+	batching = false;
+
+	memset(cs_cache, 0, sizeof(cs_cache));
+	nb_chunk_streams = 0;
 }
 
 RssProtocol::~RssProtocol()
 {
-	std::map<int, RssChunkStream*>::iterator it;
+	for (int i = 0; i < RTMP_CHUNK_STREAM_CACHE; i++)
+	{
+		rss_freep(cs_cache[i]);
+	}
+
+	std::unordered_map<int, RssChunkStream*>::iterator it;
 
 	for (it = chunk_streams.begin(); it != chunk_streams.end(); ++it)
 	{
@@ -250,6 +342,7 @@ RssProtocol::~RssProtocol()
 
 	rss_freep(buffer);
 	rss_freep(skt);
+	rss_freep(encode_buffer);
 }
 
 void RssProtocol::set_recv_timeout(int timeout_ms)
@@ -262,12 +355,38 @@ void RssProtocol::set_send_timeout(int timeout_ms)
 	return skt->set_send_timeout(timeout_ms);
 }
 
+int64_t RssProtocol::get_recv_bytes()
+{
+	return skt->get_recv_bytes();
+}
+
+int64_t RssProtocol::get_send_bytes()
+{
+	return skt->get_send_bytes();
+}
+
+int64_t RssProtocol::get_inflight_bytes()
+{
+	if (out_acked_bytes < 0)
+	{
+		return 0;
+	}
+
+	return skt->get_send_bytes() - out_acked_bytes;
+}
+
 int RssProtocol::recv_message(RssCommonMessage** pmsg)
 {
 	*pmsg = NULL;
 
 	int ret = ERROR_SUCCESS;
 
+	// the peer maybe wait for the queued response.
+	if ((ret = flush_batch()) != ERROR_SUCCESS)
+	{
+		return ret;
+	}
+
 	while (true)
 	{
 		RssCommonMessage* msg = NULL;
@@ -280,7 +399,13 @@ int RssProtocol::recv_message(RssCommonMessage** pmsg)
 			}
 			return ret;
 		}
-		rss_verbose("entire msg received");
+		rss_verbose_limit("entire msg received");
+
+		if ((ret = response_acknowledgement()) != ERROR_SUCCESS)
+		{
+			rss_freep(msg);
+			return ret;
+		}
 
 		if (!msg)
 		{
@@ -303,7 +428,7 @@ int RssProtocol::recv_message(RssCommonMessage** pmsg)
 			return ret;
 		}
 
-		rss_verbose("get a msg with raw/undecoded payload");
+		rss_verbose_limit("get a msg with raw/undecoded payload");
 		*pmsg = msg;
 		break;
 	}
@@ -318,12 +443,49 @@ int RssProtocol::send_message(IRssMessage* msg)
 	// free msg whatever return value.
 	RssAutoFree(IRssMessage, msg, false);
 
-	if ((ret = msg->encode_packet()) != ERROR_SUCCESS)
+	if ((ret = msg->encode_packet(encode_buffer)) != ERROR_SUCCESS)
 	{
 		rss_error("encode packet to message payload failed. ret=%d", ret);
 		return ret;
 	}
-	rss_info("encode packet to message payload success");
+	rss_info_limit("encode packet to message payload success");
+
+	// select the fmt of message header by the last message sentout over the cid.
+	int cid = msg->get_perfer_cid() & 0x3F;
+	RssOutChunkStream* cs = &out_chunk_streams[cid];
+
+	uint32_t timestamp = (uint32_t)msg->header.timestamp;
+	uint32_t timestamp_delta = timestamp - cs->timestamp;
+
+	char fmt = RTMP_FMT_TYPE0;
+	if (cs->sent && cs->stream_id == msg->header.stream_id && timestamp >= cs->timestamp)
+	{
+		if (cs->message_type != msg->header.message_type || cs->payload_length != msg->header.payload_length)
+		{
+			fmt = RTMP_FMT_TYPE1;
+		}
+		// the delta of fmt3 is the delta of last fmt1/fmt2 header.
+		else if (cs->fmt == RTMP_FMT_TYPE0 || cs->timestamp_delta != timestamp_delta)
+		{
+			fmt = RTMP_FMT_TYPE2;
+		}
+		else
+		{
+			fmt = RTMP_FMT_TYPE3;
+		}
+	}
+
+	// the timestamp field, absolute timestamp for fmt0, delta for others.
+	uint32_t timestamp_field = (fmt == RTMP_FMT_TYPE0)? timestamp : timestamp_delta;
+	bool extended = (timestamp_field >= RTMP_EXTENDED_TIMESTAMP);
+
+	cs->sent = true;
+	cs->fmt = fmt;
+	cs->message_type = msg->header.message_type;
+	cs->payload_length = msg->header.payload_length;
+	cs->stream_id = msg->header.stream_id;
+	cs->timestamp = timestamp;
+	cs->timestamp_delta = timestamp_field;
 
 	// p set to current write position,
 	// it's ok when payload is NULL and size is 0.
@@ -338,46 +500,54 @@ int RssProtocol::send_message(IRssMessage* msg)
 
 		if (p == (char*)msg->payload)
 		{
-			// write new chunk stream header, fmt is 0
+			// write new chunk stream header, the first chunk of message.
 			pheader = out_header_fmt0;
-			*pheader++ = 0x00 | (msg->get_perfer_cid() & 0x3F);
+			*pheader++ = (fmt << 6) | cid;
 
-			// chunk message header, 11 bytes
-			// timestamp, 3bytes, big-endian
-			if (msg->header.timestamp >= RTMP_EXTENDED_TIMESTAMP)
+			// timestamp or delta, 3bytes, big-endian
+			if (fmt <= RTMP_FMT_TYPE2)
 			{
-				*pheader++ = 0xFF;
-				*pheader++ = 0xFF;
-				*pheader++ = 0xFF;
+				if (extended)
+				{
+					*pheader++ = 0xFF;
+					*pheader++ = 0xFF;
+					*pheader++ = 0xFF;
+				}
+				else
+				{
+					pp = (char*)&timestamp_field;
+					*pheader++ = pp[2];
+					*pheader++ = pp[1];
+					*pheader++ = pp[0];
+				}
 			}
-			else
+
+			if (fmt <= RTMP_FMT_TYPE1)
 			{
-				pp = (char*)&msg->header.timestamp;
+				// message_length, 3bytes, big-endian
+				pp = (char*)&msg->header.payload_length;
 				*pheader++ = pp[2];
 				*pheader++ = pp[1];
 				*pheader++ = pp[0];
-			}
 
-			// message_length, 3bytes, big-endian
-			pp = (char*)&msg->header.payload_length;
-			*pheader++ = pp[2];
-			*pheader++ = pp[1];
-			*pheader++ = pp[0];
-
-			// message_type, 1bytes
-			*pheader++ = msg->header.message_type;
+				// message_type, 1bytes
+				*pheader++ = msg->header.message_type;
+			}
 
-			// message_length, 3bytes, little-endian
-			pp = (char*)&msg->header.stream_id;
-			*pheader++ = pp[0];
-			*pheader++ = pp[1];
-			*pheader++ = pp[2];
-			*pheader++ = pp[3];
+			if (fmt == RTMP_FMT_TYPE0)
+			{
+				// stream_id, 4bytes, little-endian
+				pp = (char*)&msg->header.stream_id;
+				*pheader++ = pp[0];
+				*pheader++ = pp[1];
+				*pheader++ = pp[2];
+				*pheader++ = pp[3];
+			}
 
 			// chunk extended timestamp header, 0 or 4 bytes, big-endian
-			if(msg->header.timestamp >= RTMP_EXTENDED_TIMESTAMP)
+			if (extended)
 			{
-				pp = (char*)&msg->header.timestamp;
+				pp = (char*)&timestamp_field;
 				*pheader++ = pp[3];
 				*pheader++ = pp[2];
 				*pheader++ = pp[1];
@@ -391,12 +561,13 @@ int RssProtocol::send_message(IRssMessage* msg)
 		{
 			// write no message header chunk stream, fmt is 3
 			pheader = out_header_fmt3;
-			*pheader++ = 0xC0 | (msg->get_perfer_cid() & 0x3F);
+			*pheader++ = 0xC0 | cid;
 
-			// chunk extended timestamp header, 0 or 4 bytes, big-endian
-			if(msg->header.timestamp >= RTMP_EXTENDED_TIMESTAMP)
+			// chunk extended timestamp header, 0 or 4 bytes, big-endian,
+			// same as the extended timestamp of the first chunk.
+			if (extended)
 			{
-				pp = (char*)&msg->header.timestamp;
+				pp = (char*)&timestamp_field;
 				*pheader++ = pp[3];
 				*pheader++ = pp[2];
 				*pheader++ = pp[1];
@@ -412,18 +583,27 @@ int RssProtocol::send_message(IRssMessage* msg)
 		int payload_size = msg->size - (p - (char*)msg->payload);
 		payload_size = rss_min(payload_size, out_chunk_size);
 
-		// send by writev
-		iovec iov[2];
-		iov[0].iov_base = pheader;
-		iov[0].iov_len = header_size;
-		iov[1].iov_base = p;
-		iov[1].iov_len = payload_size;
-
-		ssize_t nwrite;
-		if ((ret = skt->writev(iov, 2, &nwrite)) != ERROR_SUCCESS)
+		// queue to batch, sendout when flush.
+		if (batching)
 		{
-			rss_error("send with writev failed. ret=%d", ret);
-			return ret;
+			batch.insert(batch.end(), pheader, pheader + header_size);
+			batch.insert(batch.end(), p, p + payload_size);
+		}
+		else
+		{
+			// send by writev
+			iovec iov[2];
+			iov[0].iov_base = pheader;
+			iov[0].iov_len = header_size;
+			iov[1].iov_base = p;
+			iov[1].iov_len = payload_size;
+
+			ssize_t nwrite;
+			if ((ret = skt->writev(iov, 2, &nwrite)) != ERROR_SUCCESS)
+			{
+				rss_error("send with writev failed. ret=%d", ret);
+				return ret;
+			}
 		}
 
 		// consume sendout bytes when not empty packet.
@@ -434,6 +614,9 @@ int RssProtocol::send_message(IRssMessage* msg)
 	}
 	while (p < (char*)msg->payload + msg->size);
 
+	rss_trace_event(RssTraceEventWritten, msg->header.message_type, msg->header.stream_id,
+	                msg->header.timestamp, msg->size, 0);
+
 	if ((ret = on_send_message(msg)) != ERROR_SUCCESS)
 	{
 		rss_error("hook the send message failed. ret=%d", ret);
@@ -443,6 +626,173 @@ int RssProtocol::send_message(IRssMessage* msg)
 	return ret;
 }
 
+int RssProtocol::send_set_chunk_size(int32_t chunk_size)
+{
+	int ret = ERROR_SUCCESS;
+
+	RssControlMessage<4> msg(RTMP_MSG_SetChunkSize);
+	msg.stream.write_4bytes(chunk_size);
+
+	if ((ret = send_control(msg.data(), msg.size())) != ERROR_SUCCESS)
+	{
+		rss_error("send set chunk size failed. ret=%d", ret);
+		return ret;
+	}
+
+	out_chunk_size = chunk_size;
+	rss_trace("set output chunk size to %d", chunk_size);
+
+	return ret;
+}
+
+int RssProtocol::send_window_ack_size(int32_t ack_size)
+{
+	int ret = ERROR_SUCCESS;
+
+	RssControlMessage<4> msg(RTMP_MSG_WindowAcknowledgementSize);
+	msg.stream.write_4bytes(ack_size);
+
+	if ((ret = send_control(msg.data(), msg.size())) != ERROR_SUCCESS)
+	{
+		rss_error("send ack size failed. ret=%d", ret);
+		return ret;
+	}
+
+	return ret;
+}
+
+int RssProtocol::send_peer_bandwidth(int32_t bandwidth, int8_t type)
+{
+	int ret = ERROR_SUCCESS;
+
+	RssControlMessage<5> msg(RTMP_MSG_SetPeerBandwidth);
+	msg.stream.write_4bytes(bandwidth);
+	msg.stream.write_1bytes(type);
+
+	if ((ret = send_control(msg.data(), msg.size())) != ERROR_SUCCESS)
+	{
+		rss_error("send set bandwidth failed. ret=%d", ret);
+		return ret;
+	}
+
+	return ret;
+}
+
+int RssProtocol::send_acknowledgement(int32_t sequence_number)
+{
+	int ret = ERROR_SUCCESS;
+
+	RssControlMessage<4> msg(RTMP_MSG_Acknowledgement);
+	msg.stream.write_4bytes(sequence_number);
+
+	if ((ret = send_control(msg.data(), msg.size())) != ERROR_SUCCESS)
+	{
+		rss_error("send acknowledgement failed. ret=%d", ret);
+		return ret;
+	}
+
+	return ret;
+}
+
+int RssProtocol::send_user_control(int16_t event_type, int32_t event_data)
+{
+	int ret = ERROR_SUCCESS;
+
+	RssControlMessage<6> msg(RTMP_MSG_UserControlMessage);
+	msg.stream.write_2bytes(event_type);
+	msg.stream.write_4bytes(event_data);
+
+	if ((ret = send_control(msg.data(), msg.size())) != ERROR_SUCCESS)
+	{
+		rss_error("send PCUC(%d) failed. ret=%d", event_type, ret);
+		return ret;
+	}
+
+	return ret;
+}
+
+void RssProtocol::start_batch()
+{
+	batching = true;
+}
+
+int RssProtocol::flush_batch()
+{
+	int ret = ERROR_SUCCESS;
+
+	batching = false;
+
+	if (batch.empty())
+	{
+		return ret;
+	}
+
+	ssize_t nwrite;
+	if ((ret = skt->write(&batch.at(0), batch.size(), &nwrite)) != ERROR_SUCCESS)
+	{
+		rss_error("send batch failed. size=%d, ret=%d", (int)batch.size(), ret);
+		batch.clear();
+		return ret;
+	}
+	rss_info_limit("send batch success. size=%d", (int)batch.size());
+
+	batch.clear();
+
+	return ret;
+}
+
+int RssProtocol::send_control(char* bytes, int size)
+{
+	int ret = ERROR_SUCCESS;
+
+	// the control message is sentout over cid 2 with fmt0 header,
+	// the next message over it must use fmt0 header.
+	out_chunk_streams[RTMP_CID_ProtocolControl].sent = false;
+
+	// queue to batch, sendout when flush.
+	if (batching)
+	{
+		batch.insert(batch.end(), bytes, bytes + size);
+		return ret;
+	}
+
+	ssize_t nwrite;
+	if ((ret = skt->write(bytes, size, &nwrite)) != ERROR_SUCCESS)
+	{
+		rss_error("send control message failed. ret=%d", ret);
+		return ret;
+	}
+
+	return ret;
+}
+
+int RssProtocol::response_acknowledgement()
+{
+	int ret = ERROR_SUCCESS;
+
+	if (in_ack_window <= 0)
+	{
+		return ret;
+	}
+
+	int64_t recv_bytes = skt->get_recv_bytes();
+	if (recv_bytes - in_acked_bytes < in_ack_window)
+	{
+		return ret;
+	}
+
+	// the sequence number is the bytes received so far, wrap at 32bits.
+	if ((ret = send_acknowledgement((int32_t)recv_bytes)) != ERROR_SUCCESS)
+	{
+		rss_error("response acknowledgement failed. ret=%d", ret);
+		return ret;
+	}
+	in_acked_bytes = recv_bytes;
+	rss_verbose_limit("response acknowledgement success. sequence=%" PRId64, recv_bytes);
+
+	return ret;
+}
+
 int RssProtocol::on_recv_message(RssCommonMessage* msg)
 {
 	int ret = ERROR_SUCCESS;
@@ -458,7 +808,7 @@ int RssProtocol::on_recv_message(RssCommonMessage* msg)
 			rss_error("decode packet from message payload failed. ret=%d", ret);
 			return ret;
 		}
-		rss_verbose("decode packet from message payload success.");
+		rss_verbose_limit("decode packet from message payload success.");
 		break;
 	}
 
@@ -468,10 +818,31 @@ int RssProtocol::on_recv_message(RssCommonMessage* msg)
 	{
 		RssSetWindowAckSizePacket* pkt = dynamic_cast<RssSetWindowAckSizePacket*>(msg->get_packet());
 		rss_assert(pkt != NULL);
-		// TODO: take effect.
+
+		in_ack_window = pkt->ackowledgement_window_size;
+
 		rss_trace("set ack window size to %d", pkt->ackowledgement_window_size);
 		break;
 	}
+	case RTMP_MSG_Acknowledgement:
+	{
+		// the peer ack the bytes received so far, never decode the packet.
+		RssStream stream;
+		if (msg->size < 4 || stream.initialize((char*)msg->payload, msg->size) != ERROR_SUCCESS)
+		{
+			break;
+		}
+
+		// the sequence number wrap at 32bits, restore it by the bytes sent,
+		// the peer may count the handshake bytes, which is sent over other socket.
+		uint32_t sequence_number = (uint32_t)stream.read_4bytes();
+		int64_t send_bytes = skt->get_send_bytes();
+		int32_t unacked = (int32_t)((uint32_t)send_bytes - sequence_number);
+		out_acked_bytes = send_bytes - rss_max(unacked, 0);
+
+		rss_verbose_limit("peer acked %" PRId64 " bytes, inflight=%" PRId64, out_acked_bytes, send_bytes - out_acked_bytes);
+		break;
+	}
 	case RTMP_MSG_SetChunkSize:
 	{
 		RssSetChunkSizePacket* pkt = dynamic_cast<RssSetChunkSizePacket*>(msg->get_packet());
@@ -482,6 +853,30 @@ int RssProtocol::on_recv_message(RssCommonMessage* msg)
 		rss_trace("set input chunk size to %d", pkt->chunk_size);
 		break;
 	}
+	case RTMP_MSG_UserControlMessage:
+	{
+		// response the ping request, never decode the packet.
+		RssStream stream;
+		if (msg->size < 6 || stream.initialize((char*)msg->payload, msg->size) != ERROR_SUCCESS)
+		{
+			break;
+		}
+
+		int16_t event_type = stream.read_2bytes();
+		int32_t event_data = stream.read_4bytes();
+		if (event_type != SrcPCUCPingRequest)
+		{
+			break;
+		}
+
+		if ((ret = send_user_control(SrcPCUCPingResponse, event_data)) != ERROR_SUCCESS)
+		{
+			rss_error("response ping request failed. ret=%d", ret);
+			return ret;
+		}
+		rss_verbose_limit("response ping request success. timestamp=%d", event_data);
+		break;
+	}
 	}
 
 	return ret;
@@ -493,14 +888,14 @@ int RssProtocol::on_send_message(IRssMessage* msg)
 
 	if (!msg->can_decode())
 	{
-		rss_verbose("ignore the un-decodable message.");
+		rss_verbose_limit("ignore the un-decodable message.");
 		return ret;
 	}
 
 	RssCommonMessage* common_msg = dynamic_cast<RssCommonMessage*>(msg);
 	if (!msg)
 	{
-		rss_verbose("ignore the shared ptr message.");
+		rss_verbose_limit("ignore the shared ptr message.");
 		return ret;
 	}
 
@@ -539,20 +934,48 @@ int RssProtocol::recv_interlaced_message(RssCommonMessage** pmsg)
 		}
 		return ret;
 	}
-	rss_info("read basic header success. fmt=%d, cid=%d, bh_size=%d", fmt, cid, bh_size);
+	rss_info_limit("read basic header success. fmt=%d, cid=%d, bh_size=%d", fmt, cid, bh_size);
 
 	// get the cached chunk stream.
 	RssChunkStream* chunk = NULL;
 
-	if (chunk_streams.find(cid) == chunk_streams.end())
+	if (cid < RTMP_CHUNK_STREAM_CACHE)
 	{
-		chunk = chunk_streams[cid] = new RssChunkStream(cid);
-		rss_info("cache new chunk stream: fmt=%d, cid=%d", fmt, cid);
+		chunk = cs_cache[cid];
 	}
 	else
 	{
-		chunk = chunk_streams[cid];
-		rss_info("cached chunk stream: fmt=%d, cid=%d, size=%d, message(type=%d, size=%d, time=%d, sid=%d)",
+		std::unordered_map<int, RssChunkStream*>::iterator it = chunk_streams.find(cid);
+		if (it != chunk_streams.end())
+		{
+			chunk = it->second;
+		}
+	}
+
+	if (!chunk)
+	{
+		if (nb_chunk_streams >= RTMP_MAX_CHUNK_STREAMS)
+		{
+			ret = ERROR_RTMP_CHUNK_STREAMS;
+			rss_error("too many chunk streams, cid=%d, max=%d. ret=%d", cid, RTMP_MAX_CHUNK_STREAMS, ret);
+			return ret;
+		}
+
+		chunk = new RssChunkStream(cid);
+		if (cid < RTMP_CHUNK_STREAM_CACHE)
+		{
+			cs_cache[cid] = chunk;
+		}
+		else
+		{
+			chunk_streams[cid] = chunk;
+		}
+		nb_chunk_streams++;
+		rss_info_limit("cache new chunk stream: fmt=%d, cid=%d", fmt, cid);
+	}
+	else
+	{
+		rss_info_limit("cached chunk stream: fmt=%d, cid=%d, size=%d, message(type=%d, size=%d, time=%d, sid=%d)",
 		         chunk->fmt, chunk->cid, (chunk->msg? chunk->msg->size : 0), chunk->header.message_type, chunk->header.payload_length,
 		         chunk->header.timestamp, chunk->header.stream_id);
 	}
@@ -567,7 +990,7 @@ int RssProtocol::recv_interlaced_message(RssCommonMessage** pmsg)
 		}
 		return ret;
 	}
-	rss_info("read message header success. "
+	rss_info_limit("read message header success. "
 	         "fmt=%d, mh_size=%d, ext_time=%d, size=%d, message(type=%d, size=%d, time=%d, sid=%d)",
 	         fmt, mh_size, chunk->extended_timestamp, (chunk->msg? chunk->msg->size : 0), chunk->header.message_type,
 	         chunk->header.payload_length, chunk->header.timestamp, chunk->header.stream_id);
@@ -584,17 +1007,22 @@ int RssProtocol::recv_interlaced_message(RssCommonMessage** pmsg)
 		return ret;
 	}
 
+	rss_trace_event(RssTraceEventChunkReceived, chunk->header.message_type, chunk->header.stream_id,
+	                chunk->header.timestamp, payload_size, 0);
+
 	// not got an entire RTMP message, try next chunk.
 	if (!msg)
 	{
-		rss_info("get partial message success. chunk_payload_size=%d, size=%d, message(type=%d, size=%d, time=%d, sid=%d)",
+		rss_info_limit("get partial message success. chunk_payload_size=%d, size=%d, message(type=%d, size=%d, time=%d, sid=%d)",
 		         payload_size, (msg? msg->size : (chunk->msg? chunk->msg->size : 0)), chunk->header.message_type, chunk->header.payload_length,
 		         chunk->header.timestamp, chunk->header.stream_id);
 		return ret;
 	}
 
 	*pmsg = msg;
-	rss_info("get entire message success. chunk_payload_size=%d, size=%d, message(type=%d, size=%d, time=%d, sid=%d)",
+	rss_trace_event(RssTraceEventMessageComplete, msg->header.message_type, msg->header.stream_id,
+	                msg->header.timestamp, msg->size, 0);
+	rss_info_limit("get entire message success. chunk_payload_size=%d, size=%d, message(type=%d, size=%d, time=%d, sid=%d)",
 	         payload_size, (msg? msg->size : (chunk->msg? chunk->msg->size : 0)), chunk->header.message_type, chunk->header.payload_length,
 	         chunk->header.timestamp, chunk->header.stream_id);
 
@@ -623,7 +1051,7 @@ int RssProtocol::read_basic_header(char& fmt, int& cid, int& bh_size)
 
 	if (cid > 1)
 	{
-		rss_verbose("%dbytes basic header parsed. fmt=%d, cid=%d", bh_size, fmt, cid);
+		rss_verbose_limit("%dbytes basic header parsed. fmt=%d, cid=%d", bh_size, fmt, cid);
 		return ret;
 	}
 
@@ -642,7 +1070,7 @@ int RssProtocol::read_basic_header(char& fmt, int& cid, int& bh_size)
 		cid = 64;
 		cid += *(++p);
 		bh_size = 2;
-		rss_verbose("%dbytes basic header parsed. fmt=%d, cid=%d", bh_size, fmt, cid);
+		rss_verbose_limit("%dbytes basic header parsed. fmt=%d, cid=%d", bh_size, fmt, cid);
 	}
 	else if (cid == 1)
 	{
@@ -660,7 +1088,7 @@ int RssProtocol::read_basic_header(char& fmt, int& cid, int& bh_size)
 		cid += *(++p);
 		cid += *(++p) * 256;
 		bh_size = 3;
-		rss_verbose("%dbytes basic header parsed. fmt=%d, cid=%d", bh_size, fmt, cid);
+		rss_verbose_limit("%dbytes basic header parsed. fmt=%d, cid=%d", bh_size, fmt, cid);
 	}
 	else
 	{
@@ -723,13 +1151,13 @@ int RssProtocol::read_message_header(RssChunkStream* chunk, char fmt, int bh_siz
 	if (!chunk->msg)
 	{
 		chunk->msg = new RssCommonMessage();
-		rss_verbose("create message for new chunk, fmt=%d, cid=%d", fmt, chunk->cid);
+		rss_verbose_limit("create message for new chunk, fmt=%d, cid=%d", fmt, chunk->cid);
 	}
 
 	// read message header from socket to buffer.
 	static char mh_sizes[] = {11, 7, 3, 0};
 	mh_size = mh_sizes[(int)fmt];
-	rss_verbose("calc chunk message header size. fmt=%d, mh_size=%d", fmt, mh_size);
+	rss_verbose_limit("calc chunk message header size. fmt=%d, mh_size=%d", fmt, mh_size);
 
 	int required_size = bh_size + mh_size;
 	if ((ret = buffer->ensure_buffer_bytes(skt, required_size)) != ERROR_SUCCESS)
@@ -804,20 +1232,20 @@ int RssProtocol::read_message_header(RssChunkStream* chunk, char fmt, int bh_siz
 				pp[1] = *p++;
 				pp[2] = *p++;
 				pp[3] = *p++;
-				rss_verbose("header read completed. fmt=%d, mh_size=%d, ext_time=%d, time=%d, payload=%d, type=%d, sid=%d",
+				rss_verbose_limit("header read completed. fmt=%d, mh_size=%d, ext_time=%d, time=%d, payload=%d, type=%d, sid=%d",
 				            fmt, mh_size, chunk->extended_timestamp, chunk->header.timestamp, chunk->header.payload_length,
 				            chunk->header.message_type, chunk->header.stream_id);
 			}
 			else
 			{
-				rss_verbose("header read completed. fmt=%d, mh_size=%d, ext_time=%d, time=%d, payload=%d, type=%d",
+				rss_verbose_limit("header read completed. fmt=%d, mh_size=%d, ext_time=%d, time=%d, payload=%d, type=%d",
 				            fmt, mh_size, chunk->extended_timestamp, chunk->header.timestamp, chunk->header.payload_length,
 				            chunk->header.message_type);
 			}
 		}
 		else
 		{
-			rss_verbose("header read completed. fmt=%d, mh_size=%d, ext_time=%d, time=%d",
+			rss_verbose_limit("header read completed. fmt=%d, mh_size=%d, ext_time=%d, time=%d",
 			            fmt, mh_size, chunk->extended_timestamp, chunk->header.timestamp);
 		}
 	}
@@ -828,7 +1256,7 @@ int RssProtocol::read_message_header(RssChunkStream* chunk, char fmt, int bh_siz
 		{
 			chunk->header.timestamp += chunk->header.timestamp_delta;
 		}
-		rss_verbose("header read completed. fmt=%d, size=%d, ext_time=%d",
+		rss_verbose_limit("header read completed. fmt=%d, size=%d, ext_time=%d",
 		            fmt, mh_size, chunk->extended_timestamp);
 	}
 
@@ -836,7 +1264,7 @@ int RssProtocol::read_message_header(RssChunkStream* chunk, char fmt, int bh_siz
 	{
 		mh_size += 4;
 		required_size = bh_size + mh_size;
-		rss_verbose("read header ext time. fmt=%d, ext_time=%d, mh_size=%d", fmt, chunk->extended_timestamp, mh_size);
+		rss_verbose_limit("read header ext time. fmt=%d, ext_time=%d, mh_size=%d", fmt, chunk->extended_timestamp, mh_size);
 		if ((ret = buffer->ensure_buffer_bytes(skt, required_size)) != ERROR_SUCCESS)
 		{
 			if (ret != ERROR_SOCKET_TIMEOUT)
@@ -851,7 +1279,7 @@ int RssProtocol::read_message_header(RssChunkStream* chunk, char fmt, int bh_siz
 		pp[2] = *p++;
 		pp[1] = *p++;
 		pp[0] = *p++;
-		rss_verbose("header read ext_time completed. time=%d", chunk->header.timestamp);
+		rss_verbose_limit("header read ext_time completed. time=%d", chunk->header.timestamp);
 	}
 
 	// valid message
@@ -896,7 +1324,7 @@ int RssProtocol::read_message_payload(RssChunkStream* chunk, int bh_size, int mh
 	// the chunk payload size.
 	payload_size = chunk->header.payload_length - chunk->msg->size;
 	payload_size = rss_min(payload_size, in_chunk_size);
-	rss_verbose("chunk payload size is %d, message_size=%d, received_size=%d, in_chunk_size=%d",
+	rss_verbose_limit("chunk payload size is %d, message_size=%d, received_size=%d, in_chunk_size=%d",
 	            payload_size, chunk->header.payload_length, chunk->msg->size, in_chunk_size);
 
 	// create msg payload if not initialized
@@ -904,7 +1332,7 @@ int RssProtocol::read_message_payload(RssChunkStream* chunk, int bh_size, int mh
 	{
 		chunk->msg->payload = new int8_t[chunk->header.payload_length];
 		memset(chunk->msg->payload, 0, chunk->header.payload_length);
-		rss_verbose("create empty payload for RTMP message. size=%d", chunk->header.payload_length);
+		rss_verbose_limit("create empty payload for RTMP message. size=%d", chunk->header.payload_length);
 	}
 
 	// read payload to buffer
@@ -921,20 +1349,20 @@ int RssProtocol::read_message_payload(RssChunkStream* chunk, int bh_size, int mh
 	buffer->erase(bh_size + mh_size + payload_size);
 	chunk->msg->size += payload_size;
 
-	rss_verbose("chunk payload read completed. bh_size=%d, mh_size=%d, payload_size=%d", bh_size, mh_size, payload_size);
+	rss_verbose_limit("chunk payload read completed. bh_size=%d, mh_size=%d, payload_size=%d", bh_size, mh_size, payload_size);
 
 	// got entire RTMP message?
 	if (chunk->header.payload_length == chunk->msg->size)
 	{
 		*pmsg = chunk->msg;
 		chunk->msg = NULL;
-		rss_verbose("get entire RTMP message(type=%d, size=%d, time=%d, sid=%d)",
+		rss_verbose_limit("get entire RTMP message(type=%d, size=%d, time=%d, sid=%d)",
 		            chunk->header.message_type, chunk->header.payload_length,
 		            chunk->header.timestamp, chunk->header.stream_id);
 		return ret;
 	}
 
-	rss_verbose("get partial RTMP message(type=%d, size=%d, time=%d, sid=%d), partial size=%d",
+	rss_verbose_limit("get partial RTMP message(type=%d, size=%d, time=%d, sid=%d), partial size=%d",
 	            chunk->header.message_type, chunk->header.payload_length,
 	            chunk->header.timestamp, chunk->header.stream_id,
 	            chunk->msg->size);
@@ -966,6 +1394,11 @@ bool RssMessageHeader::is_video()
 	return message_type == RTMP_MSG_VideoMessage;
 }
 
+bool RssMessageHeader::is_aggregate()
+{
+	return message_type == RTMP_MSG_AggregateMessage;
+}
+
 bool RssMessageHeader::is_amf0_command()
 {
 	return message_type == RTMP_MSG_AMF0CommandMessage;
@@ -996,18 +1429,45 @@ bool RssMessageHeader::is_set_chunk_size()
 	return message_type == RTMP_MSG_SetChunkSize;
 }
 
-RssChunkStream::RssChunkStream(int _cid)
+void RssMessageHeader::initialize_amf0_script(int32_t size, int32_t _stream_id)
 {
-	fmt = 0;
-	cid = _cid;
-	extended_timestamp = false;
-	msg = NULL;
-	msg_count = 0;
+	message_type = RTMP_MSG_AMF0DataMessage;
+	payload_length = size;
+	timestamp_delta = 0;
+	timestamp = 0;
+	stream_id = _stream_id;
 }
 
-RssChunkStream::~RssChunkStream()
+void RssMessageHeader::initialize_audio(int32_t size, int32_t _timestamp, int32_t _stream_id)
 {
-	rss_freep(msg);
+	message_type = RTMP_MSG_AudioMessage;
+	payload_length = size;
+	timestamp_delta = _timestamp;
+	timestamp = _timestamp;
+	stream_id = _stream_id;
+}
+
+void RssMessageHeader::initialize_video(int32_t size, int32_t _timestamp, int32_t _stream_id)
+{
+	message_type = RTMP_MSG_VideoMessage;
+	payload_length = size;
+	timestamp_delta = _timestamp;
+	timestamp = _timestamp;
+	stream_id = _stream_id;
+}
+
+RssChunkStream::RssChunkStream(int _cid)
+{
+	fmt = 0;
+	cid = _cid;
+	extended_timestamp = false;
+	msg = NULL;
+	msg_count = 0;
+}
+
+RssChunkStream::~RssChunkStream()
+{
+	rss_freep(msg);
 }
 
 IRssMessage::IRssMessage()
@@ -1020,10 +1480,39 @@ IRssMessage::~IRssMessage()
 {
 }
 
+RssCommandId rss_rtmp_intern_command(const char* name, int size)
+{
+	// the known commands, index by RssCommandId.
+	static const char* names[RssCommandMax] = {
+		NULL,
+		RTMP_AMF0_COMMAND_CONNECT,
+		RTMP_AMF0_COMMAND_CREATE_STREAM,
+		RTMP_AMF0_COMMAND_PLAY,
+		RTMP_AMF0_COMMAND_RELEASE_STREAM,
+		RTMP_AMF0_COMMAND_FC_PUBLISH,
+		RTMP_AMF0_COMMAND_UNPUBLISH,
+		RTMP_AMF0_COMMAND_PUBLISH,
+		RTMP_AMF0_DATA_SET_DATAFRAME,
+		RTMP_AMF0_DATA_ON_METADATA,
+	};
+
+	for (int i = RssCommandUnknown + 1; i < RssCommandMax; i++)
+	{
+		if ((int)strlen(names[i]) == size && memcmp(names[i], name, size) == 0)
+		{
+			return (RssCommandId)i;
+		}
+	}
+
+	return RssCommandUnknown;
+}
+
 RssCommonMessage::RssCommonMessage()
 {
 	stream = NULL;
 	packet = NULL;
+	arena = NULL;
+	command = -1;
 }
 
 RssCommonMessage::~RssCommonMessage()
@@ -1032,8 +1521,11 @@ RssCommonMessage::~RssCommonMessage()
 	// nevery use the virtual functions to delete,
 	// for in the destructor, the virtual functions is disabled.
 
-	rss_freepa(payload);
+	// the packet must be freed before arena, which owns the amf0 values,
+	// and the payload must be freed after the packet, which views it.
 	rss_freep(packet);
+	rss_freep(arena);
+	rss_freepa(payload);
 	rss_freep(stream);
 }
 
@@ -1075,82 +1567,92 @@ int RssCommonMessage::decode_packet()
 	{
 		rss_verbose("start to decode AMF0/AMF3 command message.");
 
-		// skip 1bytes to decode the amf3 command.
-		if (header.is_amf3_command() && stream->require(1))
-		{
-			rss_verbose("skip 1bytes to decode AMF3 command");
-			stream->skip(1);
-		}
-
 		// amf0 command message.
 		// need to read the command name.
-		std::string command;
-		if ((ret = rss_amf0_read_string(stream, command)) != ERROR_SUCCESS)
+		RssCommandId command_id = RssCommandUnknown;
+		if ((ret = peek_command(command_id)) != ERROR_SUCCESS)
 		{
 			rss_error("decode AMF0/AMF3 command name failed. ret=%d", ret);
 			return ret;
 		}
-		rss_verbose("AMF0/AMF3 command message, command_name=%s", command.c_str());
+		rss_verbose("AMF0/AMF3 command message, command_id=%d", command_id);
+
+		// all amf0 values of packet are allocated from the arena of message.
+		if (!arena)
+		{
+			arena = new RssAmf0Arena();
+		}
+		RssAmf0ArenaScope scope(arena);
+		// the amf0 strings view the payload, which is alive util message freed.
+		RssAmf0ViewScope view_scope;
 
-		// reset to zero(amf3 to 1) to restart decode.
-		stream->reset();
-		if (header.is_amf3_command())
+		// skip 1bytes to decode the amf3 command.
+		if (header.is_amf3_command() && stream->require(1))
 		{
+			rss_verbose("skip 1bytes to decode AMF3 command");
 			stream->skip(1);
 		}
 
 		// decode command object.
-		if (command == RTMP_AMF0_COMMAND_CONNECT)
+		switch (command_id)
+		{
+		case RssCommandConnect:
 		{
 			rss_info("decode the AMF0/AMF3 command(connect vhost/app message).");
 			packet = new RssConnectAppPacket();
 			return packet->decode(stream);
 		}
-		else if(command == RTMP_AMF0_COMMAND_CREATE_STREAM)
+		case RssCommandCreateStream:
 		{
 			rss_info("decode the AMF0/AMF3 command(createStream message).");
 			packet = new RssCreateStreamPacket();
 			return packet->decode(stream);
 		}
-		else if(command == RTMP_AMF0_COMMAND_PLAY)
+		case RssCommandPlay:
 		{
 			rss_info("decode the AMF0/AMF3 command(paly message).");
 			packet = new RssPlayPacket();
 			return packet->decode(stream);
 		}
-		else if(command == RTMP_AMF0_COMMAND_RELEASE_STREAM)
+		case RssCommandReleaseStream:
 		{
 			rss_info("decode the AMF0/AMF3 command(FMLE releaseStream message).");
 			packet = new RssFMLEStartPacket();
 			return packet->decode(stream);
 		}
-		else if(command == RTMP_AMF0_COMMAND_FC_PUBLISH)
+		case RssCommandFCPublish:
 		{
 			rss_info("decode the AMF0/AMF3 command(FMLE FCPublish message).");
 			packet = new RssFMLEStartPacket();
 			return packet->decode(stream);
 		}
-		else if(command == RTMP_AMF0_COMMAND_PUBLISH)
+		case RssCommandPublish:
 		{
 			rss_info("decode the AMF0/AMF3 command(publish message).");
 			packet = new RssPublishPacket();
 			return packet->decode(stream);
 		}
-		else if(command == RTMP_AMF0_COMMAND_UNPUBLISH)
+		case RssCommandFCUnpublish:
 		{
 			rss_info("decode the AMF0/AMF3 command(unpublish message).");
 			packet = new RssFMLEStartPacket();
 			return packet->decode(stream);
 		}
-		else if(command == RTMP_AMF0_DATA_SET_DATAFRAME || command == RTMP_AMF0_DATA_ON_METADATA)
+		case RssCommandSetDataFrame:
+		case RssCommandOnMetaData:
 		{
 			rss_info("decode the AMF0/AMF3 data(onMetaData message).");
 			packet = new RssOnMetaDataPacket();
 			return packet->decode(stream);
 		}
+		default:
+		{
+			break;
+		}
+		}
 
 		// default packet to drop message.
-		rss_trace("drop the AMF0/AMF3 command message, command_name=%s", command.c_str());
+		rss_trace("drop the AMF0/AMF3 command message, command_id=%d", command_id);
 		packet = new RssPacket();
 		return ret;
 	}
@@ -1176,6 +1678,57 @@ int RssCommonMessage::decode_packet()
 	return ret;
 }
 
+int RssCommonMessage::peek_command(RssCommandId& command_id)
+{
+	int ret = ERROR_SUCCESS;
+
+	if (command >= 0)
+	{
+		command_id = (RssCommandId)command;
+		return ret;
+	}
+
+	if (!header.is_amf0_command() && !header.is_amf3_command() && !header.is_amf0_data() && !header.is_amf3_data())
+	{
+		ret = ERROR_RTMP_MESSAGE_DECODE;
+		rss_error("only AMF0/AMF3 command or data message can be peeked, type=%d. ret=%d", header.message_type, ret);
+		return ret;
+	}
+
+	if (!stream)
+	{
+		stream = new RssStream();
+	}
+
+	if ((ret = stream->initialize((char*)payload, size)) != ERROR_SUCCESS)
+	{
+		rss_error("initialize stream failed. ret=%d", ret);
+		return ret;
+	}
+
+	// skip 1bytes to decode the amf3 command.
+	if (header.is_amf3_command() && stream->require(1))
+	{
+		stream->skip(1);
+	}
+
+	char* name = NULL;
+	int name_size = 0;
+	if ((ret = rss_amf0_peek_string(stream, name, name_size)) != ERROR_SUCCESS)
+	{
+		rss_error("peek AMF0/AMF3 command name failed. ret=%d", ret);
+		return ret;
+	}
+
+	command = command_id = rss_rtmp_intern_command(name, name_size);
+	rss_verbose("peek AMF0/AMF3 command success. command_id=%d", command_id);
+
+	// reset to zero to restart decode.
+	stream->reset();
+
+	return ret;
+}
+
 RssPacket* RssCommonMessage::get_packet()
 {
 	if (!packet)
@@ -1211,11 +1764,11 @@ void RssCommonMessage::set_packet(RssPacket* pkt, int stream_id)
 	packet = pkt;
 
 	header.message_type = packet->get_message_type();
-	header.payload_length = packet->get_payload_length();
+	header.payload_length = 0;
 	header.stream_id = stream_id;
 }
 
-int RssCommonMessage::encode_packet()
+int RssCommonMessage::encode_packet(RssEncodeBuffer* buffer)
 {
 	int ret = ERROR_SUCCESS;
 
@@ -1228,7 +1781,13 @@ int RssCommonMessage::encode_packet()
 	size = 0;
 	rss_freepa(payload);
 
-	return packet->encode(size, (char*&)payload);
+	if ((ret = packet->encode(buffer, size, (char*&)payload)) != ERROR_SUCCESS)
+	{
+		return ret;
+	}
+	header.payload_length = size;
+
+	return ret;
 }
 
 RssSharedPtrMessage::RssSharedPtr::RssSharedPtr()
@@ -1247,6 +1806,7 @@ RssSharedPtrMessage::RssSharedPtr::~RssSharedPtr()
 RssSharedPtrMessage::RssSharedPtrMessage()
 {
 	ptr = NULL;
+	arrival_us = 0;
 }
 
 RssSharedPtrMessage::~RssSharedPtrMessage()
@@ -1321,6 +1881,7 @@ RssSharedPtrMessage* RssSharedPtrMessage::copy()
 	RssSharedPtrMessage* copy = new RssSharedPtrMessage();
 
 	copy->header = header;
+	copy->arrival_us = arrival_us;
 
 	copy->ptr = ptr;
 	ptr->shared_count++;
@@ -1331,6 +1892,16 @@ RssSharedPtrMessage* RssSharedPtrMessage::copy()
 	return copy;
 }
 
+void RssSharedPtrMessage::set_arrival(int64_t us)
+{
+	arrival_us = us;
+}
+
+int64_t RssSharedPtrMessage::get_arrival()
+{
+	return arrival_us;
+}
+
 int RssSharedPtrMessage::get_perfer_cid()
 {
 	if (!ptr)
@@ -1341,7 +1912,7 @@ int RssSharedPtrMessage::get_perfer_cid()
 	return ptr->perfer_cid;
 }
 
-int RssSharedPtrMessage::encode_packet()
+int RssSharedPtrMessage::encode_packet(RssEncodeBuffer* /*buffer*/)
 {
 	rss_verbose("shared message ignore the encode method.");
 	return ERROR_SUCCESS;
@@ -1378,39 +1949,37 @@ int RssPacket::get_message_type()
 	return 0;
 }
 
-int RssPacket::get_payload_length()
-{
-	return get_size();
-}
-
-int RssPacket::encode(int& psize, char*& ppayload)
+int RssPacket::encode(RssEncodeBuffer* buffer, int& psize, char*& ppayload)
 {
 	int ret = ERROR_SUCCESS;
 
-	int size = get_size();
-	char* payload = NULL;
-
-	RssStream stream;
-
-	if (size > 0)
+	RssEncodeBuffer temp;
+	if (!buffer)
 	{
-		payload = new char[size];
+		buffer = &temp;
+	}
 
-		if ((ret = stream.initialize(payload, size)) != ERROR_SUCCESS)
-		{
-			rss_error("initialize the stream failed. ret=%d", ret);
-			rss_freepa(payload);
-			return ret;
-		}
+	if ((ret = buffer->rewind()) != ERROR_SUCCESS)
+	{
+		rss_error("initialize the encode buffer failed. ret=%d", ret);
+		return ret;
 	}
 
-	if ((ret = encode_packet(&stream)) != ERROR_SUCCESS)
+	if ((ret = encode_packet(buffer)) != ERROR_SUCCESS)
 	{
 		rss_error("encode the packet failed. ret=%d", ret);
-		rss_freepa(payload);
 		return ret;
 	}
 
+	int size = buffer->length();
+	char* payload = NULL;
+
+	if (size > 0)
+	{
+		payload = new char[size];
+		memcpy(payload, buffer->data(), size);
+	}
+
 	psize = size;
 	ppayload = payload;
 	rss_verbose("encode the packet success. size=%d", size);
@@ -1418,11 +1987,6 @@ int RssPacket::encode(int& psize, char*& ppayload)
 	return ret;
 }
 
-int RssPacket::get_size()
-{
-	return 0;
-}
-
 int RssPacket::encode_packet(RssStream* stream)
 {
 	int ret = ERROR_SUCCESS;
@@ -1440,36 +2004,40 @@ RssConnectAppPacket::RssConnectAppPacket()
 {
 	command_name = RTMP_AMF0_COMMAND_CONNECT;
 	transaction_id = 1;
-	command_object = NULL;
+	objectEncoding = 0;
 }
 
 RssConnectAppPacket::~RssConnectAppPacket()
 {
-	rss_freep(command_object);
 }
 
 int RssConnectAppPacket::decode(RssStream* stream)
 {
 	int ret = ERROR_SUCCESS;
 
-	if ((ret = rss_amf0_read_string(stream, command_name)) != ERROR_SUCCESS)
+	RssAmf0Reader reader(stream);
+
+	if ((ret = reader.next()) != ERROR_SUCCESS || reader.event != RssAmf0EventString)
 	{
+		ret = (ret == ERROR_SUCCESS)? ERROR_RTMP_AMF0_DECODE : ret;
 		rss_error("amf0 decode connect command_name failed. ret=%d", ret);
 		return ret;
 	}
-	if (command_name.empty() || command_name != RTMP_AMF0_COMMAND_CONNECT)
+	if (!reader.str.equals(RTMP_AMF0_COMMAND_CONNECT))
 	{
 		ret = ERROR_RTMP_AMF0_DECODE;
 		rss_error("amf0 decode connect command_name failed. "
-		          "command_name=%s, ret=%d", command_name.c_str(), ret);
+		          "command_name=%s, ret=%d", reader.str.to_str().c_str(), ret);
 		return ret;
 	}
 
-	if ((ret = rss_amf0_read_number(stream, transaction_id)) != ERROR_SUCCESS)
+	if ((ret = reader.next()) != ERROR_SUCCESS || reader.event != RssAmf0EventNumber)
 	{
+		ret = (ret == ERROR_SUCCESS)? ERROR_RTMP_AMF0_DECODE : ret;
 		rss_error("amf0 decode connect transaction_id failed. ret=%d", ret);
 		return ret;
 	}
+	transaction_id = reader.number;
 	if (transaction_id != 1.0)
 	{
 		ret = ERROR_RTMP_AMF0_DECODE;
@@ -1478,19 +2046,121 @@ int RssConnectAppPacket::decode(RssStream* stream)
 		return ret;
 	}
 
-	if ((ret = rss_amf0_read_object(stream, command_object)) != ERROR_SUCCESS)
+	if ((ret = reader.next()) != ERROR_SUCCESS || reader.event != RssAmf0EventBeginObject)
 	{
+		ret = (ret == ERROR_SUCCESS)? ERROR_RTMP_AMF0_DECODE : ret;
 		rss_error("amf0 decode connect command_object failed. ret=%d", ret);
 		return ret;
 	}
-	if (command_object == NULL)
+
+	// read the properties util object end, ignore the others.
+	while (true)
+	{
+		if ((ret = reader.next()) != ERROR_SUCCESS)
+		{
+			rss_error("amf0 decode connect command_object property failed. ret=%d", ret);
+			return ret;
+		}
+		if (reader.event == RssAmf0EventEnd)
+		{
+			break;
+		}
+
+		std::string* str = NULL;
+		double* number = NULL;
+		if (reader.str.equals("tcUrl"))
+		{
+			str = &tcUrl;
+		}
+		else if (reader.str.equals("pageUrl"))
+		{
+			str = &pageUrl;
+		}
+		else if (reader.str.equals("swfUrl"))
+		{
+			str = &swfUrl;
+		}
+		else if (reader.str.equals("objectEncoding"))
+		{
+			number = &objectEncoding;
+		}
+
+		if ((ret = reader.next()) != ERROR_SUCCESS)
+		{
+			rss_error("amf0 decode connect command_object value failed. ret=%d", ret);
+			return ret;
+		}
+
+		if (str && reader.event == RssAmf0EventString)
+		{
+			*str = reader.str.to_str();
+		}
+		else if (number && reader.event == RssAmf0EventNumber)
+		{
+			*number = reader.number;
+		}
+		else if ((ret = reader.skip()) != ERROR_SUCCESS)
+		{
+			rss_error("amf0 decode connect command_object skip value failed. ret=%d", ret);
+			return ret;
+		}
+	}
+
+	rss_info("amf0 decode connect packet success");
+
+	return ret;
+}
+
+int RssConnectAppPacket::get_perfer_cid()
+{
+	return RTMP_CID_OverConnection;
+}
+
+int RssConnectAppPacket::get_message_type()
+{
+	return RTMP_MSG_AMF0CommandMessage;
+}
+
+int RssConnectAppPacket::encode_packet(RssStream* stream)
+{
+	int ret = ERROR_SUCCESS;
+
+	RssAmf0Object* obj = new RssAmf0Object();
+	RssAutoFree(RssAmf0Object, obj, false);
+
+	obj->set("tcUrl", new RssAmf0String(tcUrl.c_str()));
+	if (!pageUrl.empty())
+	{
+		obj->set("pageUrl", new RssAmf0String(pageUrl.c_str()));
+	}
+	if (!swfUrl.empty())
+	{
+		obj->set("swfUrl", new RssAmf0String(swfUrl.c_str()));
+	}
+	obj->set("objectEncoding", new RssAmf0Number(objectEncoding));
+
+	if ((ret = rss_amf0_write_string(stream, command_name)) != ERROR_SUCCESS)
+	{
+		rss_error("encode command_name failed. ret=%d", ret);
+		return ret;
+	}
+	rss_verbose("encode command_name success.");
+
+	if ((ret = rss_amf0_write_number(stream, transaction_id)) != ERROR_SUCCESS)
 	{
-		ret = ERROR_RTMP_AMF0_DECODE;
-		rss_error("amf0 decode connect command_object failed. ret=%d", ret);
+		rss_error("encode transaction_id failed. ret=%d", ret);
 		return ret;
 	}
+	rss_verbose("encode transaction_id success.");
 
-	rss_info("amf0 decode connect packet success");
+	if ((ret = rss_amf0_write_object(stream, obj)) != ERROR_SUCCESS)
+	{
+		rss_error("encode command_object failed. ret=%d", ret);
+		return ret;
+	}
+	rss_verbose("encode command_object success.");
+
+	rss_info("encode connect app packet success.");
 
 	return ret;
 }
@@ -1519,12 +2189,6 @@ int RssConnectAppResPacket::get_message_type()
 	return RTMP_MSG_AMF0CommandMessage;
 }
 
-int RssConnectAppResPacket::get_size()
-{
-	return rss_amf0_get_string_size(command_name) + rss_amf0_get_number_size()
-	       + rss_amf0_get_object_size(props)+ rss_amf0_get_object_size(info);
-}
-
 int RssConnectAppResPacket::encode_packet(RssStream* stream)
 {
 	int ret = ERROR_SUCCESS;
@@ -1608,6 +2272,46 @@ int RssCreateStreamPacket::decode(RssStream* stream)
 	return ret;
 }
 
+int RssCreateStreamPacket::get_perfer_cid()
+{
+	return RTMP_CID_OverConnection;
+}
+
+int RssCreateStreamPacket::get_message_type()
+{
+	return RTMP_MSG_AMF0CommandMessage;
+}
+
+int RssCreateStreamPacket::encode_packet(RssStream* stream)
+{
+	int ret = ERROR_SUCCESS;
+
+	if ((ret = rss_amf0_write_string(stream, command_name)) != ERROR_SUCCESS)
+	{
+		rss_error("encode command_name failed. ret=%d", ret);
+		return ret;
+	}
+	rss_verbose("encode command_name success.");
+
+	if ((ret = rss_amf0_write_number(stream, transaction_id)) != ERROR_SUCCESS)
+	{
+		rss_error("encode transaction_id failed. ret=%d", ret);
+		return ret;
+	}
+	rss_verbose("encode transaction_id success.");
+
+	if ((ret = rss_amf0_write_null(stream)) != ERROR_SUCCESS)
+	{
+		rss_error("encode command_object failed. ret=%d", ret);
+		return ret;
+	}
+	rss_verbose("encode command_object success.");
+
+	rss_info("encode createStream packet success.");
+
+	return ret;
+}
+
 RssCreateStreamResPacket::RssCreateStreamResPacket(double _transaction_id, double _stream_id)
 {
 	command_name = RTMP_AMF0_COMMAND_RESULT;
@@ -1631,12 +2335,6 @@ int RssCreateStreamResPacket::get_message_type()
 	return RTMP_MSG_AMF0CommandMessage;
 }
 
-int RssCreateStreamResPacket::get_size()
-{
-	return rss_amf0_get_string_size(command_name) + rss_amf0_get_number_size()
-	       + rss_amf0_get_null_size() + rss_amf0_get_number_size();
-}
-
 int RssCreateStreamResPacket::encode_packet(RssStream* stream)
 {
 	int ret = ERROR_SUCCESS;
@@ -1731,34 +2429,75 @@ int RssFMLEStartPacket::decode(RssStream* stream)
 	return ret;
 }
 
-RssFMLEStartResPacket::RssFMLEStartResPacket(double _transaction_id)
-{
-	command_name = RTMP_AMF0_COMMAND_RESULT;
-	transaction_id = _transaction_id;
-	command_object = new RssAmf0Null();
-	args = new RssAmf0Undefined();
-}
-
-RssFMLEStartResPacket::~RssFMLEStartResPacket()
-{
-	rss_freep(command_object);
-	rss_freep(args);
-}
-
-int RssFMLEStartResPacket::get_perfer_cid()
+int RssFMLEStartPacket::get_perfer_cid()
 {
 	return RTMP_CID_OverConnection;
 }
 
-int RssFMLEStartResPacket::get_message_type()
+int RssFMLEStartPacket::get_message_type()
 {
 	return RTMP_MSG_AMF0CommandMessage;
 }
 
-int RssFMLEStartResPacket::get_size()
+int RssFMLEStartPacket::encode_packet(RssStream* stream)
 {
-	return rss_amf0_get_string_size(command_name) + rss_amf0_get_number_size()
-	       + rss_amf0_get_null_size() + rss_amf0_get_undefined_size();
+	int ret = ERROR_SUCCESS;
+
+	if ((ret = rss_amf0_write_string(stream, command_name)) != ERROR_SUCCESS)
+	{
+		rss_error("encode command_name failed. ret=%d", ret);
+		return ret;
+	}
+	rss_verbose("encode command_name success.");
+
+	if ((ret = rss_amf0_write_number(stream, transaction_id)) != ERROR_SUCCESS)
+	{
+		rss_error("encode transaction_id failed. ret=%d", ret);
+		return ret;
+	}
+	rss_verbose("encode transaction_id success.");
+
+	if ((ret = rss_amf0_write_null(stream)) != ERROR_SUCCESS)
+	{
+		rss_error("encode command_object failed. ret=%d", ret);
+		return ret;
+	}
+	rss_verbose("encode command_object success.");
+
+	if ((ret = rss_amf0_write_string(stream, stream_name)) != ERROR_SUCCESS)
+	{
+		rss_error("encode stream_name failed. ret=%d", ret);
+		return ret;
+	}
+	rss_verbose("encode stream_name success.");
+
+	rss_info("encode FMLE start packet success.");
+
+	return ret;
+}
+
+RssFMLEStartResPacket::RssFMLEStartResPacket(double _transaction_id)
+{
+	command_name = RTMP_AMF0_COMMAND_RESULT;
+	transaction_id = _transaction_id;
+	command_object = new RssAmf0Null();
+	args = new RssAmf0Undefined();
+}
+
+RssFMLEStartResPacket::~RssFMLEStartResPacket()
+{
+	rss_freep(command_object);
+	rss_freep(args);
+}
+
+int RssFMLEStartResPacket::get_perfer_cid()
+{
+	return RTMP_CID_OverConnection;
+}
+
+int RssFMLEStartResPacket::get_message_type()
+{
+	return RTMP_MSG_AMF0CommandMessage;
 }
 
 int RssFMLEStartResPacket::encode_packet(RssStream* stream)
@@ -1858,6 +2597,60 @@ int RssPublishPacket::decode(RssStream* stream)
 	return ret;
 }
 
+int RssPublishPacket::get_perfer_cid()
+{
+	return RTMP_CID_OverStream;
+}
+
+int RssPublishPacket::get_message_type()
+{
+	return RTMP_MSG_AMF0CommandMessage;
+}
+
+int RssPublishPacket::encode_packet(RssStream* stream)
+{
+	int ret = ERROR_SUCCESS;
+
+	if ((ret = rss_amf0_write_string(stream, command_name)) != ERROR_SUCCESS)
+	{
+		rss_error("encode command_name failed. ret=%d", ret);
+		return ret;
+	}
+	rss_verbose("encode command_name success.");
+
+	if ((ret = rss_amf0_write_number(stream, transaction_id)) != ERROR_SUCCESS)
+	{
+		rss_error("encode transaction_id failed. ret=%d", ret);
+		return ret;
+	}
+	rss_verbose("encode transaction_id success.");
+
+	if ((ret = rss_amf0_write_null(stream)) != ERROR_SUCCESS)
+	{
+		rss_error("encode command_object failed. ret=%d", ret);
+		return ret;
+	}
+	rss_verbose("encode command_object success.");
+
+	if ((ret = rss_amf0_write_string(stream, stream_name)) != ERROR_SUCCESS)
+	{
+		rss_error("encode stream_name failed. ret=%d", ret);
+		return ret;
+	}
+	rss_verbose("encode stream_name success.");
+
+	if ((ret = rss_amf0_write_string(stream, type)) != ERROR_SUCCESS)
+	{
+		rss_error("encode type failed. ret=%d", ret);
+		return ret;
+	}
+	rss_verbose("encode type success.");
+
+	rss_info("encode publish packet success.");
+
+	return ret;
+}
+
 RssPlayPacket::RssPlayPacket()
 {
 	command_name = RTMP_AMF0_COMMAND_PLAY;
@@ -1878,54 +2671,148 @@ int RssPlayPacket::decode(RssStream* stream)
 {
 	int ret = ERROR_SUCCESS;
 
-	if ((ret = rss_amf0_read_string(stream, command_name)) != ERROR_SUCCESS)
+	RssAmf0Reader reader(stream);
+
+	if ((ret = reader.next()) != ERROR_SUCCESS || reader.event != RssAmf0EventString)
 	{
+		ret = (ret == ERROR_SUCCESS)? ERROR_RTMP_AMF0_DECODE : ret;
 		rss_error("amf0 decode play command_name failed. ret=%d", ret);
 		return ret;
 	}
-	if (command_name.empty() || command_name != RTMP_AMF0_COMMAND_PLAY)
+	if (!reader.str.equals(RTMP_AMF0_COMMAND_PLAY))
 	{
 		ret = ERROR_RTMP_AMF0_DECODE;
 		rss_error("amf0 decode play command_name failed. "
-		          "command_name=%s, ret=%d", command_name.c_str(), ret);
+		          "command_name=%s, ret=%d", reader.str.to_str().c_str(), ret);
 		return ret;
 	}
 
-	if ((ret = rss_amf0_read_number(stream, transaction_id)) != ERROR_SUCCESS)
+	if ((ret = reader.next()) != ERROR_SUCCESS || reader.event != RssAmf0EventNumber)
 	{
+		ret = (ret == ERROR_SUCCESS)? ERROR_RTMP_AMF0_DECODE : ret;
 		rss_error("amf0 decode play transaction_id failed. ret=%d", ret);
 		return ret;
 	}
+	transaction_id = reader.number;
 
-	if ((ret = rss_amf0_read_null(stream)) != ERROR_SUCCESS)
+	if ((ret = reader.next()) != ERROR_SUCCESS || reader.event != RssAmf0EventNull)
 	{
+		ret = (ret == ERROR_SUCCESS)? ERROR_RTMP_AMF0_DECODE : ret;
 		rss_error("amf0 decode play command_object failed. ret=%d", ret);
 		return ret;
 	}
 
-	if ((ret = rss_amf0_read_string(stream, stream_name)) != ERROR_SUCCESS)
+	if ((ret = reader.next()) != ERROR_SUCCESS || reader.event != RssAmf0EventString)
 	{
+		ret = (ret == ERROR_SUCCESS)? ERROR_RTMP_AMF0_DECODE : ret;
 		rss_error("amf0 decode play stream_name failed. ret=%d", ret);
 		return ret;
 	}
+	stream_name = reader.str.to_str();
 
-	if (!stream->empty() && (ret = rss_amf0_read_number(stream, start)) != ERROR_SUCCESS)
+	// the optional start, duration and reset.
+	if ((ret = reader.next()) != ERROR_SUCCESS || (reader.event != RssAmf0EventEOF && reader.event != RssAmf0EventNumber))
 	{
+		ret = (ret == ERROR_SUCCESS)? ERROR_RTMP_AMF0_DECODE : ret;
 		rss_error("amf0 decode play start failed. ret=%d", ret);
 		return ret;
 	}
-	if (!stream->empty() && (ret = rss_amf0_read_number(stream, duration)) != ERROR_SUCCESS)
+	if (reader.event == RssAmf0EventNumber)
+	{
+		start = reader.number;
+
+		if ((ret = reader.next()) != ERROR_SUCCESS || (reader.event != RssAmf0EventEOF && reader.event != RssAmf0EventNumber))
+		{
+			ret = (ret == ERROR_SUCCESS)? ERROR_RTMP_AMF0_DECODE : ret;
+			rss_error("amf0 decode play duration failed. ret=%d", ret);
+			return ret;
+		}
+	}
+	if (reader.event == RssAmf0EventNumber)
+	{
+		duration = reader.number;
+
+		if ((ret = reader.next()) != ERROR_SUCCESS || (reader.event != RssAmf0EventEOF && reader.event != RssAmf0EventBoolean))
+		{
+			ret = (ret == ERROR_SUCCESS)? ERROR_RTMP_AMF0_DECODE : ret;
+			rss_error("amf0 decode play reset failed. ret=%d", ret);
+			return ret;
+		}
+	}
+	if (reader.event == RssAmf0EventBoolean)
+	{
+		reset = reader.boolean;
+	}
+
+	rss_info("amf0 decode play packet success");
+
+	return ret;
+}
+
+int RssPlayPacket::get_perfer_cid()
+{
+	return RTMP_CID_OverStream;
+}
+
+int RssPlayPacket::get_message_type()
+{
+	return RTMP_MSG_AMF0CommandMessage;
+}
+
+int RssPlayPacket::encode_packet(RssStream* stream)
+{
+	int ret = ERROR_SUCCESS;
+
+	if ((ret = rss_amf0_write_string(stream, command_name)) != ERROR_SUCCESS)
+	{
+		rss_error("encode command_name failed. ret=%d", ret);
+		return ret;
+	}
+	rss_verbose("encode command_name success.");
+
+	if ((ret = rss_amf0_write_number(stream, transaction_id)) != ERROR_SUCCESS)
+	{
+		rss_error("encode transaction_id failed. ret=%d", ret);
+		return ret;
+	}
+	rss_verbose("encode transaction_id success.");
+
+	if ((ret = rss_amf0_write_null(stream)) != ERROR_SUCCESS)
 	{
-		rss_error("amf0 decode play duration failed. ret=%d", ret);
+		rss_error("encode command_object failed. ret=%d", ret);
 		return ret;
 	}
-	if (!stream->empty() && (ret = rss_amf0_read_boolean(stream, reset)) != ERROR_SUCCESS)
+	rss_verbose("encode command_object success.");
+
+	if ((ret = rss_amf0_write_string(stream, stream_name)) != ERROR_SUCCESS)
 	{
-		rss_error("amf0 decode play reset failed. ret=%d", ret);
+		rss_error("encode stream_name failed. ret=%d", ret);
 		return ret;
 	}
+	rss_verbose("encode stream_name success.");
 
-	rss_info("amf0 decode play packet success");
+	if ((ret = rss_amf0_write_number(stream, start)) != ERROR_SUCCESS)
+	{
+		rss_error("encode start failed. ret=%d", ret);
+		return ret;
+	}
+	rss_verbose("encode start success.");
+
+	if ((ret = rss_amf0_write_number(stream, duration)) != ERROR_SUCCESS)
+	{
+		rss_error("encode duration failed. ret=%d", ret);
+		return ret;
+	}
+	rss_verbose("encode duration success.");
+
+	if ((ret = rss_amf0_write_boolean(stream, reset)) != ERROR_SUCCESS)
+	{
+		rss_error("encode reset failed. ret=%d", ret);
+		return ret;
+	}
+	rss_verbose("encode reset success.");
+
+	rss_info("encode play packet success.");
 
 	return ret;
 }
@@ -1954,12 +2841,6 @@ int RssPlayResPacket::get_message_type()
 	return RTMP_MSG_AMF0CommandMessage;
 }
 
-int RssPlayResPacket::get_size()
-{
-	return rss_amf0_get_string_size(command_name) + rss_amf0_get_number_size()
-	       + rss_amf0_get_null_size() + rss_amf0_get_object_size(desc);
-}
-
 int RssPlayResPacket::encode_packet(RssStream* stream)
 {
 	int ret = ERROR_SUCCESS;
@@ -2020,12 +2901,6 @@ int RssOnBWDonePacket::get_message_type()
 	return RTMP_MSG_AMF0CommandMessage;
 }
 
-int RssOnBWDonePacket::get_size()
-{
-	return rss_amf0_get_string_size(command_name) + rss_amf0_get_number_size()
-	       + rss_amf0_get_null_size();
-}
-
 int RssOnBWDonePacket::encode_packet(RssStream* stream)
 {
 	int ret = ERROR_SUCCESS;
@@ -2080,12 +2955,6 @@ int RssOnStatusCallPacket::get_message_type()
 	return RTMP_MSG_AMF0CommandMessage;
 }
 
-int RssOnStatusCallPacket::get_size()
-{
-	return rss_amf0_get_string_size(command_name) + rss_amf0_get_number_size()
-	       + rss_amf0_get_null_size() + rss_amf0_get_object_size(data);
-}
-
 int RssOnStatusCallPacket::encode_packet(RssStream* stream)
 {
 	int ret = ERROR_SUCCESS;
@@ -2144,11 +3013,6 @@ int RssOnStatusDataPacket::get_message_type()
 	return RTMP_MSG_AMF0DataMessage;
 }
 
-int RssOnStatusDataPacket::get_size()
-{
-	return rss_amf0_get_string_size(command_name) + rss_amf0_get_object_size(data);
-}
-
 int RssOnStatusDataPacket::encode_packet(RssStream* stream)
 {
 	int ret = ERROR_SUCCESS;
@@ -2193,12 +3057,6 @@ int RssSampleAccessPacket::get_message_type()
 	return RTMP_MSG_AMF0DataMessage;
 }
 
-int RssSampleAccessPacket::get_size()
-{
-	return rss_amf0_get_string_size(command_name)
-	       + rss_amf0_get_boolean_size() + rss_amf0_get_boolean_size();
-}
-
 int RssSampleAccessPacket::encode_packet(RssStream* stream)
 {
 	int ret = ERROR_SUCCESS;
@@ -2289,7 +3147,7 @@ int RssOnMetaDataPacket::decode(RssStream* stream)
 
 	for (int i = 0; i < arr->size(); i++)
 	{
-		metadata->set(arr->key_at(i), arr->value_at(i));
+		metadata->set(arr->key_view_at(i), arr->value_at(i));
 	}
 	arr->clear();
 	rss_info("decode metadata array success");
@@ -2307,11 +3165,6 @@ int RssOnMetaDataPacket::get_message_type()
 	return RTMP_MSG_AMF0DataMessage;
 }
 
-int RssOnMetaDataPacket::get_size()
-{
-	return rss_amf0_get_string_size(name) + rss_amf0_get_object_size(metadata);
-}
-
 int RssOnMetaDataPacket::encode_packet(RssStream* stream)
 {
 	int ret = ERROR_SUCCESS;
@@ -2334,6 +3187,214 @@ int RssOnMetaDataPacket::encode_packet(RssStream* stream)
 	return ret;
 }
 
+int rss_rtmp_splice_metadata(RssCommonMessage* msg, const RssStringView& name, const RssStringView& value,
+	RssEncodeBuffer* buffer, int& psize, char*& ppayload)
+{
+	int ret = ERROR_SUCCESS;
+
+	if (!msg->header.is_amf0_data() || !msg->payload || msg->size <= 0)
+	{
+		ret = ERROR_RTMP_MESSAGE_DECODE;
+		rss_verbose("only AMF0 data message can be spliced, type=%d. ret=%d", msg->header.message_type, ret);
+		return ret;
+	}
+
+	RssStream stream;
+	if ((ret = stream.initialize((char*)msg->payload, msg->size)) != ERROR_SUCCESS)
+	{
+		return ret;
+	}
+
+	RssStringView data_name;
+	RssAmf0Reader reader(&stream);
+
+	if ((ret = reader.next()) != ERROR_SUCCESS || reader.event != RssAmf0EventString)
+	{
+		ret = (ret == ERROR_SUCCESS)? ERROR_RTMP_AMF0_DECODE : ret;
+		rss_error("splice metadata name failed. ret=%d", ret);
+		return ret;
+	}
+	data_name = reader.str;
+
+	// ignore the @setDataFrame
+	if (data_name.equals(RTMP_AMF0_DATA_SET_DATAFRAME))
+	{
+		if ((ret = reader.next()) != ERROR_SUCCESS || reader.event != RssAmf0EventString)
+		{
+			ret = (ret == ERROR_SUCCESS)? ERROR_RTMP_AMF0_DECODE : ret;
+			rss_error("splice metadata name failed. ret=%d", ret);
+			return ret;
+		}
+		data_name = reader.str;
+	}
+
+	if ((ret = buffer->rewind()) != ERROR_SUCCESS)
+	{
+		return ret;
+	}
+
+	if ((ret = rss_amf0_write_string(buffer, data_name)) != ERROR_SUCCESS)
+	{
+		rss_error("splice metadata write name failed. ret=%d", ret);
+		return ret;
+	}
+
+	if ((ret = rss_amf0_splice_string_property(&stream, name, value, buffer)) != ERROR_SUCCESS)
+	{
+		rss_error("splice metadata property failed. ret=%d", ret);
+		return ret;
+	}
+
+	psize = buffer->length();
+	ppayload = new char[psize];
+	memcpy(ppayload, buffer->data(), psize);
+	rss_verbose("splice metadata success. size=%d", psize);
+
+	return ret;
+}
+
+int rss_rtmp_demux_aggregate(RssCommonMessage* msg, std::vector<RssCommonMessage*>& msgs)
+{
+	int ret = ERROR_SUCCESS;
+
+	if (!msg->header.is_aggregate() || !msg->payload || msg->size <= 0)
+	{
+		ret = ERROR_RTMP_AGGREGATE;
+		rss_error("only aggregate message can be demuxed, type=%d. ret=%d", msg->header.message_type, ret);
+		return ret;
+	}
+
+	RssStream stream;
+	if ((ret = stream.initialize((char*)msg->payload, msg->size)) != ERROR_SUCCESS)
+	{
+		return ret;
+	}
+
+	// the timestamp of the first sub message,
+	// the sub messages are offset to the timestamp of aggregate message.
+	int32_t base_time = 0;
+	bool first = true;
+
+	while (!stream.empty())
+	{
+		if (!stream.require(RTMP_AGGREGATE_TAG_HEADER_SIZE))
+		{
+			ret = ERROR_RTMP_AGGREGATE;
+			rss_error("aggregate requires %d bytes tag header. ret=%d", RTMP_AGGREGATE_TAG_HEADER_SIZE, ret);
+			return ret;
+		}
+
+		int8_t type = stream.read_1bytes();
+		int32_t data_size = stream.read_3bytes();
+		int32_t timestamp = stream.read_3bytes();
+		timestamp |= (int32_t)((uint8_t)stream.read_1bytes() << 24);
+		// ignore the stream id, use the stream id of aggregate message.
+		stream.read_3bytes();
+
+		if (data_size > 0 && !stream.require(data_size))
+		{
+			ret = ERROR_RTMP_AGGREGATE;
+			rss_error("aggregate requires %d bytes tag data. ret=%d", data_size, ret);
+			return ret;
+		}
+
+		if (first)
+		{
+			base_time = timestamp;
+			first = false;
+		}
+
+		if (data_size > 0 && (type == RTMP_MSG_AudioMessage || type == RTMP_MSG_VideoMessage))
+		{
+			RssCommonMessage* sub = new RssCommonMessage();
+			msgs.push_back(sub);
+
+			sub->header = msg->header;
+			sub->header.message_type = type;
+			sub->header.payload_length = data_size;
+			sub->header.timestamp = msg->header.timestamp + (timestamp - base_time);
+
+			sub->size = data_size;
+			sub->payload = new int8_t[data_size];
+			memcpy(sub->payload, stream.current(), data_size);
+		}
+		else
+		{
+			rss_verbose("ignore aggregate sub message. type=%d, size=%d", type, data_size);
+		}
+		stream.skip(data_size);
+
+		// the back pointer of the last tag maybe omitted.
+		if (stream.require(RTMP_AGGREGATE_BACK_POINTER_SIZE))
+		{
+			stream.skip(RTMP_AGGREGATE_BACK_POINTER_SIZE);
+		}
+	}
+	rss_verbose("demux aggregate message success. size=%d, msgs=%d", msg->size, (int)msgs.size());
+
+	return ret;
+}
+
+int rss_rtmp_pack_aggregate(RssSharedPtrMessage** msgs, int count, RssSharedPtrMessage*& aggregate)
+{
+	int ret = ERROR_SUCCESS;
+
+	rss_assert(count > 0);
+
+	int size = 0;
+	for (int i = 0; i < count; i++)
+	{
+		RssSharedPtrMessage* msg = msgs[i];
+
+		if (!msg->header.is_audio() && !msg->header.is_video())
+		{
+			ret = ERROR_RTMP_AGGREGATE;
+			rss_error("only audio and video can be packed, type=%d. ret=%d", msg->header.message_type, ret);
+			return ret;
+		}
+
+		size += RTMP_AGGREGATE_TAG_HEADER_SIZE + msg->size + RTMP_AGGREGATE_BACK_POINTER_SIZE;
+	}
+
+	char* payload = new char[size];
+
+	RssStream stream;
+	if ((ret = stream.initialize(payload, size)) != ERROR_SUCCESS)
+	{
+		rss_freepa(payload);
+		return ret;
+	}
+
+	for (int i = 0; i < count; i++)
+	{
+		RssSharedPtrMessage* msg = msgs[i];
+
+		stream.write_1bytes(msg->header.message_type);
+		stream.write_3bytes(msg->size);
+		stream.write_3bytes(msg->header.timestamp & 0xFFFFFF);
+		stream.write_1bytes((int8_t)(msg->header.timestamp >> 24));
+		stream.write_3bytes(0);
+
+		memcpy(stream.current(), msg->payload, msg->size);
+		stream.skip(msg->size);
+
+		stream.write_4bytes(RTMP_AGGREGATE_TAG_HEADER_SIZE + msg->size);
+	}
+
+	// the aggregate is sendout over the cid of first message.
+	aggregate = new RssSharedPtrMessage();
+	if ((ret = aggregate->initialize(msgs[0], payload, size)) != ERROR_SUCCESS)
+	{
+		rss_freep(aggregate);
+		rss_freepa(payload);
+		return ret;
+	}
+	aggregate->header.message_type = RTMP_MSG_AggregateMessage;
+	rss_verbose("pack aggregate message success. msgs=%d, size=%d", count, size);
+
+	return ret;
+}
+
 RssSetWindowAckSizePacket::RssSetWindowAckSizePacket()
 {
 	ackowledgement_window_size = 0;
@@ -2370,11 +3431,6 @@ int RssSetWindowAckSizePacket::get_message_type()
 	return RTMP_MSG_WindowAcknowledgementSize;
 }
 
-int RssSetWindowAckSizePacket::get_size()
-{
-	return 4;
-}
-
 int RssSetWindowAckSizePacket::encode_packet(RssStream* stream)
 {
 	int ret = ERROR_SUCCESS;
@@ -2438,11 +3494,6 @@ int RssSetChunkSizePacket::get_message_type()
 	return RTMP_MSG_SetChunkSize;
 }
 
-int RssSetChunkSizePacket::get_size()
-{
-	return 4;
-}
-
 int RssSetChunkSizePacket::encode_packet(RssStream* stream)
 {
 	int ret = ERROR_SUCCESS;
@@ -2481,11 +3532,6 @@ int RssSetPeerBandwidthPacket::get_message_type()
 	return RTMP_MSG_SetPeerBandwidth;
 }
 
-int RssSetPeerBandwidthPacket::get_size()
-{
-	return 5;
-}
-
 int RssSetPeerBandwidthPacket::encode_packet(RssStream* stream)
 {
 	int ret = ERROR_SUCCESS;
@@ -2526,11 +3572,6 @@ int RssPCUC4BytesPacket::get_message_type()
 	return RTMP_MSG_UserControlMessage;
 }
 
-int RssPCUC4BytesPacket::get_size()
-{
-	return 2 + 4;
-}
-
 int RssPCUC4BytesPacket::encode_packet(RssStream* stream)
 {
 	int ret = ERROR_SUCCESS;
@@ -2551,3 +3592,189 @@ int RssPCUC4BytesPacket::encode_packet(RssStream* stream)
 	return ret;
 }
 
+
+/**
+* discovery the offset of encoded value in payload.
+* @return the offset, -1 if not found.
+*/
+int rss_template_find(char* payload, int size, char* value, int value_size)
+{
+	for (int i = 0; i <= size - value_size; i++)
+	{
+		if (memcmp(payload + i, value, value_size) == 0)
+		{
+			return i;
+		}
+	}
+
+	return -1;
+}
+
+RssPacketTemplate::RssPacketTemplate()
+{
+	message_type = 0;
+	perfer_cid = 0;
+	size = 0;
+	payload = NULL;
+	tid_offset = stream_id_offset = client_id_offset = -1;
+}
+
+RssPacketTemplate::~RssPacketTemplate()
+{
+	rss_freepa(payload);
+}
+
+int RssPacketTemplate::initialize(RssPacket* pkt)
+{
+	int ret = ERROR_SUCCESS;
+
+	message_type = pkt->get_message_type();
+	perfer_cid = pkt->get_perfer_cid();
+
+	rss_freepa(payload);
+	if ((ret = pkt->encode(NULL, size, payload)) != ERROR_SUCCESS)
+	{
+		rss_error("encode the packet template failed. ret=%d", ret);
+		return ret;
+	}
+
+	char value[16];
+	RssStream stream;
+
+	if ((ret = stream.initialize(value, sizeof(value))) != ERROR_SUCCESS)
+	{
+		return ret;
+	}
+	rss_amf0_write_number(&stream, RTMP_TEMPLATE_TRANSACTION_ID);
+	tid_offset = rss_template_find(payload, size, value, stream.pos());
+
+	stream.reset();
+	rss_amf0_write_number(&stream, RTMP_TEMPLATE_STREAM_ID);
+	stream_id_offset = rss_template_find(payload, size, value, stream.pos());
+
+	stream.reset();
+	rss_amf0_write_string(&stream, RTMP_TEMPLATE_CLIENT_ID);
+	client_id_offset = rss_template_find(payload, size, value, stream.pos());
+
+	rss_verbose("initialize packet template success. size=%d, "
+	            "tid_offset=%d, stream_id_offset=%d, client_id_offset=%d",
+	            size, tid_offset, stream_id_offset, client_id_offset);
+
+	return ret;
+}
+
+int RssPacketTemplate::get_perfer_cid()
+{
+	return perfer_cid;
+}
+
+int RssPacketTemplate::get_message_type()
+{
+	return message_type;
+}
+
+int RssPacketTemplate::get_size()
+{
+	return size;
+}
+
+int RssPacketTemplate::encode(double transaction_id, double stream_id, const std::string& client_id, char*& ppayload)
+{
+	int ret = ERROR_SUCCESS;
+
+	if (size <= 0)
+	{
+		ppayload = NULL;
+		return ret;
+	}
+
+	char* bytes = new char[size];
+	memcpy(bytes, payload, size);
+
+	RssStream stream;
+
+	if (tid_offset >= 0)
+	{
+		stream.initialize(bytes + tid_offset, size - tid_offset);
+		if ((ret = rss_amf0_write_number(&stream, transaction_id)) != ERROR_SUCCESS)
+		{
+			rss_error("patch template transaction_id failed. ret=%d", ret);
+			rss_freepa(bytes);
+			return ret;
+		}
+	}
+
+	if (stream_id_offset >= 0)
+	{
+		stream.initialize(bytes + stream_id_offset, size - stream_id_offset);
+		if ((ret = rss_amf0_write_number(&stream, stream_id)) != ERROR_SUCCESS)
+		{
+			rss_error("patch template stream_id failed. ret=%d", ret);
+			rss_freepa(bytes);
+			return ret;
+		}
+	}
+
+	if (client_id_offset >= 0)
+	{
+		if ((int)client_id.length() != RTMP_TEMPLATE_CLIENT_ID_SIZE)
+		{
+			ret = ERROR_RTMP_MESSAGE_ENCODE;
+			rss_error("patch template clientid failed, "
+			          "size=%d, required=%d. ret=%d", (int)client_id.length(), RTMP_TEMPLATE_CLIENT_ID_SIZE, ret);
+			rss_freepa(bytes);
+			return ret;
+		}
+
+		stream.initialize(bytes + client_id_offset, size - client_id_offset);
+		if ((ret = rss_amf0_write_string(&stream, client_id)) != ERROR_SUCCESS)
+		{
+			rss_error("patch template clientid failed. ret=%d", ret);
+			rss_freepa(bytes);
+			return ret;
+		}
+	}
+
+	ppayload = bytes;
+
+	return ret;
+}
+
+RssTemplatePacket::RssTemplatePacket(RssPacketTemplate* _tmpl)
+{
+	tmpl = _tmpl;
+	transaction_id = 0;
+	stream_id = 0;
+}
+
+RssTemplatePacket::~RssTemplatePacket()
+{
+}
+
+int RssTemplatePacket::get_perfer_cid()
+{
+	return tmpl->get_perfer_cid();
+}
+
+int RssTemplatePacket::get_message_type()
+{
+	return tmpl->get_message_type();
+}
+
+int RssTemplatePacket::encode(RssEncodeBuffer* /*buffer*/, int& psize, char*& ppayload)
+{
+	int ret = ERROR_SUCCESS;
+
+	char* payload = NULL;
+	if ((ret = tmpl->encode(transaction_id, stream_id, client_id, payload)) != ERROR_SUCCESS)
+	{
+		rss_error("encode the packet from template failed. ret=%d", ret);
+		return ret;
+	}
+
+	psize = tmpl->get_size();
+	ppayload = payload;
+	rss_verbose("encode the packet from template success. size=%d", psize);
+
+	return ret;
+}
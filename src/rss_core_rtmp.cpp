@@ -1,3 +1,6 @@
+// the log subsystem of this file, see RssLogSubsystem.
+#define RSS_LOG_SUBSYSTEM RssLogSubsystemRtmp
+
 #include <rss_core_rtmp.hpp>
 
 #include <rss_core_log.hpp>
@@ -6,13 +9,17 @@
 #include <rss_core_protocol.hpp>
 #include <rss_core_auto_free.hpp>
 #include <rss_core_amf0.hpp>
+#include <rss_core_stream.hpp>
 
 /**
 * the signature for packets to client.
 */
 #define RTMP_SIG_FMS_VER "3,5,3,888"
 #define RTMP_SIG_AMF0_VER 0
-#define RTMP_SIG_CLIENT_ID "ASAICiss"
+#define RTMP_SIG_AMF3_VER 3
+// the clientid is the prefix and the hex seq of connection,
+// the same length of RTMP_TEMPLATE_CLIENT_ID_SIZE.
+#define RTMP_SIG_CLIENT_ID_PREFIX "ASAI"
 
 /**
 * onStatus consts.
@@ -31,14 +38,161 @@
 #define StatusCodePublishStart "NetStream.Publish.Start"
 #define StatusCodeDataStart "NetStream.Data.Start"
 #define StatusCodeUnpublishSuccess "NetStream.Unpublish.Success"
+#define StatusLevelError "error"
 
 // FMLE
 #define RTMP_AMF0_COMMAND_ON_FC_PUBLISH		"onFCPublish"
 #define RTMP_AMF0_COMMAND_ON_FC_UNPUBLISH	"onFCUnpublish"
+// the client
+#define RTMP_AMF0_COMMAND_RELEASE_STREAM	"releaseStream"
+#define RTMP_AMF0_COMMAND_FC_PUBLISH		"FCPublish"
+#define RTMP_AMF0_COMMAND_ON_STATUS			"onStatus"
+#define RTMP_AMF0_COMMAND_RESULT			"_result"
+#define RTMP_AMF0_COMMAND_ERROR				"_error"
 
 // default stream id for response the createStream request.
 #define RSS_DEFAULT_SID 1
 
+/**
+* the precompiled command responses, see RssRtmp::initialize_templates().
+*/
+static RssPacketTemplate* rtmp_templates[RssTemplateMax];
+
+RssConnectAppResPacket* rss_rtmp_create_connect_app_res(double object_encoding)
+{
+	RssConnectAppResPacket* pkt = new RssConnectAppResPacket();
+
+	pkt->props->set("fmsVer", new RssAmf0String("FMS/" RTMP_SIG_FMS_VER));
+	pkt->props->set("capabilities", new RssAmf0Number(127));
+	pkt->props->set("mode", new RssAmf0Number(1));
+
+	pkt->info->set(StatusLevel, new RssAmf0String(StatusLevelStatus));
+	pkt->info->set(StatusCode, new RssAmf0String(StatusCodeConnectSuccess));
+	pkt->info->set(StatusDescription, new RssAmf0String("Connection succeeded"));
+	pkt->info->set("objectEncoding", new RssAmf0Number(object_encoding));
+	RssARssAmf0EcmaArray* data = new RssARssAmf0EcmaArray();
+	pkt->info->set("data", data);
+
+	data->set("version", new RssAmf0String(RTMP_SIG_FMS_VER));
+	data->set("server", new RssAmf0String(RTMP_SIG_RSS_NAME));
+	data->set("rss_url", new RssAmf0String(RTMP_SIG_RSS_URL));
+	data->set("rss_version", new RssAmf0String(RTMP_SIG_RSS_VERSION));
+
+	return pkt;
+}
+
+/**
+* create the packet of template, the fields to patch are set to the sentinels.
+*/
+RssPacket* rss_rtmp_create_template_packet(RssRtmpTemplate type)
+{
+	switch (type)
+	{
+	case RssTemplateConnectAmf0:
+	{
+		return rss_rtmp_create_connect_app_res(RTMP_SIG_AMF0_VER);
+	}
+	case RssTemplateConnectAmf3:
+	{
+		return rss_rtmp_create_connect_app_res(RTMP_SIG_AMF3_VER);
+	}
+	case RssTemplateOnBWDone:
+	{
+		return new RssOnBWDonePacket();
+	}
+	case RssTemplateCreateStream:
+	{
+		return new RssCreateStreamResPacket(RTMP_TEMPLATE_TRANSACTION_ID, RTMP_TEMPLATE_STREAM_ID);
+	}
+	case RssTemplateFMLEStart:
+	{
+		return new RssFMLEStartResPacket(RTMP_TEMPLATE_TRANSACTION_ID);
+	}
+	case RssTemplatePlayReset:
+	{
+		RssOnStatusCallPacket* pkt = new RssOnStatusCallPacket();
+
+		pkt->data->set(StatusLevel, new RssAmf0String(StatusLevelStatus));
+		pkt->data->set(StatusCode, new RssAmf0String(StatusCodeStreamReset));
+		pkt->data->set(StatusDescription, new RssAmf0String("Playing and resetting stream."));
+		pkt->data->set(StatusDetails, new RssAmf0String("stream"));
+		pkt->data->set(StatusClientId, new RssAmf0String(RTMP_TEMPLATE_CLIENT_ID));
+
+		return pkt;
+	}
+	case RssTemplatePlayStart:
+	{
+		RssOnStatusCallPacket* pkt = new RssOnStatusCallPacket();
+
+		pkt->data->set(StatusLevel, new RssAmf0String(StatusLevelStatus));
+		pkt->data->set(StatusCode, new RssAmf0String(StatusCodeStreamStart));
+		pkt->data->set(StatusDescription, new RssAmf0String("Started playing stream."));
+		pkt->data->set(StatusDetails, new RssAmf0String("stream"));
+		pkt->data->set(StatusClientId, new RssAmf0String(RTMP_TEMPLATE_CLIENT_ID));
+
+		return pkt;
+	}
+	case RssTemplateSampleAccess:
+	{
+		return new RssSampleAccessPacket();
+	}
+	case RssTemplateDataStart:
+	{
+		RssOnStatusDataPacket* pkt = new RssOnStatusDataPacket();
+
+		pkt->data->set(StatusCode, new RssAmf0String(StatusCodeDataStart));
+
+		return pkt;
+	}
+	case RssTemplateFCPublish:
+	{
+		RssOnStatusCallPacket* pkt = new RssOnStatusCallPacket();
+
+		pkt->command_name = RTMP_AMF0_COMMAND_ON_FC_PUBLISH;
+		pkt->data->set(StatusCode, new RssAmf0String(StatusCodePublishStart));
+		pkt->data->set(StatusDescription, new RssAmf0String("Started publishing stream."));
+
+		return pkt;
+	}
+	case RssTemplatePublishStart:
+	{
+		RssOnStatusCallPacket* pkt = new RssOnStatusCallPacket();
+
+		pkt->data->set(StatusLevel, new RssAmf0String(StatusLevelStatus));
+		pkt->data->set(StatusCode, new RssAmf0String(StatusCodePublishStart));
+		pkt->data->set(StatusDescription, new RssAmf0String("Started publishing stream."));
+		pkt->data->set(StatusClientId, new RssAmf0String(RTMP_TEMPLATE_CLIENT_ID));
+
+		return pkt;
+	}
+	case RssTemplateFCUnpublish:
+	{
+		RssOnStatusCallPacket* pkt = new RssOnStatusCallPacket();
+
+		pkt->command_name = RTMP_AMF0_COMMAND_ON_FC_UNPUBLISH;
+		pkt->data->set(StatusCode, new RssAmf0String(StatusCodeUnpublishSuccess));
+		pkt->data->set(StatusDescription, new RssAmf0String("Stop publishing stream."));
+
+		return pkt;
+	}
+	case RssTemplateUnpublish:
+	{
+		RssOnStatusCallPacket* pkt = new RssOnStatusCallPacket();
+
+		pkt->data->set(StatusLevel, new RssAmf0String(StatusLevelStatus));
+		pkt->data->set(StatusCode, new RssAmf0String(StatusCodeUnpublishSuccess));
+		pkt->data->set(StatusDescription, new RssAmf0String("Stream is now unpublished"));
+		pkt->data->set(StatusClientId, new RssAmf0String(RTMP_TEMPLATE_CLIENT_ID));
+
+		return pkt;
+	}
+	default:
+	{
+		return NULL;
+	}
+	}
+}
+
 RssRequest::RssRequest()
 {
 	objectEncoding = RTMP_SIG_AMF0_VER;
@@ -120,6 +274,12 @@ RssRtmp::RssRtmp(st_netfd_t client_stfd)
 {
 	protocol = new RssProtocol(client_stfd);
 	stfd = client_stfd;
+
+	// the clientid in onStatus, identify the connection.
+	static int client_seq = 0;
+	char buf[RTMP_TEMPLATE_CLIENT_ID_SIZE + 1];
+	snprintf(buf, sizeof(buf), RTMP_SIG_CLIENT_ID_PREFIX "%04x", (client_seq++) & 0xffff);
+	client_id = buf;
 }
 
 RssRtmp::~RssRtmp()
@@ -137,6 +297,21 @@ void RssRtmp::set_send_timeout(int timeout_ms)
 	return protocol->set_send_timeout(timeout_ms);
 }
 
+int64_t RssRtmp::get_recv_bytes()
+{
+	return protocol->get_recv_bytes();
+}
+
+int64_t RssRtmp::get_send_bytes()
+{
+	return protocol->get_send_bytes();
+}
+
+int64_t RssRtmp::get_inflight_bytes()
+{
+	return protocol->get_inflight_bytes();
+}
+
 int RssRtmp::recv_message(RssCommonMessage** pmsg)
 {
 	return protocol->recv_message(pmsg);
@@ -147,6 +322,46 @@ int RssRtmp::send_message(IRssMessage* msg)
 	return protocol->send_message(msg);
 }
 
+int RssRtmp::initialize_templates()
+{
+	int ret = ERROR_SUCCESS;
+
+	for (int i = 0; i < RssTemplateMax; i++)
+	{
+		if (rtmp_templates[i])
+		{
+			continue;
+		}
+
+		RssPacket* pkt = rss_rtmp_create_template_packet((RssRtmpTemplate)i);
+		rss_assert(pkt != NULL);
+		RssAutoFree(RssPacket, pkt, false);
+
+		RssPacketTemplate* tmpl = new RssPacketTemplate();
+		if ((ret = tmpl->initialize(pkt)) != ERROR_SUCCESS)
+		{
+			rss_error("initialize rtmp template %d failed. ret=%d", i, ret);
+			rss_freep(tmpl);
+			return ret;
+		}
+
+		rtmp_templates[i] = tmpl;
+	}
+	rss_trace("initialize rtmp templates success. count=%d", RssTemplateMax);
+
+	return ret;
+}
+
+void RssRtmp::start_batch()
+{
+	protocol->start_batch();
+}
+
+int RssRtmp::flush_batch()
+{
+	return protocol->flush_batch();
+}
+
 int RssRtmp::handshake()
 {
 	int ret = ERROR_SUCCESS;
@@ -211,30 +426,16 @@ int RssRtmp::connect_app(RssRequest* req)
 	RssAutoFree(RssCommonMessage, msg, false);
 	rss_info("get connect app message");
 
-	RssAmf0Any* prop = NULL;
-
-	if ((prop = pkt->command_object->ensure_property_string("tcUrl")) == NULL)
+	if (pkt->tcUrl.empty())
 	{
 		ret = ERROR_RTMP_REQ_CONNECT;
 		rss_error("invalid request, must specifies the tcUrl. ret=%d", ret);
 		return ret;
 	}
-	req->tcUrl = rss_amf0_convert<RssAmf0String>(prop)->value;
-
-	if ((prop = pkt->command_object->ensure_property_string("pageUrl")) != NULL)
-	{
-		req->pageUrl = rss_amf0_convert<RssAmf0String>(prop)->value;
-	}
-
-	if ((prop = pkt->command_object->ensure_property_string("swfUrl")) != NULL)
-	{
-		req->swfUrl = rss_amf0_convert<RssAmf0String>(prop)->value;
-	}
-
-	if ((prop = pkt->command_object->ensure_property_number("objectEncoding")) != NULL)
-	{
-		req->objectEncoding = rss_amf0_convert<RssAmf0Number>(prop)->value;
-	}
+	req->tcUrl = pkt->tcUrl;
+	req->pageUrl = pkt->pageUrl;
+	req->swfUrl = pkt->swfUrl;
+	req->objectEncoding = pkt->objectEncoding;
 
 	rss_info("get connect app message params success.");
 
@@ -245,13 +446,7 @@ int RssRtmp::set_window_ack_size(int ack_size)
 {
 	int ret = ERROR_SUCCESS;
 
-	RssCommonMessage* msg = new RssCommonMessage();
-	RssSetWindowAckSizePacket* pkt = new RssSetWindowAckSizePacket();
-
-	pkt->ackowledgement_window_size = ack_size;
-	msg->set_packet(pkt, 0);
-
-	if ((ret = protocol->send_message(msg)) != ERROR_SUCCESS)
+	if ((ret = protocol->send_window_ack_size(ack_size)) != ERROR_SUCCESS)
 	{
 		rss_error("send ack size message failed. ret=%d", ret);
 		return ret;
@@ -265,14 +460,7 @@ int RssRtmp::set_peer_bandwidth(int bandwidth, int type)
 {
 	int ret = ERROR_SUCCESS;
 
-	RssCommonMessage* msg = new RssCommonMessage();
-	RssSetPeerBandwidthPacket* pkt = new RssSetPeerBandwidthPacket();
-
-	pkt->bandwidth = bandwidth;
-	pkt->type = type;
-	msg->set_packet(pkt, 0);
-
-	if ((ret = protocol->send_message(msg)) != ERROR_SUCCESS)
+	if ((ret = protocol->send_peer_bandwidth(bandwidth, type)) != ERROR_SUCCESS)
 	{
 		rss_error("send set bandwidth message failed. ret=%d", ret);
 		return ret;
@@ -287,24 +475,27 @@ int RssRtmp::response_connect_app(RssRequest* req)
 {
 	int ret = ERROR_SUCCESS;
 
-	RssCommonMessage* msg = new RssCommonMessage();
-	RssConnectAppResPacket* pkt = new RssConnectAppResPacket();
+	// use the precompiled response for the general object encoding.
+	if (req->objectEncoding == RTMP_SIG_AMF0_VER || req->objectEncoding == RTMP_SIG_AMF3_VER)
+	{
+		RssRtmpTemplate type = RssTemplateConnectAmf0;
+		if (req->objectEncoding == RTMP_SIG_AMF3_VER)
+		{
+			type = RssTemplateConnectAmf3;
+		}
 
-	pkt->props->set("fmsVer", new RssAmf0String("FMS/" RTMP_SIG_FMS_VER));
-	pkt->props->set("capabilities", new RssAmf0Number(127));
-	pkt->props->set("mode", new RssAmf0Number(1));
+		if ((ret = send_template(type, 1, 0, 0)) != ERROR_SUCCESS)
+		{
+			rss_error("send connect app response message failed. ret=%d", ret);
+			return ret;
+		}
+		rss_info("send connect app response message success.");
 
-	pkt->info->set(StatusLevel, new RssAmf0String(StatusLevelStatus));
-	pkt->info->set(StatusCode, new RssAmf0String(StatusCodeConnectSuccess));
-	pkt->info->set(StatusDescription, new RssAmf0String("Connection succeeded"));
-	pkt->info->set("objectEncoding", new RssAmf0Number(req->objectEncoding));
-	RssARssAmf0EcmaArray* data = new RssARssAmf0EcmaArray();
-	pkt->info->set("data", data);
+		return ret;
+	}
 
-	data->set("version", new RssAmf0String(RTMP_SIG_FMS_VER));
-	data->set("server", new RssAmf0String(RTMP_SIG_RSS_NAME));
-	data->set("rss_url", new RssAmf0String(RTMP_SIG_RSS_URL));
-	data->set("rss_version", new RssAmf0String(RTMP_SIG_RSS_VERSION));
+	RssCommonMessage* msg = new RssCommonMessage();
+	RssConnectAppResPacket* pkt = rss_rtmp_create_connect_app_res(req->objectEncoding);
 
 	msg->set_packet(pkt, 0);
 
@@ -313,7 +504,7 @@ int RssRtmp::response_connect_app(RssRequest* req)
 		rss_error("send connect app response message failed. ret=%d", ret);
 		return ret;
 	}
-	rss_info("send connect app response message success.");
+	rss_info("send connect app response message success. objectEncoding=%.1f", req->objectEncoding);
 
 	return ret;
 }
@@ -322,12 +513,7 @@ int RssRtmp::on_bw_done()
 {
 	int ret = ERROR_SUCCESS;
 
-	RssCommonMessage* msg = new RssCommonMessage();
-	RssOnBWDonePacket* pkt = new RssOnBWDonePacket();
-
-	msg->set_packet(pkt, 0);
-
-	if ((ret = protocol->send_message(msg)) != ERROR_SUCCESS)
+	if ((ret = send_template(RssTemplateOnBWDone, 0, 0, 0)) != ERROR_SUCCESS)
 	{
 		rss_error("send onBWDone message failed. ret=%d", ret);
 		return ret;
@@ -390,13 +576,7 @@ int RssRtmp::set_chunk_size(int chunk_size)
 {
 	int ret = ERROR_SUCCESS;
 
-	RssCommonMessage* msg = new RssCommonMessage();
-	RssSetChunkSizePacket* pkt = new RssSetChunkSizePacket();
-
-	pkt->chunk_size = chunk_size;
-	msg->set_packet(pkt, 0);
-
-	if ((ret = protocol->send_message(msg)) != ERROR_SUCCESS)
+	if ((ret = protocol->send_set_chunk_size(chunk_size)) != ERROR_SUCCESS)
 	{
 		rss_error("send set chunk size message failed. ret=%d", ret);
 		return ret;
@@ -410,100 +590,53 @@ int RssRtmp::start_play(int stream_id)
 {
 	int ret = ERROR_SUCCESS;
 
+	// sendout all response packets in one write.
+	protocol->start_batch();
+
 	// StreamBegin
-	if (true)
+	if ((ret = protocol->send_user_control(SrcPCUCStreamBegin, stream_id)) != ERROR_SUCCESS)
 	{
-		RssCommonMessage* msg = new RssCommonMessage();
-		RssPCUC4BytesPacket* pkt = new RssPCUC4BytesPacket();
-
-		pkt->event_type = SrcPCUCStreamBegin;
-		pkt->event_data = stream_id;
-		msg->set_packet(pkt, 0);
-
-		if ((ret = protocol->send_message(msg)) != ERROR_SUCCESS)
-		{
-			rss_error("send PCUC(StreamBegin) message failed. ret=%d", ret);
-			return ret;
-		}
-		rss_info("send PCUC(StreamBegin) message success.");
+		rss_error("send PCUC(StreamBegin) message failed. ret=%d", ret);
+		return ret;
 	}
+	rss_info("send PCUC(StreamBegin) message success.");
 
 	// onStatus(NetStream.Play.Reset)
-	if (true)
+	if ((ret = send_template(RssTemplatePlayReset, 0, 0, stream_id)) != ERROR_SUCCESS)
 	{
-		RssCommonMessage* msg = new RssCommonMessage();
-		RssOnStatusCallPacket* pkt = new RssOnStatusCallPacket();
-
-		pkt->data->set(StatusLevel, new RssAmf0String(StatusLevelStatus));
-		pkt->data->set(StatusCode, new RssAmf0String(StatusCodeStreamReset));
-		pkt->data->set(StatusDescription, new RssAmf0String("Playing and resetting stream."));
-		pkt->data->set(StatusDetails, new RssAmf0String("stream"));
-		pkt->data->set(StatusClientId, new RssAmf0String(RTMP_SIG_CLIENT_ID));
-
-		msg->set_packet(pkt, stream_id);
-
-		if ((ret = protocol->send_message(msg)) != ERROR_SUCCESS)
-		{
-			rss_error("send onStatus(NetStream.Play.Reset) message failed. ret=%d", ret);
-			return ret;
-		}
-		rss_info("send onStatus(NetStream.Play.Reset) message success.");
+		rss_error("send onStatus(NetStream.Play.Reset) message failed. ret=%d", ret);
+		return ret;
 	}
+	rss_info("send onStatus(NetStream.Play.Reset) message success.");
 
 	// onStatus(NetStream.Play.Start)
-	if (true)
+	if ((ret = send_template(RssTemplatePlayStart, 0, 0, stream_id)) != ERROR_SUCCESS)
 	{
-		RssCommonMessage* msg = new RssCommonMessage();
-		RssOnStatusCallPacket* pkt = new RssOnStatusCallPacket();
-
-		pkt->data->set(StatusLevel, new RssAmf0String(StatusLevelStatus));
-		pkt->data->set(StatusCode, new RssAmf0String(StatusCodeStreamStart));
-		pkt->data->set(StatusDescription, new RssAmf0String("Started playing stream."));
-		pkt->data->set(StatusDetails, new RssAmf0String("stream"));
-		pkt->data->set(StatusClientId, new RssAmf0String(RTMP_SIG_CLIENT_ID));
-
-		msg->set_packet(pkt, stream_id);
-
-		if ((ret = protocol->send_message(msg)) != ERROR_SUCCESS)
-		{
-			rss_error("send onStatus(NetStream.Play.Reset) message failed. ret=%d", ret);
-			return ret;
-		}
-		rss_info("send onStatus(NetStream.Play.Reset) message success.");
+		rss_error("send onStatus(NetStream.Play.Start) message failed. ret=%d", ret);
+		return ret;
 	}
+	rss_info("send onStatus(NetStream.Play.Start) message success.");
 
 	// |RtmpSampleAccess(false, false)
-	if (true)
+	if ((ret = send_template(RssTemplateSampleAccess, 0, 0, stream_id)) != ERROR_SUCCESS)
 	{
-		RssCommonMessage* msg = new RssCommonMessage();
-		RssSampleAccessPacket* pkt = new RssSampleAccessPacket();
-
-		msg->set_packet(pkt, stream_id);
-
-		if ((ret = protocol->send_message(msg)) != ERROR_SUCCESS)
-		{
-			rss_error("send |RtmpSampleAccess(false, false) message failed. ret=%d", ret);
-			return ret;
-		}
-		rss_info("send |RtmpSampleAccess(false, false) message success.");
+		rss_error("send |RtmpSampleAccess(false, false) message failed. ret=%d", ret);
+		return ret;
 	}
+	rss_info("send |RtmpSampleAccess(false, false) message success.");
 
 	// onStatus(NetStream.Data.Start)
-	if (true)
+	if ((ret = send_template(RssTemplateDataStart, 0, 0, stream_id)) != ERROR_SUCCESS)
 	{
-		RssCommonMessage* msg = new RssCommonMessage();
-		RssOnStatusDataPacket* pkt = new RssOnStatusDataPacket();
-
-		pkt->data->set(StatusCode, new RssAmf0String(StatusCodeDataStart));
-
-		msg->set_packet(pkt, stream_id);
+		rss_error("send onStatus(NetStream.Data.Start) message failed. ret=%d", ret);
+		return ret;
+	}
+	rss_info("send onStatus(NetStream.Data.Start) message success.");
 
-		if ((ret = protocol->send_message(msg)) != ERROR_SUCCESS)
-		{
-			rss_error("send onStatus(NetStream.Data.Start) message failed. ret=%d", ret);
-			return ret;
-		}
-		rss_info("send onStatus(NetStream.Data.Start) message success.");
+	if ((ret = protocol->flush_batch()) != ERROR_SUCCESS)
+	{
+		rss_error("send start play response messages failed. ret=%d", ret);
+		return ret;
 	}
 
 	rss_info("start play success.");
@@ -532,20 +665,12 @@ int RssRtmp::start_publish(int stream_id)
 		fc_publish_tid = pkt->transaction_id;
 	}
 	// FCPublish response
-	if (true)
+	if ((ret = send_template(RssTemplateFMLEStart, fc_publish_tid, 0, 0)) != ERROR_SUCCESS)
 	{
-		RssCommonMessage* msg = new RssCommonMessage();
-		RssFMLEStartResPacket* pkt = new RssFMLEStartResPacket(fc_publish_tid);
-
-		msg->set_packet(pkt, 0);
-
-		if ((ret = protocol->send_message(msg)) != ERROR_SUCCESS)
-		{
-			rss_error("send FCPublish response message failed. ret=%d", ret);
-			return ret;
-		}
-		rss_info("send FCPublish response message success.");
+		rss_error("send FCPublish response message failed. ret=%d", ret);
+		return ret;
 	}
+	rss_info("send FCPublish response message success.");
 
 	// createStream
 	double create_stream_tid = 0;
@@ -564,20 +689,12 @@ int RssRtmp::start_publish(int stream_id)
 		create_stream_tid = pkt->transaction_id;
 	}
 	// createStream response
-	if (true)
+	if ((ret = send_template(RssTemplateCreateStream, create_stream_tid, stream_id, 0)) != ERROR_SUCCESS)
 	{
-		RssCommonMessage* msg = new RssCommonMessage();
-		RssCreateStreamResPacket* pkt = new RssCreateStreamResPacket(create_stream_tid, stream_id);
-
-		msg->set_packet(pkt, 0);
-
-		if ((ret = protocol->send_message(msg)) != ERROR_SUCCESS)
-		{
-			rss_error("send createStream response message failed. ret=%d", ret);
-			return ret;
-		}
-		rss_info("send createStream response message success.");
+		rss_error("send createStream response message failed. ret=%d", ret);
+		return ret;
 	}
+	rss_info("send createStream response message success.");
 
 	// publish
 	if (true)
@@ -593,44 +710,28 @@ int RssRtmp::start_publish(int stream_id)
 
 		RssAutoFree(RssCommonMessage, msg, false);
 	}
+	// sendout the publish responses in one write.
+	protocol->start_batch();
+
 	// publish response onFCPublish(NetStream.Publish.Start)
-	if (true)
+	if ((ret = send_template(RssTemplateFCPublish, 0, 0, stream_id)) != ERROR_SUCCESS)
 	{
-		RssCommonMessage* msg = new RssCommonMessage();
-		RssOnStatusCallPacket* pkt = new RssOnStatusCallPacket();
-
-		pkt->command_name = RTMP_AMF0_COMMAND_ON_FC_PUBLISH;
-		pkt->data->set(StatusCode, new RssAmf0String(StatusCodePublishStart));
-		pkt->data->set(StatusDescription, new RssAmf0String("Started publishing stream."));
-
-		msg->set_packet(pkt, stream_id);
-
-		if ((ret = protocol->send_message(msg)) != ERROR_SUCCESS)
-		{
-			rss_error("send onFCPublish(NetStream.Publish.Start) message failed. ret=%d", ret);
-			return ret;
-		}
-		rss_info("send onFCPublish(NetStream.Publish.Start) message success.");
+		rss_error("send onFCPublish(NetStream.Publish.Start) message failed. ret=%d", ret);
+		return ret;
 	}
+	rss_info("send onFCPublish(NetStream.Publish.Start) message success.");
 	// publish response onStatus(NetStream.Publish.Start)
-	if (true)
+	if ((ret = send_template(RssTemplatePublishStart, 0, 0, stream_id)) != ERROR_SUCCESS)
 	{
-		RssCommonMessage* msg = new RssCommonMessage();
-		RssOnStatusCallPacket* pkt = new RssOnStatusCallPacket();
-
-		pkt->data->set(StatusLevel, new RssAmf0String(StatusLevelStatus));
-		pkt->data->set(StatusCode, new RssAmf0String(StatusCodePublishStart));
-		pkt->data->set(StatusDescription, new RssAmf0String("Started publishing stream."));
-		pkt->data->set(StatusClientId, new RssAmf0String(RTMP_SIG_CLIENT_ID));
-
-		msg->set_packet(pkt, stream_id);
+		rss_error("send onStatus(NetStream.Publish.Start) message failed. ret=%d", ret);
+		return ret;
+	}
+	rss_info("send onStatus(NetStream.Publish.Start) message success.");
 
-		if ((ret = protocol->send_message(msg)) != ERROR_SUCCESS)
-		{
-			rss_error("send onStatus(NetStream.Publish.Start) message failed. ret=%d", ret);
-			return ret;
-		}
-		rss_info("send onStatus(NetStream.Publish.Start) message success.");
+	if ((ret = protocol->flush_batch()) != ERROR_SUCCESS)
+	{
+		rss_error("send start publish response messages failed. ret=%d", ret);
+		return ret;
 	}
 
 	return ret;
@@ -640,59 +741,35 @@ int RssRtmp::fmle_unpublish(int stream_id, double unpublish_tid)
 {
 	int ret = ERROR_SUCCESS;
 
+	// sendout the unpublish responses in one write.
+	protocol->start_batch();
+
 	// publish response onFCUnpublish(NetStream.unpublish.Success)
-	if (true)
+	if ((ret = send_template(RssTemplateFCUnpublish, 0, 0, stream_id)) != ERROR_SUCCESS)
 	{
-		RssCommonMessage* msg = new RssCommonMessage();
-		RssOnStatusCallPacket* pkt = new RssOnStatusCallPacket();
-
-		pkt->command_name = RTMP_AMF0_COMMAND_ON_FC_UNPUBLISH;
-		pkt->data->set(StatusCode, new RssAmf0String(StatusCodeUnpublishSuccess));
-		pkt->data->set(StatusDescription, new RssAmf0String("Stop publishing stream."));
-
-		msg->set_packet(pkt, stream_id);
-
-		if ((ret = protocol->send_message(msg)) != ERROR_SUCCESS)
-		{
-			rss_error("send onFCUnpublish(NetStream.unpublish.Success) message failed. ret=%d", ret);
-			return ret;
-		}
-		rss_info("send onFCUnpublish(NetStream.unpublish.Success) message success.");
+		rss_error("send onFCUnpublish(NetStream.unpublish.Success) message failed. ret=%d", ret);
+		return ret;
 	}
+	rss_info("send onFCUnpublish(NetStream.unpublish.Success) message success.");
 	// FCUnpublish response
-	if (true)
+	if ((ret = send_template(RssTemplateFMLEStart, unpublish_tid, 0, stream_id)) != ERROR_SUCCESS)
 	{
-		RssCommonMessage* msg = new RssCommonMessage();
-		RssFMLEStartResPacket* pkt = new RssFMLEStartResPacket(unpublish_tid);
-
-		msg->set_packet(pkt, stream_id);
-
-		if ((ret = protocol->send_message(msg)) != ERROR_SUCCESS)
-		{
-			rss_error("send FCUnpublish response message failed. ret=%d", ret);
-			return ret;
-		}
-		rss_info("send FCUnpublish response message success.");
+		rss_error("send FCUnpublish response message failed. ret=%d", ret);
+		return ret;
 	}
+	rss_info("send FCUnpublish response message success.");
 	// publish response onStatus(NetStream.Unpublish.Success)
-	if (true)
+	if ((ret = send_template(RssTemplateUnpublish, 0, 0, stream_id)) != ERROR_SUCCESS)
 	{
-		RssCommonMessage* msg = new RssCommonMessage();
-		RssOnStatusCallPacket* pkt = new RssOnStatusCallPacket();
-
-		pkt->data->set(StatusLevel, new RssAmf0String(StatusLevelStatus));
-		pkt->data->set(StatusCode, new RssAmf0String(StatusCodeUnpublishSuccess));
-		pkt->data->set(StatusDescription, new RssAmf0String("Stream is now unpublished"));
-		pkt->data->set(StatusClientId, new RssAmf0String(RTMP_SIG_CLIENT_ID));
-
-		msg->set_packet(pkt, stream_id);
+		rss_error("send onStatus(NetStream.Unpublish.Success) message failed. ret=%d", ret);
+		return ret;
+	}
+	rss_info("send onStatus(NetStream.Unpublish.Success) message success.");
 
-		if ((ret = protocol->send_message(msg)) != ERROR_SUCCESS)
-		{
-			rss_error("send onStatus(NetStream.Unpublish.Success) message failed. ret=%d", ret);
-			return ret;
-		}
-		rss_info("send onStatus(NetStream.Unpublish.Success) message success.");
+	if ((ret = protocol->flush_batch()) != ERROR_SUCCESS)
+	{
+		rss_error("send FMLE unpublish response messages failed. ret=%d", ret);
+		return ret;
 	}
 
 	rss_info("FMLE unpublish success.");
@@ -700,24 +777,39 @@ int RssRtmp::fmle_unpublish(int stream_id, double unpublish_tid)
 	return ret;
 }
 
-int RssRtmp::identify_create_stream_client(RssCreateStreamPacket* req, int stream_id, RssClientType& type, std::string& stream_name)
+int RssRtmp::send_template(RssRtmpTemplate type, double transaction_id, double stream_id, int message_stream_id)
 {
 	int ret = ERROR_SUCCESS;
 
-	if (true)
+	// build the templates when not initialized at startup.
+	if (!rtmp_templates[type] && (ret = initialize_templates()) != ERROR_SUCCESS)
 	{
-		RssCommonMessage* msg = new RssCommonMessage();
-		RssCreateStreamResPacket* pkt = new RssCreateStreamResPacket(req->transaction_id, stream_id);
+		return ret;
+	}
 
-		msg->set_packet(pkt, 0);
+	RssCommonMessage* msg = new RssCommonMessage();
+	RssTemplatePacket* pkt = new RssTemplatePacket(rtmp_templates[type]);
 
-		if ((ret = protocol->send_message(msg)) != ERROR_SUCCESS)
-		{
-			rss_error("send createStream response message failed. ret=%d", ret);
-			return ret;
-		}
-		rss_info("send createStream response message success.");
+	pkt->transaction_id = transaction_id;
+	pkt->stream_id = stream_id;
+	pkt->client_id = client_id;
+
+	msg->set_packet(pkt, message_stream_id);
+
+	return protocol->send_message(msg);
+}
+
+int RssRtmp::identify_create_stream_client(RssCreateStreamPacket* req, int stream_id, RssClientType& type, std::string& stream_name)
+{
+	int ret = ERROR_SUCCESS;
+
+	// createStream response
+	if ((ret = send_template(RssTemplateCreateStream, req->transaction_id, stream_id, 0)) != ERROR_SUCCESS)
+	{
+		rss_error("send createStream response message failed. ret=%d", ret);
+		return ret;
 	}
+	rss_info("send createStream response message success.");
 
 	while (true)
 	{
@@ -767,20 +859,481 @@ int RssRtmp::identify_fmle_publish_client(RssFMLEStartPacket* req, RssClientType
 	stream_name = req->stream_name;
 
 	// releaseStream response
+	if ((ret = send_template(RssTemplateFMLEStart, req->transaction_id, 0, 0)) != ERROR_SUCCESS)
+	{
+		rss_error("send releaseStream response message failed. ret=%d", ret);
+		return ret;
+	}
+	rss_info("send releaseStream response message success.");
+
+	return ret;
+}
+
+RssRtmpClient::RssRtmpClient(st_netfd_t server_stfd)
+{
+	protocol = new RssProtocol(server_stfd);
+	stfd = server_stfd;
+	transaction_id = 0;
+}
+
+RssRtmpClient::~RssRtmpClient()
+{
+	rss_freep(protocol);
+}
+
+void RssRtmpClient::set_recv_timeout(int timeout_ms)
+{
+	return protocol->set_recv_timeout(timeout_ms);
+}
+
+void RssRtmpClient::set_send_timeout(int timeout_ms)
+{
+	return protocol->set_send_timeout(timeout_ms);
+}
+
+int64_t RssRtmpClient::get_recv_bytes()
+{
+	return protocol->get_recv_bytes();
+}
+
+int64_t RssRtmpClient::get_send_bytes()
+{
+	return protocol->get_send_bytes();
+}
+
+int RssRtmpClient::recv_message(RssCommonMessage** pmsg)
+{
+	return protocol->recv_message(pmsg);
+}
+
+int RssRtmpClient::send_message(IRssMessage* msg)
+{
+	return protocol->send_message(msg);
+}
+
+int RssRtmpClient::handshake()
+{
+	int ret = ERROR_SUCCESS;
+
+	ssize_t nsize;
+	RssSocket skt(stfd);
+
+	char* c0c1 = new char[1537];
+	RssAutoFree(char, c0c1, true);
+	memset(c0c1, 0, 1537);
+	// plain text required.
+	c0c1[0] = 0x03;
+	if ((ret = skt.write(c0c1, 1537, &nsize)) != ERROR_SUCCESS)
+	{
+		rss_warn("send c0c1 failed. ret=%d", ret);
+		return ret;
+	}
+	rss_verbose("send c0c1 success.");
+
+	char* s0s1s2 = new char[3073];
+	RssAutoFree(char, s0s1s2, true);
+	if ((ret = skt.read_fully(s0s1s2, 3073, &nsize)) != ERROR_SUCCESS)
+	{
+		rss_warn("read s0s1s2 failed. ret=%d", ret);
+		return ret;
+	}
+	rss_verbose("read s0s1s2 success.");
+
+	if (s0s1s2[0] != 0x03)
+	{
+		ret = ERROR_RTMP_PLAIN_REQUIRED;
+		rss_warn("only support rtmp plain text. ret=%d", ret);
+		return ret;
+	}
+
+	// the c2 is the echo of s1.
+	if ((ret = skt.write(s0s1s2 + 1, 1536, &nsize)) != ERROR_SUCCESS)
+	{
+		rss_warn("send c2 failed. ret=%d", ret);
+		return ret;
+	}
+	rss_verbose("send c2 success.");
+
+	rss_info("client handshake success.");
+
+	return ret;
+}
+
+int RssRtmpClient::connect_app(const std::string& tc_url)
+{
+	int ret = ERROR_SUCCESS;
+
+	// the transaction id of connect must be 1.
+	transaction_id = 1;
+
+	RssCommonMessage* msg = new RssCommonMessage();
+	RssConnectAppPacket* pkt = new RssConnectAppPacket();
+
+	pkt->transaction_id = transaction_id;
+	pkt->tcUrl = tc_url;
+	msg->set_packet(pkt, 0);
+
+	if ((ret = protocol->send_message(msg)) != ERROR_SUCCESS)
+	{
+		rss_error("send connect app message failed. ret=%d", ret);
+		return ret;
+	}
+	rss_info("send connect app message success. tcUrl=%s", tc_url.c_str());
+
+	double value = 0;
+	if ((ret = expect_result(transaction_id, value)) != ERROR_SUCCESS)
+	{
+		rss_error("expect connect app response failed. ret=%d", ret);
+		return ret;
+	}
+	rss_info("connect app success.");
+
+	return ret;
+}
+
+int RssRtmpClient::set_chunk_size(int chunk_size)
+{
+	int ret = ERROR_SUCCESS;
+
+	if ((ret = protocol->send_set_chunk_size(chunk_size)) != ERROR_SUCCESS)
+	{
+		rss_error("send set chunk size message failed. ret=%d", ret);
+		return ret;
+	}
+	rss_info("send set chunk size message success. chunk_size=%d", chunk_size);
+
+	return ret;
+}
+
+int RssRtmpClient::create_stream(int& stream_id)
+{
+	int ret = ERROR_SUCCESS;
+
+	RssCommonMessage* msg = new RssCommonMessage();
+	RssCreateStreamPacket* pkt = new RssCreateStreamPacket();
+
+	double tid = pkt->transaction_id = ++transaction_id;
+	msg->set_packet(pkt, 0);
+
+	if ((ret = protocol->send_message(msg)) != ERROR_SUCCESS)
+	{
+		rss_error("send createStream message failed. ret=%d", ret);
+		return ret;
+	}
+	rss_info("send createStream message success.");
+
+	double value = 0;
+	if ((ret = expect_result(tid, value)) != ERROR_SUCCESS)
+	{
+		rss_error("expect createStream response failed. ret=%d", ret);
+		return ret;
+	}
+	stream_id = (int)value;
+	rss_info("createStream success. stream_id=%d", stream_id);
+
+	return ret;
+}
+
+int RssRtmpClient::play(const std::string& stream, int stream_id)
+{
+	int ret = ERROR_SUCCESS;
+
+	RssCommonMessage* msg = new RssCommonMessage();
+	RssPlayPacket* pkt = new RssPlayPacket();
+
+	pkt->transaction_id = ++transaction_id;
+	pkt->stream_name = stream;
+	msg->set_packet(pkt, stream_id);
+
+	if ((ret = protocol->send_message(msg)) != ERROR_SUCCESS)
+	{
+		rss_error("send play message failed. ret=%d", ret);
+		return ret;
+	}
+	rss_info("send play message success. stream=%s", stream.c_str());
+
+	if ((ret = expect_status(StatusCodeStreamStart)) != ERROR_SUCCESS)
+	{
+		rss_error("expect onStatus(NetStream.Play.Start) failed. ret=%d", ret);
+		return ret;
+	}
+	rss_info("play stream success. stream=%s", stream.c_str());
+
+	return ret;
+}
+
+int RssRtmpClient::fmle_publish(const std::string& stream, int& stream_id)
+{
+	int ret = ERROR_SUCCESS;
+
+	// releaseStream
 	if (true)
 	{
 		RssCommonMessage* msg = new RssCommonMessage();
-		RssFMLEStartResPacket* pkt = new RssFMLEStartResPacket(req->transaction_id);
+		RssFMLEStartPacket* pkt = new RssFMLEStartPacket();
 
+		pkt->command_name = RTMP_AMF0_COMMAND_RELEASE_STREAM;
+		double tid = pkt->transaction_id = ++transaction_id;
+		pkt->stream_name = stream;
 		msg->set_packet(pkt, 0);
 
 		if ((ret = protocol->send_message(msg)) != ERROR_SUCCESS)
 		{
-			rss_error("send releaseStream response message failed. ret=%d", ret);
+			rss_error("send releaseStream message failed. ret=%d", ret);
+			return ret;
+		}
+
+		double value = 0;
+		if ((ret = expect_result(tid, value)) != ERROR_SUCCESS)
+		{
+			rss_error("expect releaseStream response failed. ret=%d", ret);
+			return ret;
+		}
+		rss_info("releaseStream success.");
+	}
+
+	// FCPublish
+	if (true)
+	{
+		RssCommonMessage* msg = new RssCommonMessage();
+		RssFMLEStartPacket* pkt = new RssFMLEStartPacket();
+
+		pkt->command_name = RTMP_AMF0_COMMAND_FC_PUBLISH;
+		double tid = pkt->transaction_id = ++transaction_id;
+		pkt->stream_name = stream;
+		msg->set_packet(pkt, 0);
+
+		if ((ret = protocol->send_message(msg)) != ERROR_SUCCESS)
+		{
+			rss_error("send FCPublish message failed. ret=%d", ret);
+			return ret;
+		}
+
+		double value = 0;
+		if ((ret = expect_result(tid, value)) != ERROR_SUCCESS)
+		{
+			rss_error("expect FCPublish response failed. ret=%d", ret);
+			return ret;
+		}
+		rss_info("FCPublish success.");
+	}
+
+	// createStream
+	if ((ret = create_stream(stream_id)) != ERROR_SUCCESS)
+	{
+		return ret;
+	}
+
+	// publish
+	if (true)
+	{
+		RssCommonMessage* msg = new RssCommonMessage();
+		RssPublishPacket* pkt = new RssPublishPacket();
+
+		pkt->transaction_id = ++transaction_id;
+		pkt->stream_name = stream;
+		msg->set_packet(pkt, stream_id);
+
+		if ((ret = protocol->send_message(msg)) != ERROR_SUCCESS)
+		{
+			rss_error("send publish message failed. ret=%d", ret);
+			return ret;
+		}
+
+		if ((ret = expect_status(StatusCodePublishStart)) != ERROR_SUCCESS)
+		{
+			rss_error("expect onStatus(NetStream.Publish.Start) failed. ret=%d", ret);
 			return ret;
 		}
-		rss_info("send releaseStream response message success.");
 	}
+	rss_info("publish stream success. stream=%s, stream_id=%d", stream.c_str(), stream_id);
 
 	return ret;
-}
\ No newline at end of file
+}
+
+int RssRtmpClient::expect_result(double tid, double& value)
+{
+	int ret = ERROR_SUCCESS;
+
+	while (true)
+	{
+		RssCommonMessage* msg = NULL;
+		if ((ret = protocol->recv_message(&msg)) != ERROR_SUCCESS)
+		{
+			rss_error("recv response message failed. ret=%d", ret);
+			return ret;
+		}
+		RssAutoFree(RssCommonMessage, msg, false);
+
+		if (!msg->header.is_amf0_command() || msg->size <= 0)
+		{
+			continue;
+		}
+
+		RssStream stream;
+		if ((ret = stream.initialize((char*)msg->payload, msg->size)) != ERROR_SUCCESS)
+		{
+			return ret;
+		}
+		RssAmf0Reader reader(&stream);
+
+		// command name and transaction id.
+		if ((ret = reader.next()) != ERROR_SUCCESS || reader.event != RssAmf0EventString)
+		{
+			ret = (ret == ERROR_SUCCESS)? ERROR_RTMP_AMF0_DECODE : ret;
+			rss_error("amf0 decode response command_name failed. ret=%d", ret);
+			return ret;
+		}
+		bool is_error = reader.str.equals(RTMP_AMF0_COMMAND_ERROR);
+		if (!is_error && !reader.str.equals(RTMP_AMF0_COMMAND_RESULT))
+		{
+			rss_verbose("ignore command %s", reader.str.to_str().c_str());
+			continue;
+		}
+
+		if ((ret = reader.next()) != ERROR_SUCCESS || reader.event != RssAmf0EventNumber)
+		{
+			ret = (ret == ERROR_SUCCESS)? ERROR_RTMP_AMF0_DECODE : ret;
+			rss_error("amf0 decode response transaction_id failed. ret=%d", ret);
+			return ret;
+		}
+		if (reader.number != tid)
+		{
+			rss_verbose("ignore response of transaction %.1f, expect %.1f", reader.number, tid);
+			continue;
+		}
+
+		if (is_error)
+		{
+			ret = ERROR_RTMP_RESPONSE;
+			rss_error("server response error of transaction %.1f. ret=%d", tid, ret);
+			return ret;
+		}
+
+		// the command object, null or object.
+		if ((ret = reader.next()) != ERROR_SUCCESS || (ret = reader.skip()) != ERROR_SUCCESS)
+		{
+			rss_error("amf0 decode response command_object failed. ret=%d", ret);
+			return ret;
+		}
+
+		// the optional value, for instance, the stream id of createStream.
+		if ((ret = reader.next()) != ERROR_SUCCESS)
+		{
+			rss_error("amf0 decode response value failed. ret=%d", ret);
+			return ret;
+		}
+		if (reader.event == RssAmf0EventNumber)
+		{
+			value = reader.number;
+		}
+
+		return ret;
+	}
+
+	return ret;
+}
+
+int RssRtmpClient::expect_status(const char* code)
+{
+	int ret = ERROR_SUCCESS;
+
+	while (true)
+	{
+		RssCommonMessage* msg = NULL;
+		if ((ret = protocol->recv_message(&msg)) != ERROR_SUCCESS)
+		{
+			rss_error("recv onStatus message failed. ret=%d", ret);
+			return ret;
+		}
+		RssAutoFree(RssCommonMessage, msg, false);
+
+		if (!msg->header.is_amf0_command() || msg->size <= 0)
+		{
+			continue;
+		}
+
+		RssStream stream;
+		if ((ret = stream.initialize((char*)msg->payload, msg->size)) != ERROR_SUCCESS)
+		{
+			return ret;
+		}
+		RssAmf0Reader reader(&stream);
+
+		if ((ret = reader.next()) != ERROR_SUCCESS || reader.event != RssAmf0EventString)
+		{
+			ret = (ret == ERROR_SUCCESS)? ERROR_RTMP_AMF0_DECODE : ret;
+			rss_error("amf0 decode onStatus command_name failed. ret=%d", ret);
+			return ret;
+		}
+		if (!reader.str.equals(RTMP_AMF0_COMMAND_ON_STATUS))
+		{
+			rss_verbose("ignore command %s", reader.str.to_str().c_str());
+			continue;
+		}
+
+		// the transaction id, null args, then the info object.
+		if ((ret = reader.next()) != ERROR_SUCCESS || (ret = reader.next()) != ERROR_SUCCESS
+			|| (ret = reader.next()) != ERROR_SUCCESS || reader.event != RssAmf0EventBeginObject)
+		{
+			ret = (ret == ERROR_SUCCESS)? ERROR_RTMP_AMF0_DECODE : ret;
+			rss_error("amf0 decode onStatus info failed. ret=%d", ret);
+			return ret;
+		}
+
+		// read the level and code of info.
+		std::string level, status_code;
+		while (true)
+		{
+			if ((ret = reader.next()) != ERROR_SUCCESS)
+			{
+				rss_error("amf0 decode onStatus info property failed. ret=%d", ret);
+				return ret;
+			}
+			if (reader.event == RssAmf0EventEnd)
+			{
+				break;
+			}
+
+			std::string* str = NULL;
+			if (reader.str.equals(StatusLevel))
+			{
+				str = &level;
+			}
+			else if (reader.str.equals(StatusCode))
+			{
+				str = &status_code;
+			}
+
+			if ((ret = reader.next()) != ERROR_SUCCESS)
+			{
+				rss_error("amf0 decode onStatus info value failed. ret=%d", ret);
+				return ret;
+			}
+
+			if (str && reader.event == RssAmf0EventString)
+			{
+				*str = reader.str.to_str();
+			}
+			else if ((ret = reader.skip()) != ERROR_SUCCESS)
+			{
+				rss_error("amf0 decode onStatus info skip value failed. ret=%d", ret);
+				return ret;
+			}
+		}
+
+		if (level == StatusLevelError)
+		{
+			ret = ERROR_RTMP_RESPONSE;
+			rss_error("server response onStatus error, code=%s. ret=%d", status_code.c_str(), ret);
+			return ret;
+		}
+		if (status_code == code)
+		{
+			return ret;
+		}
+		rss_verbose("ignore onStatus %s, expect %s", status_code.c_str(), code);
+	}
+
+	return ret;
+}
@@ -2,15 +2,30 @@
 
 #include <sys/types.h>
 #include <sys/socket.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
 #include <arpa/inet.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <signal.h>
+#include <stdlib.h>
+#include <unistd.h>
 
 #include <algorithm>
+#include <vector>
 
 #include <st.h>
 
 #include <rss_core_log.hpp>
 #include <rss_core_error.hpp>
 #include <rss_core_client.hpp>
+#include <rss_core_rtmp.hpp>
+#include <rss_core_clock.hpp>
+#include <rss_core_trace.hpp>
+#include <rss_core_stat.hpp>
+#include <rss_core_source.hpp>
+#include <rss_core_api.hpp>
+#include <rss_core_shm_stat.hpp>
 
 #define SERVER_LISTEN_BACKLOG 10
 
@@ -18,9 +33,38 @@
 // it will be changed when clients increase.
 #define RSS_CONST_REPORT_INTERVAL_MS 3000
 
+// when hot upgrade, the timeout to wait for the new binary to get ready.
+#define RSS_UPGRADE_READY_TIMEOUT_MS 10000
+// when hot upgrade failed, the grace period for the new binary to quit by SIGTERM.
+#define RSS_UPGRADE_KILL_GRACE_MS 3000
+// when draining, the interval to check whether all conns closed.
+#define RSS_DRAIN_CHECK_INTERVAL_MS 100
+// when draining, the max time to wait for the conns, the long-lived players
+// never pin the old binary, they reconnect to the new binary.
+#define RSS_DRAIN_MAX_MS (600 * 1000)
+
+// the write fd of signal pipe, the signal handler write signo to it.
+static int rss_signal_pipe_write_fd = -1;
+
 RssServer::RssServer()
 {
+	fd = -1;
+	stfd = NULL;
+	listen_tid = NULL;
 	rss_report_interval_ms = RSS_CONST_REPORT_INTERVAL_MS;
+
+	signal_pipe[0] = signal_pipe[1] = -1;
+	signal_stfd = NULL;
+	draining = false;
+	drain_start_time = 0;
+
+	api_fd = -1;
+	api_stfd = NULL;
+	api_tid = NULL;
+	start_time = RssClock::time_ms();
+	nb_accepted = 0;
+	closed_recv_bytes = closed_send_bytes = 0;
+	shm_update_time = shm_cpu_us = 0;
 }
 
 RssServer::~RssServer()
@@ -31,6 +75,31 @@ RssServer::~RssServer()
 		rss_freep(conn);
 	}
 	conns.clear();
+
+	for (std::vector<RssConnection*>::iterator it = api_conns.begin(); it != api_conns.end(); ++it)
+	{
+		RssConnection* conn = *it;
+		rss_freep(conn);
+	}
+	api_conns.clear();
+
+	if (api_stfd)
+	{
+		st_netfd_close(api_stfd);
+		api_stfd = NULL;
+	}
+
+	if (signal_stfd)
+	{
+		st_netfd_close(signal_stfd);
+		signal_stfd = NULL;
+	}
+	if (signal_pipe[1] != -1)
+	{
+		rss_signal_pipe_write_fd = -1;
+		::close(signal_pipe[1]);
+		signal_pipe[1] = -1;
+	}
 }
 
 int RssServer::initialize()
@@ -46,6 +115,21 @@ int RssServer::initialize()
 	}
 	rss_verbose("st_set_eventsys use linux epoll success");
 
+	// resolve before the binary is replaced, the link is "path (deleted)" after.
+	if (true)
+	{
+		char path[PATH_MAX];
+		ssize_t nb_path = readlink("/proc/self/exe", path, sizeof(path) - 1);
+		if (nb_path <= 0)
+		{
+			ret = ERROR_SYSTEM_UPGRADE;
+			rss_error("resolve the path of binary failed. ret=%d", ret);
+			return ret;
+		}
+		binary.assign(path, nb_path);
+	}
+	rss_trace("resolve the path of binary %s", binary.c_str());
+
 	if(st_init() != 0)
 	{
 		ret = ERROR_ST_INITIALIZE;
@@ -54,10 +138,41 @@ int RssServer::initialize()
 	}
 	rss_verbose("st_init success");
 
+	// the coarse clock for logs and reports.
+	if ((ret = RssClock::start()) != ERROR_SUCCESS)
+	{
+		return ret;
+	}
+	rss_verbose("start clock success");
+
+	if ((ret = open_signal_pipe()) != ERROR_SUCCESS)
+	{
+		return ret;
+	}
+	rss_verbose("open signal pipe success");
+
+	// build the command responses once, patch for each connection.
+	if ((ret = RssRtmp::initialize_templates()) != ERROR_SUCCESS)
+	{
+		return ret;
+	}
+	rss_verbose("initialize rtmp templates success");
+
 	// set current log id.
 	log_context->generate_id();
 	rss_info("log set id success");
 
+	if ((ret = rss_log_reload(RSS_LOG_LEVEL_FILE)) != ERROR_SUCCESS)
+	{
+		return ret;
+	}
+
+	// the binary event trace, opt-in by env.
+	if ((ret = rss_trace_initialize()) != ERROR_SUCCESS)
+	{
+		return ret;
+	}
+
 	return ret;
 }
 
@@ -65,70 +180,241 @@ int RssServer::listen(int port)
 {
 	int ret = ERROR_SUCCESS;
 
-	if ((fd = socket(AF_INET, SOCK_STREAM, 0)) == -1)
+	// started by hot upgrade, inherit the listen fd from the old binary.
+	int unix_fd = -1;
+	if (getenv(RSS_UPGRADE_FD_ENV))
+	{
+		unix_fd = ::atoi(getenv(RSS_UPGRADE_FD_ENV));
+		// never pass to the binary of next upgrade.
+		unsetenv(RSS_UPGRADE_FD_ENV);
+
+		if ((ret = inherit_listen_fd(unix_fd)) != ERROR_SUCCESS)
+		{
+			::close(unix_fd);
+			return ret;
+		}
+		rss_trace("inherit listen fd from old binary success. fd=%d", fd);
+	}
+	else if ((ret = create_listen_fd(port, false, fd)) != ERROR_SUCCESS)
+	{
+		return ret;
+	}
+
+	if ((stfd = st_netfd_open_socket(fd)) == NULL)
+	{
+		ret = ERROR_ST_OPEN_SOCKET;
+		rss_error("st_netfd_open_socket open socket failed. ret=%d", ret);
+		return ret;
+	}
+	rss_verbose("st open socket success. fd=%d", fd);
+
+	if ((listen_tid = st_thread_create(listen_thread, this, 0, 0)) == NULL)
+	{
+		ret = ERROR_ST_CREATE_LISTEN_THREAD;
+		rss_error("st_thread_create listen thread error. ret=%d", ret);
+		return ret;
+	}
+	rss_verbose("create st listen thread success.");
+
+	// notify the old binary to stop accepting.
+	if (unix_fd != -1)
+	{
+		char ready = 1;
+		if (::write(unix_fd, &ready, 1) != 1)
+		{
+			rss_warn("ignore notify old binary ready failed.");
+		}
+		::close(unix_fd);
+		rss_trace("notify old binary to drain success.");
+	}
+
+	rss_trace("server started, listen at port=%d, fd=%d", port, fd);
+
+	// the shm stat for the external monitor, named by the listen port.
+	if ((ret = RssShmStat::initialize(port)) != ERROR_SUCCESS)
+	{
+		return ret;
+	}
+
+	return ret;
+}
+
+int RssServer::listen_api(int port)
+{
+	int ret = ERROR_SUCCESS;
+
+	// the new binary of hot upgrade listen the api port with the old binary.
+	if ((ret = create_listen_fd(port, true, api_fd)) != ERROR_SUCCESS)
+	{
+		return ret;
+	}
+
+	if ((api_stfd = st_netfd_open_socket(api_fd)) == NULL)
+	{
+		ret = ERROR_ST_OPEN_SOCKET;
+		rss_error("st_netfd_open_socket open api socket failed. ret=%d", ret);
+		return ret;
+	}
+	rss_verbose("st open api socket success. fd=%d", api_fd);
+
+	if ((api_tid = st_thread_create(api_thread, this, 0, 0)) == NULL)
+	{
+		ret = ERROR_ST_CREATE_API_THREAD;
+		rss_error("st_thread_create api thread error. ret=%d", ret);
+		return ret;
+	}
+	rss_verbose("create st api thread success.");
+
+	rss_trace("http api started, listen at port=%d, fd=%d", port, api_fd);
+
+	return ret;
+}
+
+int RssServer::create_listen_fd(int port, bool reuse_port, int& listen_fd)
+{
+	int ret = ERROR_SUCCESS;
+
+	if ((listen_fd = socket(AF_INET, SOCK_STREAM, 0)) == -1)
 	{
 		ret = ERROR_SOCKET_CREATE;
 		rss_error("create linux socket error. ret=%d", ret);
 		return ret;
 	}
-	rss_verbose("create linux socket success. fd=%d", fd);
+	rss_verbose("create linux socket success. fd=%d", listen_fd);
 
 	int reuse_socket = 1;
-	if (setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &reuse_socket, sizeof(int)) == -1)
+	if (setsockopt(listen_fd, SOL_SOCKET, SO_REUSEADDR, &reuse_socket, sizeof(int)) == -1)
 	{
 		ret = ERROR_SOCKET_SETREUSE;
 		rss_error("setsockopt reuse-addr error. ret=%d", ret);
 		return ret;
 	}
-	rss_verbose("setsockopt reuse-addr success. fd=%d", fd);
+	rss_verbose("setsockopt reuse-addr success. fd=%d", listen_fd);
+
+	if (reuse_port && setsockopt(listen_fd, SOL_SOCKET, SO_REUSEPORT, &reuse_socket, sizeof(int)) == -1)
+	{
+		ret = ERROR_SOCKET_SETREUSE;
+		rss_error("setsockopt reuse-port error. ret=%d", ret);
+		return ret;
+	}
 
 	sockaddr_in addr;
 	addr.sin_family = AF_INET;
 	addr.sin_port = htons(port);
 	addr.sin_addr.s_addr = INADDR_ANY;
-	if (bind(fd, (const sockaddr*)&addr, sizeof(sockaddr_in)) == -1)
+	if (bind(listen_fd, (const sockaddr*)&addr, sizeof(sockaddr_in)) == -1)
 	{
 		ret = ERROR_SOCKET_BIND;
 		rss_error("bind socket error. ret=%d", ret);
 		return ret;
 	}
-	rss_verbose("bind socket success. fd=%d", fd);
+	rss_verbose("bind socket success. fd=%d", listen_fd);
 
-	if (::listen(fd, SERVER_LISTEN_BACKLOG) == -1)
+	if (::listen(listen_fd, SERVER_LISTEN_BACKLOG) == -1)
 	{
 		ret = ERROR_SOCKET_LISTEN;
 		rss_error("listen socket error. ret=%d", ret);
 		return ret;
 	}
-	rss_verbose("listen socket success. fd=%d", fd);
+	rss_verbose("listen socket success. fd=%d", listen_fd);
 
-	if ((stfd = st_netfd_open_socket(fd)) == NULL)
-	{
-		ret = ERROR_ST_OPEN_SOCKET;
-		rss_error("st_netfd_open_socket open socket failed. ret=%d", ret);
-		return ret;
-	}
-	rss_verbose("st open socket success. fd=%d", fd);
+	return ret;
+}
+
+int RssServer::cycle()
+{
+	int ret = ERROR_SUCCESS;
 
-	if (st_thread_create(listen_thread, this, 0, 0) == NULL)
+	while (true)
 	{
-		ret = ERROR_ST_CREATE_LISTEN_THREAD;
-		rss_error("st_thread_create listen thread error. ret=%d", ret);
-		return ret;
-	}
-	rss_verbose("create st listen thread success.");
+		// when draining, wakeup to check whether all conns closed,
+		// and wakeup to update the shm stat.
+		st_utime_t timeout = ST_UTIME_NO_TIMEOUT;
+		if (draining)
+		{
+			timeout = RSS_DRAIN_CHECK_INTERVAL_MS * 1000;
+		}
+		else if (RssShmStat::get_worker())
+		{
+			timeout = RSS_SHM_STAT_INTERVAL_MS * 1000;
+		}
 
-	rss_trace("server started, listen at port=%d, fd=%d", port, fd);
+		int signo = 0;
+		if (st_read(signal_stfd, &signo, sizeof(int), timeout) == sizeof(int))
+		{
+			rss_trace("got signal %d", signo);
+		}
+
+		if (signo == SIGHUP && (ret = rss_log_reload(RSS_LOG_LEVEL_FILE)) != ERROR_SUCCESS)
+		{
+			rss_warn("ignore reload log levels failed. ret=%d", ret);
+			ret = ERROR_SUCCESS;
+		}
+
+		if (signo == SIGUSR2 && (ret = upgrade()) != ERROR_SUCCESS)
+		{
+			rss_warn("ignore hot upgrade failed, continue to serve. ret=%d", ret);
+			ret = ERROR_SUCCESS;
+		}
+
+		update_shm();
+
+		if (draining && conns.empty())
+		{
+			rss_trace("all conns drained, server quit.");
+			break;
+		}
+
+		if (draining && RssClock::time_ms() - drain_start_time > RSS_DRAIN_MAX_MS)
+		{
+			rss_warn("drain timeout in %dms, server quit with conns=%d", RSS_DRAIN_MAX_MS, (int)conns.size());
+			break;
+		}
+	}
 
 	return ret;
 }
 
-int RssServer::cycle()
+void RssServer::update_shm()
 {
-	int ret = ERROR_SUCCESS;
-	// TODO: canbe a api thread.
-	st_thread_exit(NULL);
-	return ret;
+	RssShmWorkerSlot* worker = RssShmStat::get_worker();
+	if (!worker)
+	{
+		return;
+	}
+
+	int64_t now = RssClock::time_ms();
+	if (now - shm_update_time < RSS_SHM_STAT_INTERVAL_MS)
+	{
+		return;
+	}
+
+	RssServerStat stat;
+	std::vector<RssConnStat> conn_stats;
+	this->stat(stat, conn_stats);
+
+	// the cpu usage of process, all st-threads run in it.
+	int64_t cpu_permille = 0;
+	rusage usage;
+	if (getrusage(RUSAGE_SELF, &usage) == 0)
+	{
+		int64_t cpu_us = (int64_t)(usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) * 1000000
+			+ usage.ru_utime.tv_usec + usage.ru_stime.tv_usec;
+		if (shm_update_time > 0 && now > shm_update_time)
+		{
+			cpu_permille = (cpu_us - shm_cpu_us) / (now - shm_update_time);
+		}
+		shm_cpu_us = cpu_us;
+	}
+	shm_update_time = now;
+
+	rss_shm_store(worker->conns, (int64_t)stat.nb_conns);
+	rss_shm_store(worker->accepted, stat.nb_accepted);
+	rss_shm_store(worker->recv_bytes, stat.recv_bytes);
+	rss_shm_store(worker->send_bytes, stat.send_bytes);
+	rss_shm_store(worker->cpu_permille, cpu_permille);
+	rss_shm_store(worker->sched_lag_us, RssClock::reset_max_lag());
+	rss_shm_store(worker->update_ms, now);
 }
 
 void RssServer::remove(RssConnection* conn)
@@ -142,32 +428,75 @@ void RssServer::remove(RssConnection* conn)
 
 	rss_info("conn removed. conns=%d", (int)conns.size());
 
+	// accumulate the bytes of closed conn to the totals.
+	if (true)
+	{
+		RssConnStat stat;
+		conn->stat(stat);
+		closed_recv_bytes += stat.recv_bytes;
+		closed_send_bytes += stat.send_bytes;
+	}
+
 	// all connections are created by server,
 	// so we free it here.
 	rss_freep(conn);
 }
 
-bool RssServer::can_report(int64_t& reported, int64_t time)
+void RssServer::remove_api(RssConnection* conn)
+{
+	std::vector<RssConnection*>::iterator it = std::find(api_conns.begin(), api_conns.end(), conn);
+
+	if (it != api_conns.end())
+	{
+		api_conns.erase(it);
+	}
+
+	rss_info("api conn removed. api_conns=%d", (int)api_conns.size());
+
+	rss_freep(conn);
+}
+
+bool RssServer::can_report(int64_t& reported)
 {
 	if (rss_report_interval_ms <= 0)
 	{
 		return false;
 	}
 
-	if (time - reported < rss_report_interval_ms)
+	int64_t now = RssClock::time_ms();
+	if (now - reported < rss_report_interval_ms)
 	{
 		return false;
 	}
 
-	reported = time;
+	reported = now;
 	return true;
 }
 
-int RssServer::accept_client(st_netfd_t client_stfd)
+void RssServer::stat(RssServerStat& stat, std::vector<RssConnStat>& conn_stats)
 {
-	int ret = ERROR_SUCCESS;
+	stat.uptime_ms = RssClock::time_ms() - start_time;
+	stat.nb_conns = (int)conns.size();
+	stat.nb_accepted = nb_accepted;
+	stat.recv_bytes = closed_recv_bytes;
+	stat.send_bytes = closed_send_bytes;
 
-	RssConnection* conn = new RssClient(this, client_stfd);
+	for (std::vector<RssConnection*>::iterator it = conns.begin(); it != conns.end(); ++it)
+	{
+		RssConnection* conn = *it;
+
+		RssConnStat conn_stat;
+		conn->stat(conn_stat);
+		conn_stats.push_back(conn_stat);
+
+		stat.recv_bytes += conn_stat.recv_bytes;
+		stat.send_bytes += conn_stat.send_bytes;
+	}
+}
+
+int RssServer::accept_client(RssConnection* conn)
+{
+	int ret = ERROR_SUCCESS;
 
 	// directly enqueue, the cycle thread will remove the client.
 	conns.push_back(conn);
@@ -197,6 +526,16 @@ void RssServer::listen_cycle()
 	{
 		st_netfd_t client_stfd = st_accept(stfd, NULL, NULL, ST_UTIME_NO_TIMEOUT);
 
+		// interrupted by upgrade, the new binary takes the new conns.
+		if (draining)
+		{
+			if (client_stfd)
+			{
+				st_netfd_close(client_stfd);
+			}
+			break;
+		}
+
 		if(client_stfd == NULL)
 		{
 			// ignore error.
@@ -205,7 +544,8 @@ void RssServer::listen_cycle()
 		}
 		rss_verbose("get a client. fd=%d", st_netfd_fileno(client_stfd));
 
-		if ((ret = accept_client(client_stfd)) != ERROR_SUCCESS)
+		nb_accepted++;
+		if ((ret = accept_client(new RssClient(this, client_stfd))) != ERROR_SUCCESS)
 		{
 			rss_warn("accept client error. ret=%d", ret);
 			continue;
@@ -213,6 +553,12 @@ void RssServer::listen_cycle()
 
 		rss_verbose("accept client finished. conns=%d, ret=%d", (int)conns.size(), ret);
 	}
+
+	// the listen fd is handed off, close our copy.
+	st_netfd_close(stfd);
+	stfd = NULL;
+	listen_tid = NULL;
+	rss_trace("listen cycle stopped, draining conns=%d", (int)conns.size());
 }
 
 void* RssServer::listen_thread(void* arg)
@@ -225,3 +571,337 @@ void* RssServer::listen_thread(void* arg)
 	return NULL;
 }
 
+void RssServer::api_cycle()
+{
+	int ret = ERROR_SUCCESS;
+
+	log_context->generate_id();
+	rss_trace("api cycle start.");
+
+	while (true)
+	{
+		st_netfd_t client_stfd = st_accept(api_stfd, NULL, NULL, ST_UTIME_NO_TIMEOUT);
+
+		// interrupted by upgrade, the new binary serves the api.
+		if (draining)
+		{
+			if (client_stfd)
+			{
+				st_netfd_close(client_stfd);
+			}
+			break;
+		}
+
+		if(client_stfd == NULL)
+		{
+			rss_warn("ignore api accept error");
+			continue;
+		}
+
+		// the api conns are not media conns, never in the stats and the report interval.
+		RssConnection* conn = new RssApiConnection(this, client_stfd);
+		api_conns.push_back(conn);
+
+		if ((ret = conn->start()) != ERROR_SUCCESS)
+		{
+			rss_warn("accept api client error. ret=%d", ret);
+			remove_api(conn);
+			continue;
+		}
+	}
+
+	st_netfd_close(api_stfd);
+	api_stfd = NULL;
+	api_tid = NULL;
+	rss_trace("api cycle stopped.");
+}
+
+void* RssServer::api_thread(void* arg)
+{
+	RssServer* server = (RssServer*)arg;
+	rss_assert(server != NULL);
+
+	server->api_cycle();
+
+	return NULL;
+}
+
+int RssServer::open_signal_pipe()
+{
+	int ret = ERROR_SUCCESS;
+
+	if (pipe(signal_pipe) == -1)
+	{
+		ret = ERROR_SYSTEM_SIGNAL_INIT;
+		rss_error("create signal pipe failed. ret=%d", ret);
+		return ret;
+	}
+
+	// never leak the pipe to the new binary.
+	fcntl(signal_pipe[0], F_SETFD, FD_CLOEXEC);
+	fcntl(signal_pipe[1], F_SETFD, FD_CLOEXEC);
+
+	if ((signal_stfd = st_netfd_open(signal_pipe[0])) == NULL)
+	{
+		ret = ERROR_SYSTEM_SIGNAL_INIT;
+		rss_error("st open signal pipe failed. ret=%d", ret);
+		return ret;
+	}
+
+	rss_signal_pipe_write_fd = signal_pipe[1];
+
+	struct sigaction sa;
+	memset(&sa, 0, sizeof(sa));
+	sa.sa_handler = on_signal;
+	sigemptyset(&sa.sa_mask);
+	if (sigaction(SIGUSR2, &sa, NULL) == -1 || sigaction(SIGHUP, &sa, NULL) == -1)
+	{
+		ret = ERROR_SYSTEM_SIGNAL_INIT;
+		rss_error("install signal handler failed. ret=%d", ret);
+		return ret;
+	}
+
+	return ret;
+}
+
+void RssServer::on_signal(int signo)
+{
+	// async-signal-safe, only write the signo to pipe.
+	int err = errno;
+	if (rss_signal_pipe_write_fd != -1 && ::write(rss_signal_pipe_write_fd, &signo, sizeof(int)) != sizeof(int))
+	{
+		// ignore, the signal is lost.
+	}
+	errno = err;
+}
+
+int RssServer::upgrade()
+{
+	int ret = ERROR_SUCCESS;
+
+	if (draining || stfd == NULL)
+	{
+		rss_warn("ignore hot upgrade, the listen fd is handed off.");
+		return ret;
+	}
+
+	// the args of the new binary is same to the current.
+	std::vector<char> cmdline;
+	if (true)
+	{
+		FILE* f = fopen("/proc/self/cmdline", "r");
+		if (!f)
+		{
+			ret = ERROR_SYSTEM_UPGRADE;
+			rss_error("open cmdline failed. ret=%d", ret);
+			return ret;
+		}
+
+		char buf[1024];
+		size_t nread;
+		while ((nread = fread(buf, 1, sizeof(buf), f)) > 0)
+		{
+			cmdline.insert(cmdline.end(), buf, buf + nread);
+		}
+		fclose(f);
+		cmdline.push_back(0);
+	}
+	std::vector<char*> args;
+	for (size_t i = 0; i < cmdline.size() - 1; i += strlen(&cmdline[i]) + 1)
+	{
+		args.push_back(&cmdline[i]);
+	}
+	args.push_back(NULL);
+
+	int fds[2];
+	if (socketpair(AF_UNIX, SOCK_STREAM, 0, fds) == -1)
+	{
+		ret = ERROR_SYSTEM_UPGRADE;
+		rss_error("create unix socket pair failed. ret=%d", ret);
+		return ret;
+	}
+
+	// the env of the new binary, build before fork, for the log writer thread
+	// maybe holds the malloc lock at fork, the child only calls execve and _exit.
+	char env[64];
+	snprintf(env, sizeof(env), "%s=%d", RSS_UPGRADE_FD_ENV, fds[1]);
+
+	std::vector<char*> envs;
+	for (char** p = environ; p && *p; p++)
+	{
+		if (strncmp(*p, RSS_UPGRADE_FD_ENV "=", strlen(RSS_UPGRADE_FD_ENV "=")) != 0)
+		{
+			envs.push_back(*p);
+		}
+	}
+	envs.push_back(env);
+	envs.push_back(NULL);
+
+	// the replaced file at the path resolved at startup.
+	const char* binary_path = binary.c_str();
+
+	// flush the log, the new binary append to the same file.
+	log_writer->flush();
+
+	pid_t pid = fork();
+	if (pid == -1)
+	{
+		::close(fds[0]);
+		::close(fds[1]);
+		ret = ERROR_SYSTEM_UPGRADE;
+		rss_error("fork new binary failed. ret=%d", ret);
+		return ret;
+	}
+
+	// the new binary, close all fds except stdio and the unix socket.
+	if (pid == 0)
+	{
+		rlimit limit;
+		int max_fd = 1024;
+		if (getrlimit(RLIMIT_NOFILE, &limit) == 0 && limit.rlim_cur != RLIM_INFINITY)
+		{
+			max_fd = (int)limit.rlim_cur;
+		}
+		for (int i = 3; i < max_fd; i++)
+		{
+			if (i != fds[1])
+			{
+				::close(i);
+			}
+		}
+
+		execve(binary_path, &args[0], &envs[0]);
+		_exit(-1);
+	}
+	::close(fds[1]);
+	rss_trace("fork new binary success. pid=%d", pid);
+
+	// send the listen fd over the unix socket.
+	char data = 0;
+	iovec iov;
+	iov.iov_base = &data;
+	iov.iov_len = 1;
+
+	char control[CMSG_SPACE(sizeof(int))];
+	memset(control, 0, sizeof(control));
+
+	msghdr msg;
+	memset(&msg, 0, sizeof(msg));
+	msg.msg_iov = &iov;
+	msg.msg_iovlen = 1;
+	msg.msg_control = control;
+	msg.msg_controllen = sizeof(control);
+
+	cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+	cmsg->cmsg_level = SOL_SOCKET;
+	cmsg->cmsg_type = SCM_RIGHTS;
+	cmsg->cmsg_len = CMSG_LEN(sizeof(int));
+	memcpy(CMSG_DATA(cmsg), &fd, sizeof(int));
+
+	if (sendmsg(fds[0], &msg, 0) != 1)
+	{
+		::close(fds[0]);
+		kill_new_binary(pid);
+		ret = ERROR_SYSTEM_UPGRADE;
+		rss_error("send listen fd to new binary failed. pid=%d, ret=%d", pid, ret);
+		return ret;
+	}
+	rss_trace("send listen fd to new binary success. fd=%d, pid=%d", fd, pid);
+
+	// wait for the new binary to accept, or keep serving when failed.
+	st_netfd_t unix_stfd = st_netfd_open_socket(fds[0]);
+	if (unix_stfd == NULL)
+	{
+		::close(fds[0]);
+		kill_new_binary(pid);
+		ret = ERROR_SYSTEM_UPGRADE;
+		rss_error("st open unix socket failed. ret=%d", ret);
+		return ret;
+	}
+
+	char ready = 0;
+	ssize_t nread = st_read(unix_stfd, &ready, 1, RSS_UPGRADE_READY_TIMEOUT_MS * 1000);
+	st_netfd_close(unix_stfd);
+
+	if (nread != 1 || ready != 1)
+	{
+		kill_new_binary(pid);
+		ret = ERROR_SYSTEM_UPGRADE;
+		rss_error("new binary not ready. pid=%d, ret=%d", pid, ret);
+		return ret;
+	}
+
+	// stop accepting, the listen thread will close the listen fd.
+	draining = true;
+	drain_start_time = RssClock::time_ms();
+	st_thread_interrupt(listen_tid);
+	if (api_tid)
+	{
+		st_thread_interrupt(api_tid);
+	}
+	rss_trace("hot upgrade success, new binary pid=%d, start to drain conns=%d", pid, (int)conns.size());
+
+	return ret;
+}
+
+void RssServer::kill_new_binary(pid_t pid)
+{
+	// the new binary maybe got the listen fd and accepting, never compete with it.
+	if (kill(pid, SIGTERM) == -1)
+	{
+		rss_warn("kill new binary failed. pid=%d", pid);
+	}
+
+	for (int i = 0; i < RSS_UPGRADE_KILL_GRACE_MS / RSS_DRAIN_CHECK_INTERVAL_MS; i++)
+	{
+		if (waitpid(pid, NULL, WNOHANG) != 0)
+		{
+			rss_trace("new binary quit. pid=%d", pid);
+			return;
+		}
+		st_usleep(RSS_DRAIN_CHECK_INTERVAL_MS * 1000);
+	}
+
+	kill(pid, SIGKILL);
+	waitpid(pid, NULL, 0);
+	rss_warn("new binary killed by SIGKILL. pid=%d", pid);
+}
+
+int RssServer::inherit_listen_fd(int unix_fd)
+{
+	int ret = ERROR_SUCCESS;
+
+	char data = 0;
+	iovec iov;
+	iov.iov_base = &data;
+	iov.iov_len = 1;
+
+	char control[CMSG_SPACE(sizeof(int))];
+	memset(control, 0, sizeof(control));
+
+	msghdr msg;
+	memset(&msg, 0, sizeof(msg));
+	msg.msg_iov = &iov;
+	msg.msg_iovlen = 1;
+	msg.msg_control = control;
+	msg.msg_controllen = sizeof(control);
+
+	// the st is not started, block to recv the fd.
+	if (recvmsg(unix_fd, &msg, 0) != 1)
+	{
+		ret = ERROR_SYSTEM_UPGRADE;
+		rss_error("recv listen fd from old binary failed. ret=%d", ret);
+		return ret;
+	}
+
+	cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+	if (!cmsg || cmsg->cmsg_level != SOL_SOCKET || cmsg->cmsg_type != SCM_RIGHTS)
+	{
+		ret = ERROR_SYSTEM_UPGRADE;
+		rss_error("invalid listen fd message from old binary. ret=%d", ret);
+		return ret;
+	}
+	memcpy(&fd, CMSG_DATA(cmsg), sizeof(int));
+
+	return ret;
+}
@@ -0,0 +1,202 @@
+#include <rss_core_shm_stat.hpp>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+#include <rss_core_log.hpp>
+#include <rss_core_error.hpp>
+#include <rss_core_clock.hpp>
+
+RssShmStatSegment* RssShmStat::segment = NULL;
+RssShmWorkerSlot* RssShmStat::worker = NULL;
+
+int RssShmStat::initialize(int port)
+{
+	int ret = ERROR_SUCCESS;
+
+	char name[64];
+	snprintf(name, sizeof(name), RSS_SHM_STAT_NAME, port, RSS_SHM_STAT_VERSION);
+
+	int fd = shm_open(name, O_RDWR | O_CREAT, 0644);
+	if (fd == -1)
+	{
+		rss_warn("open shm stat %s failed, shm stat disabled.", name);
+		return ret;
+	}
+
+	// the new segment is filled with zero.
+	if (ftruncate(fd, sizeof(RssShmStatSegment)) == -1)
+	{
+		rss_warn("truncate shm stat %s failed, shm stat disabled.", name);
+		::close(fd);
+		return ret;
+	}
+
+	void* p = mmap(NULL, sizeof(RssShmStatSegment), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	::close(fd);
+
+	if (p == MAP_FAILED)
+	{
+		rss_warn("mmap shm stat %s failed, shm stat disabled.", name);
+		return ret;
+	}
+
+	RssShmStatSegment* seg = (RssShmStatSegment*)p;
+	RssShmStatHeader* header = &seg->header;
+
+	// reset the new segment, or the invalid segment left by the dead process,
+	// never reset the segment which maybe written by an alive process.
+	if (header->magic != RSS_SHM_STAT_MAGIC || header->version != RSS_SHM_STAT_VERSION
+		|| header->size != sizeof(RssShmStatSegment))
+	{
+		for (int i = 0; header->magic != 0 && i < RSS_SHM_STAT_MAX_WORKERS; i++)
+		{
+			if (is_alive(__atomic_load_n(&seg->workers[i].pid, __ATOMIC_ACQUIRE)))
+			{
+				rss_warn("shm stat %s is invalid and used by pid=%d, shm stat disabled.",
+				         name, (int)seg->workers[i].pid);
+				munmap(p, sizeof(RssShmStatSegment));
+				return ret;
+			}
+		}
+
+		memset(seg, 0, sizeof(RssShmStatSegment));
+		header->version = RSS_SHM_STAT_VERSION;
+		header->size = sizeof(RssShmStatSegment);
+		header->max_workers = RSS_SHM_STAT_MAX_WORKERS;
+		header->max_sources = RSS_SHM_STAT_MAX_SOURCES;
+		__atomic_store_n(&header->magic, RSS_SHM_STAT_MAGIC, __ATOMIC_RELEASE);
+		rss_trace("reset shm stat %s, version=%d, size=%d", name, RSS_SHM_STAT_VERSION, (int)sizeof(RssShmStatSegment));
+	}
+
+	for (int i = 0; i < RSS_SHM_STAT_MAX_WORKERS; i++)
+	{
+		RssShmWorkerSlot* slot = &seg->workers[i];
+		if (!claim(&slot->pid))
+		{
+			continue;
+		}
+
+		slot->start_ms = RssClock::time_ms();
+		rss_shm_store(slot->update_ms, slot->start_ms);
+		rss_shm_store(slot->conns, 0);
+		rss_shm_store(slot->accepted, 0);
+		rss_shm_store(slot->recv_bytes, 0);
+		rss_shm_store(slot->send_bytes, 0);
+		rss_shm_store(slot->cpu_permille, 0);
+		rss_shm_store(slot->sched_lag_us, 0);
+
+		worker = slot;
+		break;
+	}
+
+	if (!worker)
+	{
+		rss_warn("no free worker slot of shm stat %s, shm stat disabled.", name);
+		munmap(p, sizeof(RssShmStatSegment));
+		return ret;
+	}
+
+	segment = seg;
+	atexit(cleanup);
+
+	rss_trace("shm stat %s opened, worker=%d", name, (int)(worker - seg->workers));
+
+	return ret;
+}
+
+RssShmWorkerSlot* RssShmStat::get_worker()
+{
+	return worker;
+}
+
+RssShmSourceSlot* RssShmStat::alloc_source(int id, const char* url)
+{
+	if (!segment)
+	{
+		return NULL;
+	}
+
+	for (int i = 0; i < RSS_SHM_STAT_MAX_SOURCES; i++)
+	{
+		RssShmSourceSlot* slot = &segment->sources[i];
+		if (!claim(&slot->pid))
+		{
+			continue;
+		}
+
+		rss_shm_store(slot->id, id);
+		rss_shm_store(slot->publishing, 0);
+		rss_shm_store(slot->recv_bytes, 0);
+		rss_shm_store(slot->kbps, 0);
+		rss_shm_store(slot->consumers, 0);
+		rss_shm_store(slot->queue_msgs, 0);
+		rss_shm_store(slot->dropped, 0);
+		rss_shm_store(slot->latency_p50_us, 0);
+		rss_shm_store(slot->latency_p99_us, 0);
+		rss_shm_store(slot->latency_p999_us, 0);
+		snprintf(slot->url, sizeof(slot->url), "%s", url);
+
+		return slot;
+	}
+
+	rss_warn("no free source slot of shm stat, ignore source %s", url);
+	return NULL;
+}
+
+void RssShmStat::free_source(RssShmSourceSlot* slot)
+{
+	if (slot)
+	{
+		__atomic_store_n(&slot->pid, 0, __ATOMIC_RELEASE);
+	}
+}
+
+bool RssShmStat::is_alive(int64_t pid)
+{
+	return pid > 0 && (kill((pid_t)pid, 0) == 0 || errno != ESRCH);
+}
+
+bool RssShmStat::claim(int64_t* pid)
+{
+	int64_t owner = __atomic_load_n(pid, __ATOMIC_ACQUIRE);
+
+	// owned by an alive process, maybe the other binary of hot upgrade.
+	if (owner != 0 && is_alive(owner))
+	{
+		return false;
+	}
+
+	// the other process may claim it at the same time.
+	return __atomic_compare_exchange_n(pid, &owner, (int64_t)getpid(), false, __ATOMIC_ACQ_REL, __ATOMIC_RELAXED);
+}
+
+void RssShmStat::cleanup()
+{
+	if (!segment)
+	{
+		return;
+	}
+
+	int64_t pid = getpid();
+	for (int i = 0; i < RSS_SHM_STAT_MAX_SOURCES; i++)
+	{
+		RssShmSourceSlot* slot = &segment->sources[i];
+		if (__atomic_load_n(&slot->pid, __ATOMIC_ACQUIRE) == pid)
+		{
+			free_source(slot);
+		}
+	}
+
+	if (worker)
+	{
+		__atomic_store_n(&worker->pid, 0, __ATOMIC_RELEASE);
+		worker = NULL;
+	}
+}
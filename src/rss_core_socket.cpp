@@ -7,6 +7,7 @@ RssSocket::RssSocket(st_netfd_t client_stfd)
 	stfd = client_stfd;
 	recv_timeout = ST_UTIME_NO_TIMEOUT;
 	send_timeout = ST_UTIME_NO_TIMEOUT;
+	recv_bytes = send_bytes = 0;
 }
 
 RssSocket::~RssSocket()
@@ -23,6 +24,16 @@ void RssSocket::set_send_timeout(int timeout_ms)
 	send_timeout = timeout_ms * 1000;
 }
 
+int64_t RssSocket::get_recv_bytes()
+{
+	return recv_bytes;
+}
+
+int64_t RssSocket::get_send_bytes()
+{
+	return send_bytes;
+}
+
 int RssSocket::read(const void* buf, size_t size, ssize_t* nread)
 {
 	int ret = ERROR_SUCCESS;
@@ -46,6 +57,11 @@ int RssSocket::read(const void* buf, size_t size, ssize_t* nread)
 		ret = ERROR_SOCKET_READ;
 	}
 
+	if (*nread > 0)
+	{
+		recv_bytes += *nread;
+	}
+
 	return ret;
 }
 
@@ -72,6 +88,11 @@ int RssSocket::read_fully(const void* buf, size_t size, ssize_t* nread)
 		ret = ERROR_SOCKET_READ_FULLY;
 	}
 
+	if (*nread > 0)
+	{
+		recv_bytes += *nread;
+	}
+
 	return ret;
 }
 
@@ -91,6 +112,11 @@ int RssSocket::write(const void* buf, size_t size, ssize_t* nwrite)
 		ret = ERROR_SOCKET_WRITE;
 	}
 
+	if (*nwrite > 0)
+	{
+		send_bytes += *nwrite;
+	}
+
 	return ret;
 }
 
@@ -110,5 +136,10 @@ int RssSocket::writev(const iovec *iov, int iov_size, ssize_t* nwrite)
 		ret = ERROR_SOCKET_WRITE;
 	}
 
+	if (*nwrite > 0)
+	{
+		send_bytes += *nwrite;
+	}
+
 	return ret;
 }
\ No newline at end of file
@@ -1,3 +1,6 @@
+// the log subsystem of this file, see RssLogSubsystem.
+#define RSS_LOG_SUBSYSTEM RssLogSubsystemSource
+
 #include <rss_core_source.hpp>
 
 #include <algorithm>
@@ -6,8 +9,14 @@
 #include <rss_core_protocol.hpp>
 #include <rss_core_auto_free.hpp>
 #include <rss_core_amf0.hpp>
+#include <rss_core_stream.hpp>
+#include <rss_core_trace.hpp>
+#include <rss_core_stat.hpp>
+#include <rss_core_clock.hpp>
+#include <rss_core_shm_stat.hpp>
 
 std::map<std::string, RssSource*> RssSource::pool;
+int RssSource::last_id = 0;
 
 RssSource* RssSource::find(std::string stream_url)
 {
@@ -20,9 +29,25 @@ RssSource* RssSource::find(std::string stream_url)
 	return pool[stream_url];
 }
 
+void RssSource::stat_sources(std::vector<RssSourceStat>& stats)
+{
+	std::map<std::string, RssSource*>::iterator it;
+	for (it = pool.begin(); it != pool.end(); ++it)
+	{
+		RssSourceStat stat;
+		it->second->stat(stat);
+		stats.push_back(stat);
+	}
+}
+
 RssConsumer::RssConsumer(RssSource* _source)
 {
 	source = _source;
+	congested = false;
+	dropping = false;
+	has_video = false;
+	nb_dropped = 0;
+	latency = new RssHistogram(RSS_LATENCY_WINDOW_MS);
 }
 
 RssConsumer::~RssConsumer()
@@ -33,15 +58,102 @@ RssConsumer::~RssConsumer()
 		RssSharedPtrMessage* msg = *it;
 		rss_freep(msg);
 	}
+	source->queue_msgs -= (int64_t)msgs.size();
 	msgs.clear();
 
+	rss_freep(latency);
+
 	source->on_consumer_destroy(this);
 }
 
+void RssConsumer::set_congested(bool is_congested)
+{
+	if (congested != is_congested)
+	{
+		rss_trace("consumer congestion changed to %d, dropped=%" PRId64, is_congested, nb_dropped);
+	}
+
+	congested = is_congested;
+}
+
+int64_t RssConsumer::get_dropped()
+{
+	return nb_dropped;
+}
+
+int RssConsumer::get_queue_msgs()
+{
+	return (int)msgs.size();
+}
+
+void RssConsumer::on_sent(int64_t arrival_us)
+{
+	if (arrival_us <= 0)
+	{
+		return;
+	}
+
+	int64_t latency_us = RssClock::now_us() - arrival_us;
+
+	latency->record(latency_us);
+	source->on_consumer_latency(latency_us);
+}
+
+RssHistogram* RssConsumer::get_latency()
+{
+	return latency;
+}
+
 int RssConsumer::enqueue(RssSharedPtrMessage* msg)
 {
 	int ret = ERROR_SUCCESS;
+
+	// the codec of video is the low 4bits of first byte, 7 is AVC,
+	// the format of audio is the high 4bits of first byte, 10 is AAC,
+	// the AVC/AAC packet type is the second byte, 0 is the sequence header.
+	bool avc = msg->header.is_video() && msg->size > 1 && (msg->payload[0] & 0x0F) == 7;
+	bool aac = msg->header.is_audio() && msg->size > 1 && ((msg->payload[0] >> 4) & 0x0F) == 10;
+	bool sequence_header = (avc || aac) && msg->payload[1] == 0;
+
+	if (msg->header.is_video())
+	{
+		has_video = true;
+	}
+
+	// drop the audio and video when congested, never drop the metadata and sequence header.
+	if ((msg->header.is_audio() || msg->header.is_video()) && !sequence_header)
+	{
+		// the frame type of video keyframe is 1, the high 4bits of first byte,
+		// for AVC, only the NALU(packet type 1) is the keyframe.
+		bool keyframe = msg->header.is_video() && msg->size > 0 && ((msg->payload[0] >> 4) & 0x0F) == 1
+			&& (!avc || msg->payload[1] == 1);
+
+		if (congested)
+		{
+			dropping = true;
+		}
+		else if (dropping && keyframe)
+		{
+			dropping = false;
+			rss_trace("consumer resume at keyframe, dropped=%" PRId64, nb_dropped);
+		}
+		else if (dropping && !has_video)
+		{
+			dropping = false;
+			rss_trace("consumer resume audio only, dropped=%" PRId64, nb_dropped);
+		}
+
+		if (dropping)
+		{
+			nb_dropped++;
+			source->nb_dropped++;
+			rss_freep(msg);
+			return ret;
+		}
+	}
+
 	msgs.push_back(msg);
+	source->queue_msgs++;
 	return ret;
 }
 
@@ -68,8 +180,12 @@ int RssConsumer::get_packets(int max_count, RssSharedPtrMessage**& pmsgs, int& c
 	for (int i = 0; i < count; i++)
 	{
 		pmsgs[i] = msgs[i];
+		rss_trace_event(RssTraceEventDequeued, pmsgs[i]->header.message_type, source->get_id(),
+		                pmsgs[i]->header.timestamp, pmsgs[i]->size, 0);
 	}
 
+	source->queue_msgs -= count;
+
 	if (count == (int)msgs.size())
 	{
 		msgs.clear();
@@ -84,10 +200,23 @@ int RssConsumer::get_packets(int max_count, RssSharedPtrMessage**& pmsgs, int& c
 
 RssSource::RssSource(std::string _stream_url)
 {
+	id = ++last_id;
 	stream_url = _stream_url;
 	cache_metadata = NULL;
 	cache_sh_video = NULL;
 	cache_sh_audio = NULL;
+	encode_buffer = new RssEncodeBuffer();
+
+	publisher_id = 0;
+	publish_time = 0;
+	recv_bytes = 0;
+	kbps = new RssKbps();
+	latency = new RssHistogram(RSS_LATENCY_WINDOW_MS);
+	queue_msgs = 0;
+	nb_dropped = 0;
+
+	shm = RssShmStat::alloc_source(id, stream_url.c_str());
+	shm_update_time = 0;
 }
 
 RssSource::~RssSource()
@@ -103,33 +232,95 @@ RssSource::~RssSource()
 	rss_freep(cache_metadata);
 	rss_freep(cache_sh_video);
 	rss_freep(cache_sh_audio);
+	rss_freep(encode_buffer);
+	rss_freep(kbps);
+	rss_freep(latency);
+
+	RssShmStat::free_source(shm);
+	shm = NULL;
+}
+
+int RssSource::get_id()
+{
+	return id;
+}
+
+void RssSource::on_publish(int client_id, const char* ip)
+{
+	publisher_id = client_id;
+	publisher_ip = ip? ip : "";
+	publish_time = RssClock::time_ms();
+
+	update_shm(true);
+}
+
+void RssSource::on_unpublish()
+{
+	publisher_id = 0;
+	publisher_ip = "";
+	publish_time = 0;
+
+	update_shm(true);
+}
+
+void RssSource::stat(RssSourceStat& stat)
+{
+	stat.id = id;
+	stat.url = stream_url;
+	stat.publisher_id = publisher_id;
+	stat.publisher_ip = publisher_ip;
+	stat.publish_ms = publisher_id? RssClock::time_ms() - publish_time : 0;
+	stat.recv_bytes = recv_bytes;
+	stat.kbps = kbps->get_kbps();
+	stat.nb_consumers = (int)consumers.size();
+	stat.cache_msgs = (cache_metadata? 1 : 0) + (cache_sh_video? 1 : 0) + (cache_sh_audio? 1 : 0);
+	stat.latency.load(latency);
 }
 
-int RssSource::on_meta_data(RssCommonMessage* msg, RssOnMetaDataPacket* metadata)
+void RssSource::on_consumer_latency(int64_t latency_us)
+{
+	latency->record(latency_us);
+}
+
+int RssSource::on_meta_data(RssCommonMessage* msg)
 {
 	int ret = ERROR_SUCCESS;
 
-	metadata->metadata->set("server",
-	                        new RssAmf0String(RTMP_SIG_RSS_NAME"" RTMP_SIG_RSS_VERSION));
+	const char* server = RTMP_SIG_RSS_NAME"" RTMP_SIG_RSS_VERSION;
 
-	// encode the metadata to payload
-	int size = metadata->get_payload_length();
-	if (size <= 0)
+	// splice the server to the raw bytes of metadata.
+	int size = 0;
+	char* payload = NULL;
+	if ((ret = rss_rtmp_splice_metadata(msg, "server", server, encode_buffer, size, payload)) != ERROR_SUCCESS)
 	{
-		rss_warn("ignore the invalid metadata. size=%d", size);
-		return ret;
+		rss_warn("splice metadata failed, decode it. ret=%d", ret);
+
+		if ((ret = msg->decode_packet()) != ERROR_SUCCESS)
+		{
+			rss_error("decode onMetaData message failed. ret=%d", ret);
+			return ret;
+		}
+
+		RssOnMetaDataPacket* metadata = dynamic_cast<RssOnMetaDataPacket*>(msg->get_packet());
+		rss_assert(metadata != NULL);
+
+		metadata->metadata->set("server", new RssAmf0String(server));
+
+		// encode the metadata to payload
+		if ((ret = metadata->encode(encode_buffer, size, payload)) != ERROR_SUCCESS)
+		{
+			rss_error("encode metadata error. ret=%d", ret);
+			return ret;
+		}
 	}
-	rss_verbose("get metadata size success.");
 
-	char* payload = new char[size];
-	memset(payload, 0, size);
-	if ((ret = metadata->encode(size, payload)) != ERROR_SUCCESS)
+	if (size <= 0)
 	{
-		rss_error("encode metadata error. ret=%d", ret);
+		rss_warn("ignore the invalid metadata. size=%d", size);
 		rss_freepa(payload);
 		return ret;
 	}
-	rss_verbose("encode metadata success.");
+	rss_verbose("encode metadata success. size=%d", size);
 
 	// create a shared ptr message.
 	rss_freep(cache_metadata);
@@ -170,7 +361,11 @@ int RssSource::on_audio(RssCommonMessage* audio)
 		rss_error("initialize the audio failed. ret=%d", ret);
 		return ret;
 	}
-	rss_verbose("initialize shared ptr audio success.");
+	rss_verbose_limit("initialize shared ptr audio success.");
+	msg->set_arrival(RssClock::now_us());
+
+	recv_bytes += audio->size;
+	kbps->sample(recv_bytes);
 
 	// detach the original audio
 	audio->payload = NULL;
@@ -187,12 +382,21 @@ int RssSource::on_audio(RssCommonMessage* audio)
 			return ret;
 		}
 	}
-	rss_info("dispatch audio success.");
+	rss_trace_event(RssTraceEventEnqueued, msg->header.message_type, id,
+	                msg->header.timestamp, msg->size, (int)consumers.size());
+	rss_info_limit("dispatch audio success.");
+
+	if (shm)
+	{
+		update_shm(false);
+	}
 
 	if (!cache_sh_audio)
 	{
 		rss_freep(cache_sh_audio);
 		cache_sh_audio = msg->copy();
+		// the cached message sent to new consumer, never count its latency.
+		cache_sh_audio->set_arrival(0);
 	}
 
 	return ret;
@@ -209,7 +413,11 @@ int RssSource::on_video(RssCommonMessage* video)
 		rss_error("initialize the video failed. ret=%d", ret);
 		return ret;
 	}
-	rss_verbose("initialize shared ptr video success.");
+	rss_verbose_limit("initialize shared ptr video success.");
+	msg->set_arrival(RssClock::now_us());
+
+	recv_bytes += video->size;
+	kbps->sample(recv_bytes);
 
 	// detach the original audio
 	video->payload = NULL;
@@ -226,12 +434,55 @@ int RssSource::on_video(RssCommonMessage* video)
 			return ret;
 		}
 	}
-	rss_info("dispatch video success.");
+	rss_trace_event(RssTraceEventEnqueued, msg->header.message_type, id,
+	                msg->header.timestamp, msg->size, (int)consumers.size());
+	rss_info_limit("dispatch video success.");
+
+	if (shm)
+	{
+		update_shm(false);
+	}
 
 	if (!cache_sh_video)
 	{
 		rss_freep(cache_sh_video);
 		cache_sh_video = msg->copy();
+		cache_sh_video->set_arrival(0);
+	}
+
+	return ret;
+}
+
+int RssSource::on_aggregate(RssCommonMessage* msg)
+{
+	int ret = ERROR_SUCCESS;
+
+	std::vector<RssCommonMessage*> msgs;
+	ret = rss_rtmp_demux_aggregate(msg, msgs);
+
+	// dispatch the demuxed messages in order until error, and free all of them.
+	std::vector<RssCommonMessage*>::iterator it;
+	for (it = msgs.begin(); it != msgs.end(); ++it)
+	{
+		RssCommonMessage* sub = *it;
+
+		if (ret == ERROR_SUCCESS && sub->header.is_audio())
+		{
+			ret = on_audio(sub);
+		}
+		else if (ret == ERROR_SUCCESS && sub->header.is_video())
+		{
+			ret = on_video(sub);
+		}
+
+		rss_freep(sub);
+	}
+	msgs.clear();
+
+	if (ret != ERROR_SUCCESS)
+	{
+		rss_error("process aggregate message failed. ret=%d", ret);
+		return ret;
 	}
 
 	return ret;
@@ -243,6 +494,7 @@ int RssSource::create_consumer(RssConsumer*& consumer)
 
 	consumer = new RssConsumer(this);
 	consumers.push_back(consumer);
+	update_shm_consumers();
 
 	if (cache_metadata && (ret = consumer->enqueue(cache_metadata->copy())) != ERROR_SUCCESS)
 	{
@@ -276,5 +528,43 @@ void RssSource::on_consumer_destroy(RssConsumer* consumer)
 	{
 		consumers.erase(it);
 	}
+	update_shm_consumers();
 	rss_info("handle consumer destroy success.");
-}
\ No newline at end of file
+}
+
+void RssSource::update_shm(bool force)
+{
+	if (!shm)
+	{
+		return;
+	}
+
+	rss_shm_store(shm->recv_bytes, recv_bytes);
+
+	int64_t now = RssClock::time_ms();
+	if (!force && now - shm_update_time < RSS_SHM_STAT_INTERVAL_MS)
+	{
+		return;
+	}
+	shm_update_time = now;
+
+	rss_shm_store(shm->publishing, (int64_t)(publisher_id? 1 : 0));
+	rss_shm_store(shm->kbps, (int64_t)kbps->get_kbps());
+	rss_shm_store(shm->consumers, (int64_t)consumers.size());
+	rss_shm_store(shm->queue_msgs, queue_msgs);
+	rss_shm_store(shm->dropped, nb_dropped);
+
+	RssLatencyStat stat;
+	stat.load(latency);
+	rss_shm_store(shm->latency_p50_us, stat.p50);
+	rss_shm_store(shm->latency_p99_us, stat.p99);
+	rss_shm_store(shm->latency_p999_us, stat.p999);
+}
+
+void RssSource::update_shm_consumers()
+{
+	if (shm)
+	{
+		rss_shm_store(shm->consumers, (int64_t)consumers.size());
+	}
+}
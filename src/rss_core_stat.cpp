@@ -0,0 +1,254 @@
+#include <rss_core_stat.hpp>
+
+#include <string.h>
+
+#include <rss_core_clock.hpp>
+
+// the interval to compute the kbps.
+#define RSS_KBPS_SAMPLE_MS 1000
+// the kbps is expired when not sampled for this time, for instance, the stream stopped.
+#define RSS_KBPS_EXPIRE_MS (3 * RSS_KBPS_SAMPLE_MS)
+
+RssKbps::RssKbps()
+{
+	sample_time = -1;
+	sample_bytes = 0;
+	kbps = 0;
+}
+
+RssKbps::~RssKbps()
+{
+}
+
+void RssKbps::sample(int64_t total_bytes)
+{
+	int64_t now = RssClock::time_ms();
+
+	if (sample_time < 0)
+	{
+		sample_time = now;
+		sample_bytes = total_bytes;
+		return;
+	}
+
+	int64_t elapsed = now - sample_time;
+	if (elapsed < RSS_KBPS_SAMPLE_MS)
+	{
+		return;
+	}
+
+	// bytes*8/1000 per elapsed ms.
+	kbps = (int)((total_bytes - sample_bytes) * 8 / elapsed);
+	sample_time = now;
+	sample_bytes = total_bytes;
+}
+
+int RssKbps::get_kbps()
+{
+	if (sample_time < 0 || RssClock::time_ms() - sample_time > RSS_KBPS_EXPIRE_MS)
+	{
+		return 0;
+	}
+
+	return kbps;
+}
+
+RssHistogram::RssHistogram(int64_t _window_ms)
+{
+	memset(buckets, 0, sizeof(buckets));
+	counts = buckets[0];
+	previous = buckets[1];
+	window_count[0] = window_count[1] = 0;
+	window_max[0] = window_max[1] = 0;
+	window_ms = _window_ms;
+	window_start = (window_ms > 0)? RssClock::time_ms() : 0;
+	count = 0;
+	sum = 0;
+	max = 0;
+}
+
+RssHistogram::~RssHistogram()
+{
+}
+
+void RssHistogram::record(int64_t value)
+{
+	if (value < 0)
+	{
+		value = 0;
+	}
+
+	rotate();
+
+	counts[index_of(value)]++;
+	window_count[0]++;
+	window_max[0] = rss_max(window_max[0], value);
+
+	count++;
+	sum += value;
+	max = rss_max(max, value);
+}
+
+int64_t RssHistogram::get_count()
+{
+	return count;
+}
+
+int64_t RssHistogram::get_sum()
+{
+	return sum;
+}
+
+int64_t RssHistogram::get_max()
+{
+	return max;
+}
+
+int64_t RssHistogram::get_window_max()
+{
+	rotate();
+	return rss_max(window_max[0], window_max[1]);
+}
+
+int64_t RssHistogram::percentile(double p)
+{
+	rotate();
+
+	int64_t nb_values = window_count[0] + window_count[1];
+	if (nb_values == 0)
+	{
+		return 0;
+	}
+
+	int64_t nb_max = rss_max(window_max[0], window_max[1]);
+
+	// the rank of value, 1 to count.
+	int64_t rank = (int64_t)(p * nb_values + 0.5);
+	rank = rss_max(rank, (int64_t)1);
+
+	int64_t total = 0;
+	for (int i = 0; i < RSS_HISTOGRAM_SIZE; i++)
+	{
+		total += (int64_t)(counts[i] + previous[i]);
+		if (total >= rank)
+		{
+			return rss_min(value_of(i), nb_max);
+		}
+	}
+
+	return nb_max;
+}
+
+void RssHistogram::rotate()
+{
+	if (window_ms <= 0)
+	{
+		return;
+	}
+
+	int64_t now = RssClock::time_ms();
+	int64_t elapsed = now - window_start;
+	if (elapsed < window_ms)
+	{
+		return;
+	}
+
+	// the current window becomes the previous, then clear it for the current.
+	uint64_t* tmp = previous;
+	previous = counts;
+	counts = tmp;
+	window_count[1] = window_count[0];
+	window_max[1] = window_max[0];
+
+	// no values in the last window, the previous is expired too.
+	if (elapsed >= 2 * window_ms)
+	{
+		memset(previous, 0, sizeof(uint64_t) * RSS_HISTOGRAM_SIZE);
+		window_count[1] = window_max[1] = 0;
+	}
+
+	memset(counts, 0, sizeof(uint64_t) * RSS_HISTOGRAM_SIZE);
+	window_count[0] = window_max[0] = 0;
+	window_start = now;
+}
+
+int RssHistogram::index_of(int64_t value)
+{
+	// the small values are exact.
+	if (value < (1 << RSS_HISTOGRAM_SUB_BITS))
+	{
+		return (int)value;
+	}
+
+	// the highest bit, and the sub-bucket is the next bits.
+	int bits = 63 - __builtin_clzll((uint64_t)value);
+	if (bits >= RSS_HISTOGRAM_MAX_BITS)
+	{
+		return RSS_HISTOGRAM_SIZE - 1;
+	}
+
+	int sub = (int)(value >> (bits - RSS_HISTOGRAM_SUB_BITS)) & ((1 << RSS_HISTOGRAM_SUB_BITS) - 1);
+	return ((bits - RSS_HISTOGRAM_SUB_BITS + 1) << RSS_HISTOGRAM_SUB_BITS) + sub;
+}
+
+int64_t RssHistogram::value_of(int index)
+{
+	if (index < (1 << RSS_HISTOGRAM_SUB_BITS))
+	{
+		return index;
+	}
+
+	int bits = (index >> RSS_HISTOGRAM_SUB_BITS) + RSS_HISTOGRAM_SUB_BITS - 1;
+	int sub = index & ((1 << RSS_HISTOGRAM_SUB_BITS) - 1);
+
+	// the middle of sub-bucket.
+	int64_t width = (int64_t)1 << (bits - RSS_HISTOGRAM_SUB_BITS);
+	int64_t low = ((int64_t)1 << bits) + sub * width;
+	return low + width / 2;
+}
+
+RssLatencyStat::RssLatencyStat()
+{
+	count = sum = 0;
+	p50 = p99 = p999 = 0;
+	max = 0;
+}
+
+void RssLatencyStat::load(RssHistogram* histogram)
+{
+	count = histogram->get_count();
+	sum = histogram->get_sum();
+	p50 = histogram->percentile(0.5);
+	p99 = histogram->percentile(0.99);
+	p999 = histogram->percentile(0.999);
+	max = histogram->get_window_max();
+}
+
+RssServerStat::RssServerStat()
+{
+	uptime_ms = 0;
+	nb_conns = 0;
+	nb_accepted = 0;
+	recv_bytes = send_bytes = 0;
+}
+
+RssConnStat::RssConnStat()
+{
+	id = 0;
+	uptime_ms = 0;
+	recv_bytes = send_bytes = 0;
+	recv_kbps = send_kbps = 0;
+	queue_msgs = 0;
+	dropped = 0;
+}
+
+RssSourceStat::RssSourceStat()
+{
+	id = 0;
+	publisher_id = 0;
+	publish_ms = 0;
+	recv_bytes = 0;
+	kbps = 0;
+	nb_consumers = 0;
+	cache_msgs = 0;
+}
@@ -1,182 +1,134 @@
+// the log subsystem of this file, see RssLogSubsystem.
+#define RSS_LOG_SUBSYSTEM RssLogSubsystemProtocol
+
 #include <rss_core_stream.hpp>
 
+#include <string.h>
+
 #include <rss_core_log.hpp>
 #include <rss_core_error.hpp>
 
-RssStream::RssStream()
+// the initial capacity of encode buffer.
+#define RSS_ENCODE_BUFFER_SIZE 4096
+
+RssStringView::RssStringView()
 {
-	p = bytes = NULL;
-	size = 0;
+	p = NULL;
+	n = 0;
 }
 
-RssStream::~RssStream()
+RssStringView::RssStringView(const char* _p, int _n)
 {
+	p = _p;
+	n = _n;
 }
 
-int RssStream::initialize(char* _bytes, int _size)
+RssStringView::RssStringView(const char* str)
 {
-	int ret = ERROR_SUCCESS;
-
-	if (!_bytes)
-	{
-		ret = ERROR_SYSTEM_STREAM_INIT;
-		rss_error("stream param bytes must not be NULL. ret=%d", ret);
-		return ret;
-	}
-
-	if (_size <= 0)
-	{
-		ret = ERROR_SYSTEM_STREAM_INIT;
-		rss_error("stream param size must be positive. ret=%d", ret);
-		return ret;
-	}
-
-	size = _size;
-	p = bytes = _bytes;
-
-	return ret;
+	p = str;
+	n = str? (int)strlen(str) : 0;
 }
 
-void RssStream::reset()
+RssStringView::RssStringView(const std::string& str)
 {
-	p = bytes;
+	p = str.data();
+	n = (int)str.length();
 }
 
-bool RssStream::empty()
+const char* RssStringView::data() const
 {
-	return !p || !bytes || (p >= bytes + size);
+	return p;
 }
 
-bool RssStream::require(int required_size)
+int RssStringView::size() const
 {
-	return !empty() && (required_size <= bytes + size - p);
+	return n;
 }
 
-void RssStream::skip(int size)
+bool RssStringView::empty() const
 {
-	p += size;
+	return n <= 0;
 }
 
-int RssStream::pos()
+bool RssStringView::equals(const RssStringView& v) const
 {
-	if (empty())
-	{
-		return 0;
-	}
-
-	return p - bytes;
+	return n == v.n && (n == 0 || memcmp(p, v.p, n) == 0);
 }
 
-int8_t RssStream::read_1bytes()
+std::string RssStringView::to_str() const
 {
-	rss_assert(require(1));
-
-	return (int8_t)*p++;
+	return std::string(p? p : "", n);
 }
 
-int16_t RssStream::read_2bytes()
+RssStream::RssStream()
 {
-	rss_assert(require(2));
-
-	int16_t value;
-	pp = (char*)&value;
-	pp[1] = *p++;
-	pp[0] = *p++;
-
-	return value;
 }
 
-int32_t RssStream::read_4bytes()
+RssStream::~RssStream()
 {
-	rss_assert(require(4));
-
-	int32_t value;
-	pp = (char*)&value;
-	pp[3] = *p++;
-	pp[2] = *p++;
-	pp[1] = *p++;
-	pp[0] = *p++;
-
-	return value;
 }
 
-int64_t RssStream::read_8bytes()
+RssEncodeBuffer::RssEncodeBuffer()
 {
-	rss_assert(require(8));
-
-	int64_t value;
-	pp = (char*)&value;
-	pp[7] = *p++;
-	pp[6] = *p++;
-	pp[5] = *p++;
-	pp[4] = *p++;
-	pp[3] = *p++;
-	pp[2] = *p++;
-	pp[1] = *p++;
-	pp[0] = *p++;
-
-	return value;
+	buf = NULL;
+	capacity = 0;
 }
 
-std::string RssStream::read_string(int len)
+RssEncodeBuffer::~RssEncodeBuffer()
 {
-	rss_assert(require(len));
-
-	std::string value;
-	value.append(p, len);
-
-	p += len;
-
-	return value;
+	rss_freepa(buf);
 }
 
-void RssStream::write_1bytes(int8_t value)
+int RssEncodeBuffer::rewind()
 {
-	rss_assert(require(1));
+	if (!buf)
+	{
+		capacity = RSS_ENCODE_BUFFER_SIZE;
+		buf = new char[capacity];
+	}
 
-	*p++ = value;
+	return initialize(buf, capacity);
 }
 
-void RssStream::write_2bytes(int16_t value)
+char* RssEncodeBuffer::data()
 {
-	rss_assert(require(2));
-
-	pp = (char*)&value;
-	*p++ = pp[1];
-	*p++ = pp[0];
+	return buf;
 }
 
-void RssStream::write_4bytes(int32_t value)
+int RssEncodeBuffer::length()
 {
-	rss_assert(require(4));
-
-	pp = (char*)&value;
-	*p++ = pp[3];
-	*p++ = pp[2];
-	*p++ = pp[1];
-	*p++ = pp[0];
+	return buf? current() - buf : 0;
 }
 
-void RssStream::write_8bytes(int64_t value)
+bool RssEncodeBuffer::grow(int required_size)
 {
-	rss_assert(require(8));
+	if (!buf || required_size < 0)
+	{
+		return false;
+	}
 
-	pp = (char*)&value;
-	*p++ = pp[7];
-	*p++ = pp[6];
-	*p++ = pp[5];
-	*p++ = pp[4];
-	*p++ = pp[3];
-	*p++ = pp[2];
-	*p++ = pp[1];
-	*p++ = pp[0];
-}
+	int size = length();
+	if (required_size <= capacity - size)
+	{
+		return true;
+	}
 
-void RssStream::write_string(std::string value)
-{
-	rss_assert(require(value.length()));
+	int new_capacity = capacity;
+	while (new_capacity - size < required_size)
+	{
+		new_capacity *= 2;
+	}
 
-	memcpy(p, value.data(), value.length());
-	p += value.length();
-}
+	char* new_buf = new char[new_capacity];
+	memcpy(new_buf, buf, size);
+	rss_freepa(buf);
+
+	buf = new_buf;
+	capacity = new_capacity;
+	rss_verbose("encode buffer grow to %d bytes", capacity);
 
+	initialize(buf, capacity);
+	skip(size);
+
+	return true;
+}
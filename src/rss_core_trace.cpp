@@ -0,0 +1,93 @@
+#include <rss_core_trace.hpp>
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+#include <rss_core_log.hpp>
+#include <rss_core_error.hpp>
+
+RssTraceHeader* rss_trace_ring = NULL;
+// the records follow the header.
+static RssTraceRecord* rss_trace_records = NULL;
+
+int rss_trace_initialize()
+{
+	int ret = ERROR_SUCCESS;
+
+	const char* prefix = getenv(RSS_TRACE_FILE_ENV);
+	if (!prefix || !prefix[0])
+	{
+		return ret;
+	}
+
+	// the file per process, the new binary of hot upgrade never write the old one.
+	char file[1024];
+	snprintf(file, sizeof(file), "%s.%d", prefix, (int)getpid());
+
+	size_t size = sizeof(RssTraceHeader) + sizeof(RssTraceRecord) * RSS_TRACE_RING_RECORDS;
+
+	int fd = ::open(file, O_RDWR | O_CREAT | O_TRUNC, 0644);
+	if (fd == -1)
+	{
+		rss_warn("open trace file %s failed, trace disabled.", file);
+		return ret;
+	}
+
+	if (::ftruncate(fd, size) == -1)
+	{
+		rss_warn("truncate trace file %s to %d failed, trace disabled.", file, (int)size);
+		::close(fd);
+		return ret;
+	}
+
+	void* p = ::mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	::close(fd);
+
+	if (p == MAP_FAILED)
+	{
+		rss_warn("mmap trace file %s failed, trace disabled.", file);
+		return ret;
+	}
+
+	RssTraceHeader* header = (RssTraceHeader*)p;
+	memcpy(header->magic, RSS_TRACE_MAGIC, sizeof(header->magic));
+	header->version = RSS_TRACE_VERSION;
+	header->record_size = sizeof(RssTraceRecord);
+	header->capacity = RSS_TRACE_RING_RECORDS;
+	header->count = 0;
+
+	rss_trace_records = (RssTraceRecord*)(header + 1);
+	rss_trace_ring = header;
+
+	rss_trace("trace events to %s, records=%d", file, RSS_TRACE_RING_RECORDS);
+
+	return ret;
+}
+
+void rss_trace_write(int event, int message_type, int stream_id, int timestamp, int bytes, int count)
+{
+	// the us resolution for latency, the coarse clock is not enough.
+	timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	// all st-threads run in the main thread, the single writer.
+	int64_t index = rss_trace_ring->count;
+	RssTraceRecord* record = &rss_trace_records[index & (RSS_TRACE_RING_RECORDS - 1)];
+
+	record->time_us = (int64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+	record->event = (int16_t)event;
+	record->message_type = (int16_t)message_type;
+	record->conn_id = log_context->get_id();
+	record->stream_id = stream_id;
+	record->timestamp = timestamp;
+	record->bytes = bytes;
+	record->count = count;
+
+	// publish the record for the reader of a running server.
+	__atomic_store_n(&rss_trace_ring->count, index + 1, __ATOMIC_RELEASE);
+}
@@ -12,7 +12,7 @@ int main(int argc, char** argv){
 	
 	if (argc <= 1) {
 		printf(RTMP_SIG_RSS_NAME " " RTMP_SIG_RSS_VERSION
-			"Usage: %s <listen_port>\n" 
+			"Usage: %s <listen_port> [api_port]\n" 
 			RTMP_SIG_RSS_URL "\n"
 			"Email: " RTMP_SIG_RSS_EMAIL "\n",
 			argv[0]);
@@ -32,6 +32,11 @@ int main(int argc, char** argv){
 		return ret;
 	}
 	
+	// the http api is optional.
+	if (argc > 2 && (ret = server.listen_api(::atoi(argv[2]))) != ERROR_SUCCESS) {
+		return ret;
+	}
+	
 	if ((ret = server.cycle()) != ERROR_SUCCESS) {
 		return ret;
 	}
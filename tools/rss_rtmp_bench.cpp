@@ -0,0 +1,687 @@
+/**
+* the rtmp load generator, publish the synthetic streams and play them over
+* loopback, by the rtmp client of server, see RssRtmpClient.
+* usage: objs/tools/rss_rtmp_bench [-h host] [-p port] [-a app] [-n publishers] [-m players]
+* 		[-b kbps] [-f fps] [-g gop] [-z frame_size] [-d duration]
+* 		-n the number of publishers, each publishes a stream, default 1.
+* 		-m the number of players of each stream, default 10.
+* 		-b the video bitrate in kbps, default 1000, the audio is 64kbps.
+* 		-f the video frame rate, default 25.
+* 		-g the frames of gop, default 50.
+* 		-z the size of video frame in bytes, the keyframe is 4 times, overrides -b.
+* 		-d the seconds to measure after all players started, default 10.
+* the report is key=value lines to stdout, the errors are logged to rtmp_bench.log:
+* 		accept_rate, the connections established per second when players start.
+* 		egress_gbps, the bytes received by all players in the duration.
+* 		player_kbps, the bitrate received by each player in the duration.
+* 		startup_ms, the time from connect to the first keyframe of player.
+* 		server_cpu, the cpu of server, the pids are found in the shm stat segment.
+*/
+#include <rss_core.hpp>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+
+#include <string>
+#include <vector>
+
+#include <st.h>
+
+#include <rss_core_log.hpp>
+#include <rss_core_error.hpp>
+#include <rss_core_rtmp.hpp>
+#include <rss_core_protocol.hpp>
+#include <rss_core_amf0.hpp>
+#include <rss_core_clock.hpp>
+#include <rss_core_stat.hpp>
+#include <rss_core_shm_stat.hpp>
+
+#include "../bench/rss_bench.hpp"
+
+#define BENCH_DEFAULT_PORT 1935
+#define BENCH_TIMEOUT_MS 10000
+// the chunk size of publisher, like FMLE.
+#define BENCH_CHUNK_SIZE 4096
+// the keyframe is larger than the other frames of gop.
+#define BENCH_KEYFRAME_SCALE 4
+// the aac of 44.1kHz, 1024 samples per frame.
+#define BENCH_AUDIO_KBPS 64
+#define BENCH_AUDIO_SAMPLE_RATE 44100
+#define BENCH_AUDIO_FRAME_SAMPLES 1024
+// the interval to check whether the publishers and players are ready.
+#define BENCH_POLL_MS 10
+// the errors of clients are logged to file, the stdout is only for the report.
+#define BENCH_LOG_FILE "rtmp_bench.log"
+
+struct BenchConfig
+{
+	std::string host;
+	int port;
+	std::string app;
+	int publishers;
+	int players;
+	int kbps;
+	int fps;
+	int gop;
+	int frame_size;
+	int duration;
+};
+
+struct BenchPublisher
+{
+	int index;
+	bool published;
+	bool failed;
+	int64_t start_us;
+	int64_t send_bytes;
+};
+
+struct BenchPlayer
+{
+	int index;
+	bool failed;
+	// the time to connect, handshake done and the first keyframe.
+	int64_t start_us;
+	int64_t connected_us;
+	int64_t keyframe_us;
+	int64_t recv_bytes;
+};
+
+static BenchConfig config;
+static std::vector<BenchPublisher> publishers;
+static std::vector<BenchPlayer> players;
+
+static void bench_stream_name(int index, std::string& stream)
+{
+	char buf[32];
+	snprintf(buf, sizeof(buf), "bench_%d", index);
+	stream = buf;
+}
+
+static int bench_connect(st_netfd_t* pstfd)
+{
+	int ret = ERROR_SUCCESS;
+
+	int fd = socket(AF_INET, SOCK_STREAM, 0);
+	if (fd == -1)
+	{
+		ret = ERROR_SOCKET_CREATE;
+		rss_error("create socket error. ret=%d", ret);
+		return ret;
+	}
+
+	st_netfd_t stfd = st_netfd_open_socket(fd);
+	if (stfd == NULL)
+	{
+		ret = ERROR_ST_OPEN_SOCKET;
+		rss_error("st_netfd_open_socket failed. ret=%d", ret);
+		::close(fd);
+		return ret;
+	}
+
+	sockaddr_in addr;
+	memset(&addr, 0, sizeof(addr));
+	addr.sin_family = AF_INET;
+	addr.sin_port = htons(config.port);
+	addr.sin_addr.s_addr = inet_addr(config.host.c_str());
+
+	if (st_connect(stfd, (const sockaddr*)&addr, sizeof(addr), BENCH_TIMEOUT_MS * 1000LL) == -1)
+	{
+		ret = ERROR_SOCKET_CONNECT;
+		rss_error("connect to %s:%d failed. ret=%d", config.host.c_str(), config.port, ret);
+		st_netfd_close(stfd);
+		return ret;
+	}
+
+	*pstfd = stfd;
+
+	return ret;
+}
+
+static int bench_send_metadata(RssRtmpClient* client, int stream_id)
+{
+	RssCommonMessage* msg = new RssCommonMessage();
+	RssOnMetaDataPacket* pkt = new RssOnMetaDataPacket();
+
+	pkt->metadata->set("width", new RssAmf0Number(1280));
+	pkt->metadata->set("height", new RssAmf0Number(720));
+	pkt->metadata->set("videodatarate", new RssAmf0Number(config.kbps));
+	pkt->metadata->set("framerate", new RssAmf0Number(config.fps));
+	pkt->metadata->set("videocodecid", new RssAmf0Number(7));
+	pkt->metadata->set("audiodatarate", new RssAmf0Number(BENCH_AUDIO_KBPS));
+	pkt->metadata->set("audiosamplerate", new RssAmf0Number(BENCH_AUDIO_SAMPLE_RATE));
+	pkt->metadata->set("audiocodecid", new RssAmf0Number(10));
+	pkt->metadata->set("encoder", new RssAmf0String(RTMP_SIG_RSS_NAME " bench"));
+
+	msg->set_packet(pkt, stream_id);
+
+	return client->send_message(msg);
+}
+
+static int bench_publish(BenchPublisher* publisher, RssRtmpClient* client)
+{
+	int ret = ERROR_SUCCESS;
+
+	std::string stream;
+	bench_stream_name(publisher->index, stream);
+
+	int stream_id = 0;
+	if ((ret = client->set_chunk_size(BENCH_CHUNK_SIZE)) != ERROR_SUCCESS
+		|| (ret = client->fmle_publish(stream, stream_id)) != ERROR_SUCCESS)
+	{
+		return ret;
+	}
+
+	if ((ret = bench_send_metadata(client, stream_id)) != ERROR_SUCCESS)
+	{
+		return ret;
+	}
+
+	// the avc and aac sequence header.
+	static const char avc_sh[] = {
+		0x17, 0x00, 0x00, 0x00, 0x00,
+		0x01, 0x64, 0x00, 0x1f, (char)0xff, (char)0xe1, 0x00, 0x04, 0x67, 0x64, 0x00, 0x1f,
+		0x01, 0x00, 0x04, 0x68, (char)0xee, 0x3c, (char)0x80,
+	};
+	static const char aac_sh[] = {(char)0xaf, 0x00, 0x12, 0x10};
+	static const char keyframe_header[] = {0x17, 0x01, 0x00, 0x00, 0x00};
+	static const char frame_header[] = {0x27, 0x01, 0x00, 0x00, 0x00};
+	static const char audio_header[] = {(char)0xaf, 0x01};
+
+	// keep the bitrate with the large keyframe.
+	int frame_size = config.frame_size;
+	if (frame_size <= 0)
+	{
+		int64_t avg = (int64_t)config.kbps * 1000 / 8 / config.fps;
+		frame_size = (int)(avg * config.gop / (config.gop + BENCH_KEYFRAME_SCALE - 1));
+	}
+	frame_size = rss_max(frame_size, (int)sizeof(frame_header));
+	int audio_size = BENCH_AUDIO_KBPS * 1000 / 8 * BENCH_AUDIO_FRAME_SAMPLES / BENCH_AUDIO_SAMPLE_RATE;
+
+	RssSharedPtrMessage* templates[3];
+	templates[0] = bench_create_message(true, keyframe_header, sizeof(keyframe_header), frame_size * BENCH_KEYFRAME_SCALE, stream_id);
+	templates[1] = bench_create_message(true, frame_header, sizeof(frame_header), frame_size, stream_id);
+	templates[2] = bench_create_message(false, audio_header, sizeof(audio_header), audio_size, stream_id);
+
+	if ((ret = client->send_message(bench_create_message(true, avc_sh, sizeof(avc_sh), sizeof(avc_sh), stream_id))) != ERROR_SUCCESS
+		|| (ret = client->send_message(bench_create_message(false, aac_sh, sizeof(aac_sh), sizeof(aac_sh), stream_id))) != ERROR_SUCCESS)
+	{
+		for (int i = 0; i < 3; i++)
+		{
+			rss_freep(templates[i]);
+		}
+		return ret;
+	}
+
+	publisher->published = true;
+	publisher->start_us = RssClock::now_us();
+
+	// interleave the audio and video by timestamp, sendout at the wall time.
+	int64_t nb_videos = 0, nb_audios = 0;
+	while (true)
+	{
+		int64_t video_ts = nb_videos * 1000 / config.fps;
+		int64_t audio_ts = nb_audios * BENCH_AUDIO_FRAME_SAMPLES * 1000 / BENCH_AUDIO_SAMPLE_RATE;
+		bool is_video = video_ts <= audio_ts;
+		int64_t timestamp = is_video? video_ts : audio_ts;
+
+		int64_t wait = publisher->start_us + timestamp * 1000 - RssClock::now_us();
+		if (wait > 0)
+		{
+			st_usleep(wait);
+		}
+
+		RssSharedPtrMessage* msg = NULL;
+		if (is_video)
+		{
+			msg = templates[(nb_videos % config.gop == 0)? 0 : 1]->copy();
+			nb_videos++;
+		}
+		else
+		{
+			msg = templates[2]->copy();
+			nb_audios++;
+		}
+		msg->header.timestamp = (int32_t)timestamp;
+
+		if ((ret = client->send_message(msg)) != ERROR_SUCCESS)
+		{
+			break;
+		}
+		publisher->send_bytes = client->get_send_bytes();
+	}
+
+	for (int i = 0; i < 3; i++)
+	{
+		rss_freep(templates[i]);
+	}
+
+	return ret;
+}
+
+static int bench_play(BenchPlayer* player, RssRtmpClient* client)
+{
+	int ret = ERROR_SUCCESS;
+
+	std::string stream;
+	bench_stream_name(player->index % config.publishers, stream);
+
+	int stream_id = 0;
+	if ((ret = client->create_stream(stream_id)) != ERROR_SUCCESS
+		|| (ret = client->play(stream, stream_id)) != ERROR_SUCCESS)
+	{
+		return ret;
+	}
+
+	while (true)
+	{
+		RssCommonMessage* msg = NULL;
+		if ((ret = client->recv_message(&msg)) != ERROR_SUCCESS)
+		{
+			return ret;
+		}
+
+		// the keyframe, not the sequence header.
+		if (player->keyframe_us == 0 && msg->header.is_video() && msg->size > 1
+			&& ((msg->payload[0] >> 4) & 0x0f) == 1 && msg->payload[1] == 1)
+		{
+			player->keyframe_us = RssClock::now_us();
+		}
+		player->recv_bytes = client->get_recv_bytes();
+
+		rss_freep(msg);
+	}
+
+	return ret;
+}
+
+static void* bench_publisher_thread(void* arg)
+{
+	BenchPublisher* publisher = (BenchPublisher*)arg;
+
+	st_netfd_t stfd = NULL;
+	if (bench_connect(&stfd) != ERROR_SUCCESS)
+	{
+		publisher->failed = true;
+		return NULL;
+	}
+
+	RssRtmpClient* client = new RssRtmpClient(stfd);
+	client->set_recv_timeout(BENCH_TIMEOUT_MS);
+	client->set_send_timeout(BENCH_TIMEOUT_MS);
+
+	std::string tc_url = "rtmp://" + config.host + "/" + config.app;
+	if (client->handshake() != ERROR_SUCCESS || client->connect_app(tc_url) != ERROR_SUCCESS
+		|| bench_publish(publisher, client) != ERROR_SUCCESS)
+	{
+		publisher->failed = !publisher->published;
+	}
+
+	rss_freep(client);
+	st_netfd_close(stfd);
+
+	return NULL;
+}
+
+static void* bench_player_thread(void* arg)
+{
+	BenchPlayer* player = (BenchPlayer*)arg;
+	player->start_us = RssClock::now_us();
+
+	st_netfd_t stfd = NULL;
+	if (bench_connect(&stfd) != ERROR_SUCCESS)
+	{
+		player->failed = true;
+		return NULL;
+	}
+
+	RssRtmpClient* client = new RssRtmpClient(stfd);
+	client->set_recv_timeout(BENCH_TIMEOUT_MS);
+	client->set_send_timeout(BENCH_TIMEOUT_MS);
+
+	std::string tc_url = "rtmp://" + config.host + "/" + config.app;
+	if (client->handshake() != ERROR_SUCCESS)
+	{
+		player->failed = true;
+	}
+	else
+	{
+		player->connected_us = RssClock::now_us();
+
+		if (client->connect_app(tc_url) != ERROR_SUCCESS || bench_play(player, client) != ERROR_SUCCESS)
+		{
+			player->failed = (player->keyframe_us == 0);
+		}
+	}
+
+	rss_freep(client);
+	st_netfd_close(stfd);
+
+	return NULL;
+}
+
+/**
+* get the cpu ticks of user and sys of the server processes.
+* @return false if the server not found.
+*/
+static bool bench_server_cpu_ticks(std::vector<int64_t>& pids, int64_t& ticks)
+{
+	ticks = 0;
+
+	for (int i = 0; i < (int)pids.size(); i++)
+	{
+		char path[64];
+		snprintf(path, sizeof(path), "/proc/%lld/stat", (long long)pids[i]);
+
+		FILE* f = fopen(path, "r");
+		if (!f)
+		{
+			return false;
+		}
+
+		char buf[1024];
+		size_t nread = fread(buf, 1, sizeof(buf) - 1, f);
+		fclose(f);
+		buf[nread] = 0;
+
+		// the fields after the comm, the utime and stime are the 14th and 15th.
+		char* p = strrchr(buf, ')');
+		unsigned long utime = 0, stime = 0;
+		if (!p || sscanf(p + 2, "%*c %*d %*d %*d %*d %*d %*u %*u %*u %*u %*u %lu %lu", &utime, &stime) != 2)
+		{
+			return false;
+		}
+		ticks += utime + stime;
+	}
+
+	return !pids.empty();
+}
+
+/**
+* find the server processes by the workers of shm stat segment.
+*/
+static void bench_discover_server(std::vector<int64_t>& pids)
+{
+	char name[64];
+	snprintf(name, sizeof(name), RSS_SHM_STAT_NAME, config.port, RSS_SHM_STAT_VERSION);
+
+	int fd = shm_open(name, O_RDONLY, 0);
+	if (fd == -1)
+	{
+		return;
+	}
+
+	struct stat st;
+	if (fstat(fd, &st) == -1 || st.st_size < (off_t)sizeof(RssShmStatSegment))
+	{
+		::close(fd);
+		return;
+	}
+
+	void* p = mmap(NULL, sizeof(RssShmStatSegment), PROT_READ, MAP_SHARED, fd, 0);
+	::close(fd);
+	if (p == MAP_FAILED)
+	{
+		return;
+	}
+
+	RssShmStatSegment* seg = (RssShmStatSegment*)p;
+	if (__atomic_load_n(&seg->header.magic, __ATOMIC_ACQUIRE) == RSS_SHM_STAT_MAGIC
+		&& seg->header.version == RSS_SHM_STAT_VERSION)
+	{
+		for (int i = 0; i < RSS_SHM_STAT_MAX_WORKERS; i++)
+		{
+			int64_t pid = __atomic_load_n(&seg->workers[i].pid, __ATOMIC_ACQUIRE);
+			if (pid > 0 && (kill((pid_t)pid, 0) == 0 || errno != ESRCH))
+			{
+				pids.push_back(pid);
+			}
+		}
+	}
+
+	munmap(p, sizeof(RssShmStatSegment));
+}
+
+static int64_t bench_self_cpu_us()
+{
+	rusage usage;
+	getrusage(RUSAGE_SELF, &usage);
+	return (int64_t)(usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) * 1000000
+		+ usage.ru_utime.tv_usec + usage.ru_stime.tv_usec;
+}
+
+static bool bench_publishers_ready()
+{
+	for (int i = 0; i < (int)publishers.size(); i++)
+	{
+		if (!publishers[i].published && !publishers[i].failed)
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+static bool bench_players_ready()
+{
+	for (int i = 0; i < (int)players.size(); i++)
+	{
+		if (players[i].keyframe_us == 0 && !players[i].failed)
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+/**
+* wait util ready or timeout.
+*/
+static void bench_wait(bool (*ready)())
+{
+	int64_t deadline = RssClock::now_us() + BENCH_TIMEOUT_MS * 1000LL;
+	while (!ready() && RssClock::now_us() < deadline)
+	{
+		st_usleep(BENCH_POLL_MS * 1000);
+	}
+}
+
+static void bench_usage(const char* argv0)
+{
+	fprintf(stderr, "usage: %s [-h host] [-p port] [-a app] [-n publishers] [-m players] "
+		"[-b kbps] [-f fps] [-g gop] [-z frame_size] [-d duration]\n", argv0);
+}
+
+int main(int argc, char** argv)
+{
+	config.host = "127.0.0.1";
+	config.port = BENCH_DEFAULT_PORT;
+	config.app = "live";
+	config.publishers = 1;
+	config.players = 10;
+	config.kbps = 1000;
+	config.fps = 25;
+	config.gop = 50;
+	config.frame_size = 0;
+	config.duration = 10;
+
+	int opt;
+	while ((opt = getopt(argc, argv, "h:p:a:n:m:b:f:g:z:d:")) != -1)
+	{
+		switch (opt)
+		{
+		case 'h': config.host = optarg; break;
+		case 'p': config.port = atoi(optarg); break;
+		case 'a': config.app = optarg; break;
+		case 'n': config.publishers = atoi(optarg); break;
+		case 'm': config.players = atoi(optarg); break;
+		case 'b': config.kbps = atoi(optarg); break;
+		case 'f': config.fps = atoi(optarg); break;
+		case 'g': config.gop = atoi(optarg); break;
+		case 'z': config.frame_size = atoi(optarg); break;
+		case 'd': config.duration = atoi(optarg); break;
+		default: bench_usage(argv[0]); return -1;
+		}
+	}
+	if (config.publishers <= 0 || config.players < 0 || config.kbps <= 0 || config.fps <= 0
+		|| config.gop <= 0 || config.duration <= 0)
+	{
+		bench_usage(argv[0]);
+		return -1;
+	}
+
+	// only the errors, the report is written to stdout.
+	for (int i = 0; i < RssLogSubsystemMax; i++)
+	{
+		rss_log_levels[i] = RssLogError;
+	}
+	int ret = ERROR_SUCCESS;
+	if ((ret = log_writer->initialize(BENCH_LOG_FILE)) != ERROR_SUCCESS)
+	{
+		fprintf(stderr, "initialize log %s failed. ret=%d\n", BENCH_LOG_FILE, ret);
+		return ret;
+	}
+
+	// the players require lots of fds.
+	rlimit rl;
+	if (getrlimit(RLIMIT_NOFILE, &rl) == 0 && rl.rlim_cur < rl.rlim_max)
+	{
+		rl.rlim_cur = rl.rlim_max;
+		setrlimit(RLIMIT_NOFILE, &rl);
+	}
+	signal(SIGPIPE, SIG_IGN);
+
+	if (st_set_eventsys(ST_EVENTSYS_ALT) == -1 || st_init() != 0)
+	{
+		fprintf(stderr, "initialize st failed.\n");
+		return -1;
+	}
+
+	// publish all streams, then play.
+	publishers.resize(config.publishers);
+	for (int i = 0; i < config.publishers; i++)
+	{
+		BenchPublisher* publisher = &publishers[i];
+		memset(publisher, 0, sizeof(BenchPublisher));
+		publisher->index = i;
+		st_thread_create(bench_publisher_thread, publisher, 0, 0);
+	}
+	bench_wait(bench_publishers_ready);
+
+	int64_t ramp_us = RssClock::now_us();
+	players.resize(config.publishers * config.players);
+	for (int i = 0; i < (int)players.size(); i++)
+	{
+		BenchPlayer* player = &players[i];
+		memset(player, 0, sizeof(BenchPlayer));
+		player->index = i;
+		st_thread_create(bench_player_thread, player, 0, 0);
+	}
+	bench_wait(bench_players_ready);
+
+	// measure in the duration.
+	std::vector<int64_t> server_pids;
+	bench_discover_server(server_pids);
+
+	int64_t server_ticks_start = 0;
+	bool has_server_cpu = bench_server_cpu_ticks(server_pids, server_ticks_start);
+	int64_t self_cpu_start = bench_self_cpu_us();
+
+	std::vector<int64_t> player_bytes(players.size());
+	for (int i = 0; i < (int)players.size(); i++)
+	{
+		player_bytes[i] = players[i].recv_bytes;
+	}
+	std::vector<int64_t> publisher_bytes(publishers.size());
+	for (int i = 0; i < (int)publishers.size(); i++)
+	{
+		publisher_bytes[i] = publishers[i].send_bytes;
+	}
+
+	int64_t start_us = RssClock::now_us();
+	st_usleep(config.duration * 1000000LL);
+	int64_t elapsed_us = RssClock::now_us() - start_us;
+
+	int64_t server_ticks_end = 0;
+	has_server_cpu = has_server_cpu && bench_server_cpu_ticks(server_pids, server_ticks_end);
+	int64_t self_cpu_end = bench_self_cpu_us();
+
+	// the report.
+	int nb_published = 0;
+	double publish_kbps = 0;
+	for (int i = 0; i < (int)publishers.size(); i++)
+	{
+		nb_published += publishers[i].published? 1 : 0;
+		publish_kbps += (publishers[i].send_bytes - publisher_bytes[i]) * 8.0 / elapsed_us * 1000;
+	}
+
+	int nb_connected = 0, nb_failed = 0;
+	int64_t last_connected_us = ramp_us;
+	int64_t egress_bytes = 0;
+	double min_kbps = -1, max_kbps = 0;
+	RssHistogram startup;
+	for (int i = 0; i < (int)players.size(); i++)
+	{
+		BenchPlayer* player = &players[i];
+		nb_failed += player->failed? 1 : 0;
+
+		if (player->connected_us > 0)
+		{
+			nb_connected++;
+			last_connected_us = rss_max(last_connected_us, player->connected_us);
+		}
+		if (player->keyframe_us > 0)
+		{
+			startup.record(player->keyframe_us - player->start_us);
+		}
+
+		int64_t bytes = player->recv_bytes - player_bytes[i];
+		double kbps = bytes * 8.0 / elapsed_us * 1000;
+		egress_bytes += bytes;
+		min_kbps = (min_kbps < 0)? kbps : rss_min(min_kbps, kbps);
+		max_kbps = rss_max(max_kbps, kbps);
+	}
+
+	printf("publishers=%d\n", config.publishers);
+	printf("published=%d\n", nb_published);
+	printf("publish_kbps=%.1f\n", nb_published? publish_kbps / nb_published : 0);
+	printf("players=%d\n", (int)players.size());
+	printf("connected=%d\n", nb_connected);
+	printf("failed=%d\n", nb_failed);
+	printf("accept_rate=%.1f\n", (last_connected_us > ramp_us)? nb_connected * 1000000.0 / (last_connected_us - ramp_us) : 0);
+	printf("duration_ms=%lld\n", (long long)(elapsed_us / 1000));
+	printf("egress_gbps=%.3f\n", egress_bytes * 8.0 / elapsed_us / 1000);
+	printf("player_kbps_min=%.1f\n", rss_max(min_kbps, 0.0));
+	printf("player_kbps_avg=%.1f\n", players.empty()? 0 : egress_bytes * 8.0 / elapsed_us * 1000 / players.size());
+	printf("player_kbps_max=%.1f\n", max_kbps);
+	printf("startup_ms_count=%lld\n", (long long)startup.get_count());
+	printf("startup_ms_p50=%.1f\n", startup.percentile(0.5) / 1000.0);
+	printf("startup_ms_p99=%.1f\n", startup.percentile(0.99) / 1000.0);
+	printf("startup_ms_max=%.1f\n", startup.get_max() / 1000.0);
+	if (has_server_cpu)
+	{
+		double seconds = (double)(server_ticks_end - server_ticks_start) / sysconf(_SC_CLK_TCK);
+		printf("server_cpu=%.1f\n", seconds * 1000000 / elapsed_us * 100);
+	}
+	else
+	{
+		printf("server_cpu=n/a\n");
+	}
+	printf("bench_cpu=%.1f\n", (self_cpu_end - self_cpu_start) * 100.0 / elapsed_us);
+	fflush(stdout);
+
+	// never cleanup the st-threads, the _exit skips the atexit flush of log.
+	log_writer->flush();
+	_exit(0);
+}
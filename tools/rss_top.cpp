@@ -0,0 +1,226 @@
+/**
+* show the live stats of server from the shared memory stats segment,
+* the server is never disturbed, see RssShmStat.
+* usage: objs/tools/rss_top <listen_port> [interval_seconds] [count]
+* 		interval_seconds, the interval to refresh, default 1.
+* 		count, the number of refreshes then quit, default 0 to refresh forever.
+*/
+#include <rss_core.hpp>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include <map>
+
+#include <rss_core_shm_stat.hpp>
+
+#define TOP_DEFAULT_INTERVAL 1
+
+/**
+* the bytes of worker at the last update of slot, to compute the bitrate
+* over the interval of server updates, not the interval of refresh.
+*/
+struct TopSample
+{
+	int64_t update_ms;
+	int64_t recv_bytes;
+	int64_t send_bytes;
+	double in_mbps;
+	double out_mbps;
+};
+
+static bool top_is_alive(int64_t pid)
+{
+	return pid > 0 && (kill((pid_t)pid, 0) == 0 || errno != ESRCH);
+}
+
+static double top_mbps(int64_t bytes, int64_t elapsed_ms)
+{
+	return bytes * 8.0 / elapsed_ms / 1000;
+}
+
+static void top_refresh(RssShmStatSegment* seg, std::map<int64_t, TopSample>& samples, bool clear)
+{
+	if (clear)
+	{
+		printf("\033[H\033[2J");
+	}
+
+	printf("%-8s %10s %6s %9s %10s %10s %6s %8s %7s\n",
+	       "PID", "UPTIME(s)", "CONNS", "ACCEPTED", "IN(Mbps)", "OUT(Mbps)", "CPU%", "LAG(ms)", "SOURCES");
+
+	std::map<int64_t, TopSample> current;
+	for (int i = 0; i < RSS_SHM_STAT_MAX_WORKERS; i++)
+	{
+		RssShmWorkerSlot* w = &seg->workers[i];
+
+		int64_t pid = __atomic_load_n(&w->pid, __ATOMIC_ACQUIRE);
+		if (!top_is_alive(pid))
+		{
+			continue;
+		}
+
+		// the bytes and update time of same update, retry when the server is updating.
+		TopSample sample;
+		for (int retry = 0; retry < 3; retry++)
+		{
+			sample.update_ms = rss_shm_load(w->update_ms);
+			sample.recv_bytes = rss_shm_load(w->recv_bytes);
+			sample.send_bytes = rss_shm_load(w->send_bytes);
+			if (sample.update_ms == rss_shm_load(w->update_ms))
+			{
+				break;
+			}
+		}
+		sample.in_mbps = sample.out_mbps = 0;
+
+		// the first refresh of worker has no bitrate,
+		// keep the last bitrate when the server not updated the slot.
+		std::map<int64_t, TopSample>::iterator it = samples.find(pid);
+		if (it != samples.end())
+		{
+			TopSample& last = it->second;
+			if (sample.update_ms > last.update_ms)
+			{
+				int64_t elapsed_ms = sample.update_ms - last.update_ms;
+				sample.in_mbps = top_mbps(sample.recv_bytes - last.recv_bytes, elapsed_ms);
+				sample.out_mbps = top_mbps(sample.send_bytes - last.send_bytes, elapsed_ms);
+			}
+			else
+			{
+				sample = last;
+			}
+		}
+		current[pid] = sample;
+
+		int nb_sources = 0;
+		for (int j = 0; j < RSS_SHM_STAT_MAX_SOURCES; j++)
+		{
+			if (__atomic_load_n(&seg->sources[j].pid, __ATOMIC_ACQUIRE) == pid)
+			{
+				nb_sources++;
+			}
+		}
+
+		printf("%-8lld %10lld %6lld %9lld %10.2f %10.2f %6.1f %8.2f %7d\n",
+		       (long long)pid, (long long)((rss_shm_load(w->update_ms) - w->start_ms) / 1000),
+		       (long long)rss_shm_load(w->conns), (long long)rss_shm_load(w->accepted),
+		       sample.in_mbps, sample.out_mbps, rss_shm_load(w->cpu_permille) / 10.0,
+		       rss_shm_load(w->sched_lag_us) / 1000.0, nb_sources);
+	}
+	samples = current;
+
+	printf("\n%-8s %-5s %-40s %4s %8s %8s %8s %10s %8s %8s\n",
+	       "PID", "ID", "URL", "PUB", "KBPS", "VIEWERS", "QUEUE", "DROPPED", "P50(ms)", "P99(ms)");
+
+	for (int i = 0; i < RSS_SHM_STAT_MAX_SOURCES; i++)
+	{
+		RssShmSourceSlot* s = &seg->sources[i];
+
+		int64_t pid = __atomic_load_n(&s->pid, __ATOMIC_ACQUIRE);
+		if (!top_is_alive(pid))
+		{
+			continue;
+		}
+
+		char url[RSS_SHM_STAT_URL_SIZE];
+		memcpy(url, s->url, sizeof(url));
+		url[sizeof(url) - 1] = 0;
+
+		printf("%-8lld %-5lld %-40s %4s %8lld %8lld %8lld %10lld %8.2f %8.2f\n",
+		       (long long)pid, (long long)rss_shm_load(s->id), url,
+		       rss_shm_load(s->publishing)? "yes" : "no", (long long)rss_shm_load(s->kbps),
+		       (long long)rss_shm_load(s->consumers), (long long)rss_shm_load(s->queue_msgs),
+		       (long long)rss_shm_load(s->dropped), rss_shm_load(s->latency_p50_us) / 1000.0,
+		       rss_shm_load(s->latency_p99_us) / 1000.0);
+	}
+
+	fflush(stdout);
+}
+
+int main(int argc, char** argv)
+{
+	if (argc < 2)
+	{
+		fprintf(stderr, "usage: %s <listen_port> [interval_seconds] [count]\n", argv[0]);
+		return -1;
+	}
+
+	int port = atoi(argv[1]);
+	int interval = (argc > 2)? atoi(argv[2]) : TOP_DEFAULT_INTERVAL;
+	int count = (argc > 3)? atoi(argv[3]) : 0;
+	if (interval <= 0)
+	{
+		interval = TOP_DEFAULT_INTERVAL;
+	}
+
+	char name[64];
+	snprintf(name, sizeof(name), RSS_SHM_STAT_NAME, port, RSS_SHM_STAT_VERSION);
+
+	int fd = shm_open(name, O_RDONLY, 0);
+	if (fd == -1)
+	{
+		fprintf(stderr, "open shm stat %s failed, is the server listen at %d?\n", name, port);
+		return -1;
+	}
+
+	struct stat st;
+	if (fstat(fd, &st) == -1 || st.st_size < (off_t)sizeof(RssShmStatSegment))
+	{
+		fprintf(stderr, "invalid shm stat %s.\n", name);
+		close(fd);
+		return -1;
+	}
+
+	void* p = mmap(NULL, sizeof(RssShmStatSegment), PROT_READ, MAP_SHARED, fd, 0);
+	close(fd);
+	if (p == MAP_FAILED)
+	{
+		fprintf(stderr, "mmap shm stat %s failed.\n", name);
+		return -1;
+	}
+
+	RssShmStatSegment* seg = (RssShmStatSegment*)p;
+	if (__atomic_load_n(&seg->header.magic, __ATOMIC_ACQUIRE) != RSS_SHM_STAT_MAGIC
+		|| seg->header.version != RSS_SHM_STAT_VERSION || seg->header.size != sizeof(RssShmStatSegment))
+	{
+		fprintf(stderr, "the version of shm stat %s is %d, expect %d.\n", name, seg->header.version, RSS_SHM_STAT_VERSION);
+		return -1;
+	}
+
+	// clear the screen for terminal, print the frames for pipe.
+	bool clear = isatty(STDOUT_FILENO);
+
+	// the first sample for bitrate.
+	std::map<int64_t, TopSample> samples;
+	for (int i = 0; i < RSS_SHM_STAT_MAX_WORKERS; i++)
+	{
+		RssShmWorkerSlot* w = &seg->workers[i];
+		int64_t pid = __atomic_load_n(&w->pid, __ATOMIC_ACQUIRE);
+		if (top_is_alive(pid))
+		{
+			samples[pid].recv_bytes = rss_shm_load(w->recv_bytes);
+			samples[pid].send_bytes = rss_shm_load(w->send_bytes);
+		}
+	}
+
+	for (int i = 0; count <= 0 || i < count; i++)
+	{
+		sleep(interval);
+
+		if (!clear && i > 0)
+		{
+			printf("\n");
+		}
+		top_refresh(seg, samples, clear);
+	}
+
+	return 0;
+}
@@ -0,0 +1,306 @@
+/**
+* decode the binary event trace of server to per-stage latency histograms.
+* usage: objs/tools/rss_trace_decode <trace file>
+* 		the trace file is written by the server started with env RSS_TRACE_FILE.
+* the stages of audio and video message, matched by the type and timestamp:
+* 		receive: the first chunk received to the message complete.
+* 		source: the message complete to enqueued to consumers.
+* 		queue: enqueued to dequeued by the play client.
+* 		send: dequeued to written to socket.
+* 		total: the first chunk received to written to socket.
+*/
+#include <rss_core.hpp>
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include <algorithm>
+#include <map>
+#include <vector>
+
+#include <rss_core_trace.hpp>
+
+// the log2 buckets in us, the last bucket is about 1s.
+#define DECODE_BUCKETS 21
+#define DECODE_BAR_WIDTH 40
+
+#define RTMP_MSG_AudioMessage 8
+#define RTMP_MSG_VideoMessage 9
+
+/**
+* identify a message in a connection or source.
+*/
+struct DecodeKey
+{
+	int32_t id;
+	int16_t message_type;
+	int32_t timestamp;
+
+	DecodeKey(int32_t _id, int16_t _message_type, int32_t _timestamp)
+	{
+		id = _id;
+		message_type = _message_type;
+		timestamp = _timestamp;
+	}
+
+	bool operator<(const DecodeKey& other) const
+	{
+		if (id != other.id)
+		{
+			return id < other.id;
+		}
+		if (message_type != other.message_type)
+		{
+			return message_type < other.message_type;
+		}
+		return timestamp < other.timestamp;
+	}
+};
+
+/**
+* the time of a stage, and the time of the first chunk received.
+*/
+struct DecodeTime
+{
+	int64_t time_us;
+	int64_t origin_us;
+};
+
+/**
+* the latency samples of a stage.
+*/
+class DecodeStage
+{
+private:
+	const char* name;
+	std::vector<int64_t> samples;
+public:
+	DecodeStage(const char* _name)
+	{
+		name = _name;
+	}
+public:
+	void add(int64_t latency_us)
+	{
+		samples.push_back(rss_max(latency_us, (int64_t)0));
+	}
+
+	void report()
+	{
+		printf("\n%s: samples=%d\n", name, (int)samples.size());
+		if (samples.empty())
+		{
+			return;
+		}
+
+		std::sort(samples.begin(), samples.end());
+
+		int64_t sum = 0;
+		int buckets[DECODE_BUCKETS];
+		memset(buckets, 0, sizeof(buckets));
+
+		for (int i = 0; i < (int)samples.size(); i++)
+		{
+			int64_t v = samples[i];
+			sum += v;
+
+			int b = 0;
+			while (b < DECODE_BUCKETS - 1 && v >= (2LL << b))
+			{
+				b++;
+			}
+			buckets[b]++;
+		}
+
+		printf("    min=%lldus, avg=%lldus, p50=%lldus, p90=%lldus, p99=%lldus, p999=%lldus, max=%lldus\n",
+		       (long long)samples.front(), (long long)(sum / (int64_t)samples.size()),
+		       (long long)percentile(0.5), (long long)percentile(0.9), (long long)percentile(0.99),
+		       (long long)percentile(0.999), (long long)samples.back());
+
+		int peak = *std::max_element(buckets, buckets + DECODE_BUCKETS);
+		for (int b = 0; b < DECODE_BUCKETS; b++)
+		{
+			if (buckets[b] == 0)
+			{
+				continue;
+			}
+
+			char bar[DECODE_BAR_WIDTH + 1];
+			int width = rss_max(1, (int)((int64_t)buckets[b] * DECODE_BAR_WIDTH / peak));
+			memset(bar, '#', width);
+			bar[width] = 0;
+
+			int64_t low = (b == 0)? 0 : (1LL << b);
+			printf("    %8lldus %8d %s\n", (long long)low, buckets[b], bar);
+		}
+	}
+private:
+	int64_t percentile(double p)
+	{
+		int index = (int)(p * (samples.size() - 1));
+		return samples[index];
+	}
+};
+
+static bool decode_is_av(int message_type)
+{
+	return message_type == RTMP_MSG_AudioMessage || message_type == RTMP_MSG_VideoMessage;
+}
+
+int main(int argc, char** argv)
+{
+	if (argc < 2)
+	{
+		fprintf(stderr, "usage: %s <trace file>\n", argv[0]);
+		return -1;
+	}
+
+	int fd = ::open(argv[1], O_RDONLY);
+	if (fd == -1)
+	{
+		fprintf(stderr, "open trace file %s failed.\n", argv[1]);
+		return -1;
+	}
+
+	struct stat st;
+	if (fstat(fd, &st) == -1 || st.st_size < (off_t)sizeof(RssTraceHeader))
+	{
+		fprintf(stderr, "invalid trace file %s.\n", argv[1]);
+		::close(fd);
+		return -1;
+	}
+
+	void* p = ::mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+	::close(fd);
+	if (p == MAP_FAILED)
+	{
+		fprintf(stderr, "mmap trace file %s failed.\n", argv[1]);
+		return -1;
+	}
+
+	RssTraceHeader* header = (RssTraceHeader*)p;
+	if (memcmp(header->magic, RSS_TRACE_MAGIC, sizeof(header->magic)) != 0
+		|| header->version != RSS_TRACE_VERSION || header->record_size != (int)sizeof(RssTraceRecord)
+		|| header->capacity <= 0
+		|| st.st_size < (off_t)(sizeof(RssTraceHeader) + header->capacity * sizeof(RssTraceRecord)))
+	{
+		fprintf(stderr, "invalid trace header of %s.\n", argv[1]);
+		return -1;
+	}
+
+	RssTraceRecord* records = (RssTraceRecord*)(header + 1);
+
+	// the records overwritten by ring are lost, decode the last capacity records.
+	int64_t count = __atomic_load_n(&header->count, __ATOMIC_ACQUIRE);
+	int64_t start = rss_max((int64_t)0, count - header->capacity);
+
+	int64_t nb_events[RssTraceEventMax];
+	memset(nb_events, 0, sizeof(nb_events));
+
+	// the connection id to the first chunk, complete and dequeued time.
+	std::map<DecodeKey, int64_t> received;
+	std::map<DecodeKey, DecodeTime> completed;
+	std::map<DecodeKey, DecodeTime> dequeued;
+	// the source id to the enqueued time, shared by all consumers.
+	std::map<DecodeKey, DecodeTime> enqueued;
+
+	int64_t nb_fanout = 0;
+
+	DecodeStage receive("receive"), source("source"), queue("queue"), send("send"), total("total");
+
+	for (int64_t i = start; i < count; i++)
+	{
+		RssTraceRecord* r = &records[i % header->capacity];
+
+		if (r->event > 0 && r->event < RssTraceEventMax)
+		{
+			nb_events[r->event]++;
+		}
+
+		if (!decode_is_av(r->message_type))
+		{
+			continue;
+		}
+
+		DecodeKey key(r->conn_id, r->message_type, r->timestamp);
+		DecodeKey source_key(r->stream_id, r->message_type, r->timestamp);
+
+		if (r->event == RssTraceEventChunkReceived)
+		{
+			// the first chunk of message.
+			if (received.find(key) == received.end())
+			{
+				received[key] = r->time_us;
+			}
+		}
+		else if (r->event == RssTraceEventMessageComplete)
+		{
+			DecodeTime t = {r->time_us, r->time_us};
+
+			std::map<DecodeKey, int64_t>::iterator it = received.find(key);
+			if (it != received.end())
+			{
+				t.origin_us = it->second;
+				receive.add(r->time_us - it->second);
+				received.erase(it);
+			}
+
+			completed[key] = t;
+		}
+		else if (r->event == RssTraceEventEnqueued)
+		{
+			DecodeTime t = {r->time_us, r->time_us};
+
+			std::map<DecodeKey, DecodeTime>::iterator it = completed.find(key);
+			if (it != completed.end())
+			{
+				t.origin_us = it->second.origin_us;
+				source.add(r->time_us - it->second.time_us);
+				completed.erase(it);
+			}
+
+			enqueued[source_key] = t;
+			nb_fanout += r->count;
+		}
+		else if (r->event == RssTraceEventDequeued)
+		{
+			std::map<DecodeKey, DecodeTime>::iterator it = enqueued.find(source_key);
+			if (it != enqueued.end())
+			{
+				DecodeTime t = {r->time_us, it->second.origin_us};
+				queue.add(r->time_us - it->second.time_us);
+				dequeued[key] = t;
+			}
+		}
+		else if (r->event == RssTraceEventWritten)
+		{
+			std::map<DecodeKey, DecodeTime>::iterator it = dequeued.find(key);
+			if (it != dequeued.end())
+			{
+				send.add(r->time_us - it->second.time_us);
+				total.add(r->time_us - it->second.origin_us);
+				dequeued.erase(it);
+			}
+		}
+	}
+
+	printf("trace %s: records=%lld, decoded=%lld, lost=%lld\n", argv[1],
+	       (long long)count, (long long)(count - start), (long long)start);
+	printf("events: chunk=%lld, complete=%lld, enqueued=%lld(fanout=%lld), dequeued=%lld, written=%lld\n",
+	       (long long)nb_events[RssTraceEventChunkReceived], (long long)nb_events[RssTraceEventMessageComplete],
+	       (long long)nb_events[RssTraceEventEnqueued], (long long)nb_fanout,
+	       (long long)nb_events[RssTraceEventDequeued], (long long)nb_events[RssTraceEventWritten]);
+
+	receive.report();
+	source.report();
+	queue.report();
+	send.report();
+	total.report();
+
+	return 0;
+}